@@ -0,0 +1,119 @@
+#include <stdio.h>
+
+#include "bench.h"
+
+/*
+ * the acknowledgement traffic of a one way reliable stream over loopback
+ *
+ * the client sends ACK_PACKET_COUNT reliable packets and the server only acknowledges them,
+ * 	so everything the server sends is acknowledgements
+ * each size runs with selective acknowledgements negotiated and with the client offering
+ * 	no capabilities, which falls back to one acknowledgement per command
+ */
+
+#define ACK_PACKET_COUNT 20000
+// how many packets the client may have sent that the server has not received yet
+#define ACK_AHEAD 400
+#define ACK_DATA_IN_TRANSIT 32768
+#define ACK_TIMEOUT 30.0
+
+static int ack_run (enet_uint32 capabilities, size_t packet_size)
+{
+	static enet_uint8 data[1000];
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("ack: could not create hosts\n");
+
+		return 1;
+	}
+
+	client->capabilities = capabilities;
+
+	ENetAddress address = bench_server_address (server);
+	ENetPeer* peer = enet_host_connect (client, &address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("ack: could not connect\n");
+
+		return 1;
+	}
+
+	server->totalSentData = 0;
+	server->totalSentPackets = 0;
+
+	size_t sent = 0;
+	size_t received = 0;
+	double start = bench_now ();
+
+	while (received < ACK_PACKET_COUNT)
+	{
+		if (bench_now () - start > ACK_TIMEOUT)
+		{
+			printf ("ack: only %zu of %i packets arrived\n", received, ACK_PACKET_COUNT);
+
+			return 1;
+		}
+
+		while (sent < ACK_PACKET_COUNT
+			&& sent - received < ACK_AHEAD
+			&& peer->reliableDataInTransit < ACK_DATA_IN_TRANSIT)
+		{
+			ENetPacket* packet = enet_packet_create (data, packet_size, ENET_PACKET_FLAG_RELIABLE);
+
+			if (!packet
+				|| enet_peer_send (peer, 0, packet) < 0)
+			{
+				printf ("ack: could not queue a packet\n");
+
+				return 1;
+			}
+
+			sent++;
+		}
+
+		bench_drain (client);
+		received += bench_drain (server) / packet_size;
+		bench_drain (client);
+	}
+
+	printf ("%-26s %4zu byte packets: %6u bytes of acknowledgements in %5u datagrams, %.2f bytes per packet, %.0f ms\n",
+		peer->capabilities & ENET_PROTOCOL_CAPABILITY_SELECTIVE_ACKNOWLEDGE ? "selective acknowledgements" : "plain acknowledgements",
+		packet_size,
+		server->totalSentData,
+		server->totalSentPackets,
+		(double) server->totalSentData / ACK_PACKET_COUNT,
+		(bench_now () - start) * 1e3);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	return 0;
+}
+
+int main (void)
+{
+	static const size_t sizes[] = {32, 1000};
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("ack: could not initialize enet\n");
+
+		return 1;
+	}
+
+	for (size_t iter = 0; iter < sizeof (sizes) / sizeof (sizes[0]); iter++)
+	{
+		result |= ack_run (0, sizes[iter]);
+		result |= ack_run (ENET_PROTOCOL_CAPABILITY_ALL, sizes[iter]);
+	}
+
+	enet_deinitialize ();
+
+	return result;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/*
+ * heap allocations per packet in a steady stream of small packets over loopback
+ *
+ * enet's allocations are counted through enet_initialize_with_callbacks, on both hosts
+ * 	the client sends ALLOCS_BURST_SIZE packets per round, mixing reliable and unreliable
+ * 	on two channels, and the server receives and destroys them
+ * the first ALLOCS_WARMUP_ROUNDS are not counted, so hosts can reach their working set
+ */
+
+#define ALLOCS_ROUNDS 2000
+#define ALLOCS_WARMUP_ROUNDS 200
+#define ALLOCS_BURST_SIZE 16
+#define ALLOCS_PACKET_SIZE 32
+
+static long allocs_count = 0;
+
+static void* allocs_malloc (size_t size)
+{
+	allocs_count++;
+
+	return malloc (size);
+}
+
+int main (void)
+{
+	static const enet_uint8 data[ALLOCS_PACKET_SIZE];
+	ENetCallbacks callbacks =
+	{
+		.malloc = allocs_malloc,
+		.free = free,
+		.no_memory = abort
+	};
+
+	if (enet_initialize_with_callbacks (ENET_VERSION, &callbacks) != 0)
+	{
+		printf ("allocs: could not initialize enet\n");
+
+		return 1;
+	}
+
+	ENetHost* server = bench_create_server (1, 2);
+	ENetHost* client = enet_host_create (NULL, 1, 2, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("allocs: could not create hosts\n");
+
+		return 1;
+	}
+
+	ENetAddress address = bench_server_address (server);
+	ENetPeer* peer = enet_host_connect (client, &address, 2, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("allocs: could not connect\n");
+
+		return 1;
+	}
+
+	long sent = 0;
+	long received = 0;
+	long start_count = 0;
+	double start = 0.0;
+
+	for (int round = 0; round < ALLOCS_ROUNDS; round++)
+	{
+		if (round == ALLOCS_WARMUP_ROUNDS)
+		{
+			start_count = allocs_count;
+			start = bench_now ();
+			sent = 0;
+			received = 0;
+		}
+
+		for (int iter = 0; iter < ALLOCS_BURST_SIZE; iter++)
+		{
+			ENetPacket* packet = enet_packet_create (data, sizeof (data), iter & 2 ? ENET_PACKET_FLAG_RELIABLE : 0);
+
+			if (!packet
+				|| enet_peer_send (peer, iter & 1, packet) < 0)
+			{
+				printf ("allocs: could not queue a packet\n");
+
+				return 1;
+			}
+
+			sent++;
+		}
+
+		enet_host_flush (client);
+		received += bench_drain (server) / ALLOCS_PACKET_SIZE;
+		bench_drain (client);
+	}
+
+	double elapsed = bench_now () - start;
+
+	printf ("%ld packets sent, %ld received: %.2f heap allocations per packet, %.2f us per packet\n",
+		sent,
+		received,
+		(double) (allocs_count - start_count) / sent,
+		elapsed * 1e6 / sent);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+	enet_deinitialize ();
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include <time.h>
+
+#include "bench.h"
+
+double bench_now (void)
+{
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+
+	return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+void bench_sleep (unsigned int microseconds)
+{
+	struct timespec duration =
+	{
+		.tv_sec = microseconds / 1000000,
+		.tv_nsec = (long) (microseconds % 1000000) * 1000
+	};
+
+	nanosleep (&duration, NULL);
+}
+
+ENetHost* bench_create_server (size_t peer_count, size_t channel_count)
+{
+	ENetAddress address =
+	{
+		.host = ENET_HOST_ANY,
+		.port = 0
+	};
+
+	// enet_host_create reads the port the system picked back into host->address
+	return enet_host_create (&address, peer_count, channel_count, 0, 0);
+}
+
+ENetAddress bench_server_address (const ENetHost* server)
+{
+	ENetAddress address =
+	{
+		.port = server->address.port
+	};
+
+	enet_address_set_host_ip (&address, "127.0.0.1");
+
+	return address;
+}
+
+bool bench_wait_for_connects (ENetHost* server, ENetHost* client, int connect_count)
+{
+	ENetEvent event;
+	int server_connects = 0;
+	int client_connects = 0;
+	double start = bench_now ();
+
+	while (server_connects < connect_count || client_connects < connect_count)
+	{
+		if (bench_now () - start > BENCH_CONNECT_TIMEOUT)
+		{
+			return false;
+		}
+
+		while (enet_host_service (server, &event, 0) > 0)
+		{
+			if (event.type == ENET_EVENT_TYPE_CONNECT)
+			{
+				server_connects++;
+			}
+		}
+
+		while (enet_host_service (client, &event, 1) > 0)
+		{
+			if (event.type == ENET_EVENT_TYPE_CONNECT)
+			{
+				client_connects++;
+			}
+		}
+	}
+
+	return true;
+}
+
+size_t bench_drain (ENetHost* host)
+{
+	ENetEvent event;
+	size_t received = 0;
+
+	while (enet_host_service (host, &event, 0) > 0)
+	{
+		if (event.type == ENET_EVENT_TYPE_RECEIVE)
+		{
+			received += event.packet->dataLength;
+			enet_packet_destroy (event.packet);
+		}
+	}
+
+	return received;
+}
@@ -0,0 +1,34 @@
+#ifndef bench_h
+#define bench_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "enet/enet.h"
+
+/*
+ * helpers shared by the benchmarks and tests in this directory
+ *
+ * they all run a server and its clients in one process over loopback
+ * 	servers bind an ephemeral port, so several programs can run at once
+ */
+
+// how long bench_wait_for_connects waits before giving up, in seconds
+#define BENCH_CONNECT_TIMEOUT 5.0
+
+// seconds on the monotonic clock
+double bench_now (void);
+// sleep for a number of microseconds
+void bench_sleep (unsigned int microseconds);
+// a server host on an ephemeral loopback port
+ENetHost* bench_create_server (size_t peer_count, size_t channel_count);
+// the loopback address to connect to a server made by bench_create_server
+ENetAddress bench_server_address (const ENetHost* server);
+// service both hosts until each has seen connect_count connect events
+// 	returns false if that did not happen within BENCH_CONNECT_TIMEOUT
+bool bench_wait_for_connects (ENetHost* server, ENetHost* client, int connect_count);
+// service a host until it has no more events, destroying any received packets
+// 	returns the number of payload bytes received
+size_t bench_drain (ENetHost* host);
+
+#endif
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*
+ * fragmented reliable broadcasts to many peers over loopback
+ *
+ * every round the server broadcasts one packet, which enet_host_broadcast fragments for
+ * 	each peer, and the client host's peers all receive it before the next round
+ * reports the time enet_host_broadcast takes to queue the packet, and the time the server
+ * 	then spends flushing it, per broadcast
+ *
+ * usage: enet_bench_broadcast [peers] [packet size]
+ * 	without arguments it runs a few sizes
+ */
+
+#define BROADCAST_ROUNDS 10
+// room for a whole broadcast at the clients, so the kernel drops little of it
+#define BROADCAST_SOCKET_BUFFER_SIZE (16 * 1024 * 1024)
+// how long one round may take, in seconds
+#define BROADCAST_TIMEOUT 30.0
+
+static int broadcast_run (int peer_count, size_t packet_size)
+{
+	ENetHost* server = bench_create_server (peer_count, 1);
+	ENetHost* client = enet_host_create (NULL, peer_count, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("broadcast: could not create hosts\n");
+
+		return 1;
+	}
+
+	enet_socket_set_option (server->socket, ENET_SOCKOPT_RCVBUF, BROADCAST_SOCKET_BUFFER_SIZE);
+	enet_socket_set_option (client->socket, ENET_SOCKOPT_RCVBUF, BROADCAST_SOCKET_BUFFER_SIZE);
+
+	ENetAddress address = bench_server_address (server);
+
+	for (int iter = 0; iter < peer_count; iter++)
+	{
+		if (!enet_host_connect (client, &address, 1, 0))
+		{
+			printf ("broadcast: could not connect peer %i\n", iter);
+
+			return 1;
+		}
+	}
+
+	if (!bench_wait_for_connects (server, client, peer_count))
+	{
+		printf ("broadcast: peers did not connect\n");
+
+		return 1;
+	}
+
+	double queue_time = 0.0;
+	double flush_time = 0.0;
+
+	for (int round = 0; round < BROADCAST_ROUNDS; round++)
+	{
+		ENetPacket* packet = enet_packet_create (NULL, packet_size, ENET_PACKET_FLAG_RELIABLE);
+
+		if (!packet)
+		{
+			printf ("broadcast: could not create a packet\n");
+
+			return 1;
+		}
+
+		memset (packet->data, round, packet_size);
+
+		double start = bench_now ();
+
+		enet_host_broadcast (server, 0, packet);
+		queue_time += bench_now () - start;
+
+		size_t received = 0;
+
+		start = bench_now ();
+		while (received < (size_t) peer_count * packet_size)
+		{
+			if (bench_now () - start > BROADCAST_TIMEOUT)
+			{
+				printf ("broadcast: round %i was not delivered\n", round);
+
+				return 1;
+			}
+
+			double flush_start = bench_now ();
+
+			bench_drain (server);
+			flush_time += bench_now () - flush_start;
+
+			received += bench_drain (client);
+		}
+	}
+
+	printf ("%5i peers, %6zu bytes: %8.1f us to queue a broadcast (%.3f us per peer), %8.1f us servicing it\n",
+		peer_count,
+		packet_size,
+		queue_time * 1e6 / BROADCAST_ROUNDS,
+		queue_time * 1e6 / BROADCAST_ROUNDS / peer_count,
+		flush_time * 1e6 / BROADCAST_ROUNDS);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	return 0;
+}
+
+int main (int argc, char** argv)
+{
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("broadcast: could not initialize enet\n");
+
+		return 1;
+	}
+
+	if (argc > 1)
+	{
+		int peer_count = atoi (argv[1]);
+		size_t packet_size = argc > 2 ? (size_t) atoi (argv[2]) : 16384;
+
+		if (peer_count < 1
+			|| peer_count > ENET_PROTOCOL_MAXIMUM_PEER_ID
+			|| packet_size < 1)
+		{
+			printf ("usage: %s [peers] [packet size]\n", argv[0]);
+
+			return 1;
+		}
+
+		result = broadcast_run (peer_count, packet_size);
+	}
+	else
+	{
+		result |= broadcast_run (1000, 1024);
+		result |= broadcast_run (1000, 4096);
+		result |= broadcast_run (1000, 16384);
+		result |= broadcast_run (2000, 16384);
+	}
+
+	enet_deinitialize ();
+
+	return result;
+}
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*
+ * how often a compressing host skips the compressor, for payloads that do and do not compress
+ *
+ * a client sends BYPASS_DATAGRAM_COUNT unreliable packets of BYPASS_PACKET_SIZE bytes over
+ * 	loopback, one datagram each, and the host counters report how many went through the
+ * 	compressor, how many bypassed it, the bytes saved and the time spent compressing
+ * the payload is random bytes, repeated text, or switches between the two every
+ * 	BYPASS_PHASE_LENGTH datagrams, where every phase is reported on its own
+ */
+
+#define BYPASS_DATAGRAM_COUNT 4000
+#define BYPASS_PACKET_SIZE 300
+#define BYPASS_PHASE_LENGTH 1000
+
+enum
+{
+	BYPASS_PAYLOAD_RANDOM,
+	BYPASS_PAYLOAD_TEXT,
+	BYPASS_PAYLOAD_ALTERNATING
+};
+
+static const char* bypass_payload_names[] = {"random", "text", "alternating"};
+
+static void bypass_print (const char* codec, const char* payload, const ENetHost* host)
+{
+	enet_uint32 attempts = host->totalCompressedDatagrams;
+	enet_uint32 bypasses = host->totalCompressionBypasses;
+
+	printf ("%-11s %-16s compressed %4u, bypassed %4u (%3.0f%%), saved %7u B, %6u us in the compressor\n",
+		codec,
+		payload,
+		attempts,
+		bypasses,
+		attempts + bypasses ? bypasses * 100.0 / (attempts + bypasses) : 0.0,
+		host->totalCompressionSavedData,
+		host->totalCompressionTime);
+}
+
+static int bypass_run (bool lz, int payload)
+{
+	const char* codec = lz ? "fast lz" : "range coder";
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("bypass: could not create hosts\n");
+
+		return 1;
+	}
+
+	if (lz)
+	{
+		enet_host_compress_with_fast_lz (server);
+		enet_host_compress_with_fast_lz (client);
+	}
+	else
+	{
+		enet_host_compress_with_range_coder (server);
+		enet_host_compress_with_range_coder (client);
+	}
+
+	ENetAddress address = bench_server_address (server);
+	ENetPeer* peer = enet_host_connect (client, &address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("bypass: could not connect\n");
+
+		return 1;
+	}
+
+	client->totalCompressedDatagrams = 0;
+	client->totalCompressionBypasses = 0;
+	client->totalCompressionSavedData = 0;
+	client->totalCompressionTime = 0;
+
+	for (int iter = 0; iter < BYPASS_DATAGRAM_COUNT; iter++)
+	{
+		bool random = payload == BYPASS_PAYLOAD_RANDOM
+			|| (payload == BYPASS_PAYLOAD_ALTERNATING && (iter / BYPASS_PHASE_LENGTH) % 2 == 0);
+		ENetPacket* packet = enet_packet_create (NULL, BYPASS_PACKET_SIZE, 0);
+
+		if (!packet)
+		{
+			printf ("bypass: could not create a packet\n");
+
+			return 1;
+		}
+
+		for (size_t byte = 0; byte < BYPASS_PACKET_SIZE; byte++)
+		{
+			packet->data[byte] = random ? (enet_uint8) rand () : (enet_uint8) "the quick brown fox jumps over the lazy dog "[byte % 44];
+		}
+
+		if (enet_peer_send (peer, 0, packet) < 0)
+		{
+			enet_packet_destroy (packet);
+			printf ("bypass: could not send a packet\n");
+
+			return 1;
+		}
+
+		enet_host_flush (client);
+		bench_drain (server);
+
+		if (payload == BYPASS_PAYLOAD_ALTERNATING && (iter + 1) % BYPASS_PHASE_LENGTH == 0)
+		{
+			char phase[32];
+
+			snprintf (phase, sizeof (phase), "%s %i-%i", random ? "random" : "text", iter + 1 - BYPASS_PHASE_LENGTH, iter);
+			bypass_print (codec, phase, client);
+
+			client->totalCompressedDatagrams = 0;
+			client->totalCompressionBypasses = 0;
+			client->totalCompressionSavedData = 0;
+			client->totalCompressionTime = 0;
+		}
+	}
+
+	if (payload != BYPASS_PAYLOAD_ALTERNATING)
+	{
+		bypass_print (codec, bypass_payload_names[payload], client);
+	}
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	return 0;
+}
+
+int main (void)
+{
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("bypass: could not initialize enet\n");
+
+		return 1;
+	}
+
+	for (int lz = 0; lz < 2; lz++)
+	{
+		for (int payload = BYPASS_PAYLOAD_RANDOM; payload <= BYPASS_PAYLOAD_ALTERNATING; payload++)
+		{
+			result |= bypass_run (lz, payload);
+		}
+	}
+
+	enet_deinitialize ();
+
+	return result;
+}
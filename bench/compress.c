@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*
+ * compression ratio and speed of the range coder and the fast lz codec on the demo's traffic
+ *
+ * a server and three clients exchange the demo's packets over loopback
+ * 	and every datagram the hosts receive is recorded
+ * the recording is then replayed through both codecs, and every compressed datagram is
+ * 	decompressed again and checked against the original
+ *
+ * the fast lz codec also runs primed with dictionaries of a few sizes, which
+ * 	enet_lz_train_dictionary builds from the first half of the recording
+ * 	every codec is measured on the second half only, so none sees its training data
+ *
+ * a burst is how many packets the server queues for each client per tick
+ * 	bigger bursts make bigger datagrams, with more repetition for the codecs to find
+ */
+
+#define COMPRESS_CLIENT_COUNT 3
+#define COMPRESS_TICK_COUNT 1000
+#define COMPRESS_RECORD_CAPACITY 20000
+// replay the recording this many times when timing, so each measurement runs long enough
+#define COMPRESS_REPEAT_COUNT 20
+#define COMPRESS_RANDOM_SIZE 300
+
+typedef struct compress_record_s
+{
+	size_t length;
+	enet_uint8 data[ENET_PROTOCOL_MAXIMUM_MTU];
+} Compress_record;
+
+typedef struct compress_codec_s
+{
+	const char* name;
+	void* (* create) (void);
+	void (* destroy) (void*);
+	size_t (* compress) (void*, const ENetBuffer*, size_t, size_t, enet_uint8*, size_t);
+	size_t (* decompress) (void*, const enet_uint8*, size_t, enet_uint8*, size_t);
+	// when not 0, the codec is created with enet_lz_create_with_dictionary and a dictionary this big
+	size_t dictionary_size;
+} Compress_codec;
+
+static const Compress_codec compress_codecs[] =
+{
+	{"range coder", enet_range_coder_create, enet_range_coder_destroy, enet_range_coder_compress, enet_range_coder_decompress, 0},
+	{"fast lz", enet_lz_create, enet_lz_destroy, enet_lz_compress, enet_lz_decompress, 0},
+	{"lz+1K", NULL, enet_lz_destroy, enet_lz_compress, enet_lz_decompress, 1024},
+	{"lz+4K", NULL, enet_lz_destroy, enet_lz_compress, enet_lz_decompress, 4096},
+	{"lz+16K", NULL, enet_lz_destroy, enet_lz_compress, enet_lz_decompress, 16384}
+};
+
+static Compress_record* compress_records;
+static size_t compress_record_count;
+// records before this one are the training half, the codecs are measured on the rest
+static size_t compress_measure_first;
+
+// records every datagram a host receives, without the protocol header, which is what a compressor would see
+// 	returns 0 so the host goes on to handle it as usual
+static int ENET_CALLBACK compress_record (ENetHost* host, ENetEvent* event)
+{
+	(void) event;
+
+	size_t header_size = sizeof (ENetProtocolHeader);
+
+	if (host->receivedDataLength < header_size)
+	{
+		return 0;
+	}
+
+	if (!(ENET_NET_TO_HOST_16 (((ENetProtocolHeader*) host->receivedData)->peerID) & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME))
+	{
+		header_size = (size_t) &((ENetProtocolHeader*) 0)->sentTime;
+	}
+
+	if (compress_record_count >= COMPRESS_RECORD_CAPACITY
+		|| host->receivedDataLength - header_size > ENET_PROTOCOL_MAXIMUM_MTU)
+	{
+		return 0;
+	}
+
+	Compress_record* record = &compress_records[compress_record_count++];
+
+	record->length = host->receivedDataLength - header_size;
+	memcpy (record->data, &host->receivedData[header_size], record->length);
+
+	return 0;
+}
+
+// the demo's packets, a type byte followed by an int
+static void compress_send (ENetPeer* peer, ENetHost* host, enet_uint8 type, int value)
+{
+	enet_uint8 data[1 + sizeof (int)];
+
+	data[0] = type;
+	memcpy (&data[1], &value, sizeof (int));
+
+	ENetPacket* packet = enet_packet_create (data, sizeof (data), ENET_PACKET_FLAG_RELIABLE);
+
+	if (!packet)
+	{
+		return;
+	}
+
+	if (peer)
+	{
+		if (enet_peer_send (peer, 0, packet) < 0)
+		{
+			enet_packet_destroy (packet);
+		}
+	}
+	else
+	{
+		enet_host_broadcast (host, 0, packet);
+	}
+}
+
+static bool compress_record_traffic (int burst)
+{
+	ENetEvent event;
+	ENetHost* server = bench_create_server (COMPRESS_CLIENT_COUNT, 1);
+	ENetHost* clients[COMPRESS_CLIENT_COUNT];
+	ENetPeer* client_peers[COMPRESS_CLIENT_COUNT];
+	ENetPeer* server_peers[COMPRESS_CLIENT_COUNT];
+	int server_peer_count = 0;
+
+	if (!server)
+	{
+		return false;
+	}
+
+	ENetAddress address = bench_server_address (server);
+
+	for (int iter = 0; iter < COMPRESS_CLIENT_COUNT; iter++)
+	{
+		clients[iter] = enet_host_create (NULL, 1, 1, 0, 0);
+		if (!clients[iter])
+		{
+			return false;
+		}
+
+		client_peers[iter] = enet_host_connect (clients[iter], &address, 1, 0);
+		if (!client_peers[iter])
+		{
+			return false;
+		}
+
+		while (server_peer_count <= iter)
+		{
+			if (!bench_wait_for_connects (server, clients[iter], 1))
+			{
+				return false;
+			}
+
+			server_peers[server_peer_count] = &server->peers[server_peer_count];
+			server_peer_count++;
+		}
+	}
+
+	// only record the demo's own traffic, not the handshakes
+	server->intercept = compress_record;
+	for (int iter = 0; iter < COMPRESS_CLIENT_COUNT; iter++)
+	{
+		clients[iter]->intercept = compress_record;
+	}
+
+	compress_record_count = 0;
+
+	for (int tick = 0; tick < COMPRESS_TICK_COUNT; tick++)
+	{
+		for (int iter = 0; iter < COMPRESS_CLIENT_COUNT; iter++)
+		{
+			compress_send (client_peers[iter], NULL, tick % 2 ? 1 : 2, rand () % 1000);
+		}
+
+		for (int packet = 0; packet < burst; packet++)
+		{
+			compress_send (NULL, server, 4, tick * burst + packet);
+			compress_send (server_peers[(tick + packet) % COMPRESS_CLIENT_COUNT], NULL, 3, rand () % 100000);
+		}
+
+		for (int iter = 0; iter < COMPRESS_CLIENT_COUNT; iter++)
+		{
+			bench_drain (clients[iter]);
+		}
+
+		bench_drain (server);
+	}
+
+	while (enet_host_service (server, &event, 10) > 0)
+	{
+	}
+
+	for (int iter = 0; iter < COMPRESS_CLIENT_COUNT; iter++)
+	{
+		enet_host_destroy (clients[iter]);
+	}
+
+	enet_host_destroy (server);
+
+	return compress_record_count > 0;
+}
+
+// trains a dictionary on the first half of the recording and primes an lz context with it
+static void* compress_create_primed (size_t dictionary_size, double* train_time)
+{
+	static enet_uint8 dictionary[ENET_HOST_COMPRESSION_DICTIONARY_MAXIMUM];
+	ENetBuffer* samples = malloc (compress_measure_first * sizeof (ENetBuffer));
+
+	if (!samples)
+	{
+		return NULL;
+	}
+
+	for (size_t iter = 0; iter < compress_measure_first; iter++)
+	{
+		samples[iter].data = compress_records[iter].data;
+		samples[iter].dataLength = compress_records[iter].length;
+	}
+
+	double start = bench_now ();
+	size_t length = enet_lz_train_dictionary (samples, compress_measure_first, dictionary, dictionary_size);
+
+	*train_time = bench_now () - start;
+	free (samples);
+
+	return enet_lz_create_with_dictionary (dictionary, length);
+}
+
+static bool compress_replay (const Compress_codec* codec, const char* traffic)
+{
+	static enet_uint8 compressed[ENET_PROTOCOL_MAXIMUM_MTU];
+	static enet_uint8 decompressed[ENET_PROTOCOL_MAXIMUM_MTU];
+	double train_time = 0.0;
+	void* context = codec->dictionary_size ? compress_create_primed (codec->dictionary_size, &train_time) : codec->create ();
+	size_t measured_count = compress_record_count - compress_measure_first;
+	size_t original_bytes = 0;
+	size_t sent_bytes = 0;
+	size_t compressed_count = 0;
+
+	if (!context)
+	{
+		return false;
+	}
+
+	// ratio and round trip, a datagram that does not shrink is sent as it is
+	for (size_t iter = compress_measure_first; iter < compress_record_count; iter++)
+	{
+		Compress_record* record = &compress_records[iter];
+		ENetBuffer buffer =
+		{
+			.data = record->data,
+			.dataLength = record->length
+		};
+		size_t length = codec->compress (context, &buffer, 1, record->length, compressed, record->length);
+
+		original_bytes += record->length;
+
+		if (length == 0 || length >= record->length)
+		{
+			sent_bytes += record->length;
+
+			continue;
+		}
+
+		sent_bytes += length;
+		compressed_count++;
+
+		if (codec->decompress (context, compressed, length, decompressed, sizeof (decompressed)) != record->length
+			|| memcmp (decompressed, record->data, record->length) != 0)
+		{
+			printf ("compress: %s did not round trip datagram %zu\n", codec->name, iter);
+			codec->destroy (context);
+
+			return false;
+		}
+	}
+
+	// speed
+	double start = bench_now ();
+
+	for (int repeat = 0; repeat < COMPRESS_REPEAT_COUNT; repeat++)
+	{
+		for (size_t iter = compress_measure_first; iter < compress_record_count; iter++)
+		{
+			ENetBuffer buffer =
+			{
+				.data = compress_records[iter].data,
+				.dataLength = compress_records[iter].length
+			};
+
+			codec->compress (context, &buffer, 1, buffer.dataLength, compressed, buffer.dataLength);
+		}
+	}
+
+	double compress_time = bench_now () - start;
+	double decompress_time = 0.0;
+	size_t decompressed_bytes = 0;
+
+	for (size_t iter = compress_measure_first; iter < compress_record_count; iter++)
+	{
+		ENetBuffer buffer =
+		{
+			.data = compress_records[iter].data,
+			.dataLength = compress_records[iter].length
+		};
+		size_t length = codec->compress (context, &buffer, 1, buffer.dataLength, compressed, buffer.dataLength);
+
+		if (length == 0 || length >= buffer.dataLength)
+		{
+			continue;
+		}
+
+		start = bench_now ();
+
+		for (int repeat = 0; repeat < COMPRESS_REPEAT_COUNT; repeat++)
+		{
+			codec->decompress (context, compressed, length, decompressed, sizeof (decompressed));
+		}
+
+		decompress_time += bench_now () - start;
+		decompressed_bytes += buffer.dataLength * COMPRESS_REPEAT_COUNT;
+	}
+
+	char decompress_speed[32] = "n/a";
+
+	if (decompress_time > 0.0)
+	{
+		snprintf (decompress_speed, sizeof (decompress_speed), "%.0f MB/s", (double) decompressed_bytes / decompress_time / 1e6);
+	}
+
+	char train[32] = "";
+
+	if (codec->dictionary_size)
+	{
+		snprintf (train, sizeof (train), ", trained in %.0f ms", train_time * 1e3);
+	}
+
+	printf ("%-12s %-10s %6.0f B avg: %3zu%% shrunk, sent %5.1f%%, compress %6.0f MB/s, decompress %s%s\n",
+		codec->name,
+		traffic,
+		(double) original_bytes / (double) measured_count,
+		compressed_count * 100 / measured_count,
+		(double) sent_bytes * 100.0 / (double) original_bytes,
+		(double) original_bytes * COMPRESS_REPEAT_COUNT / compress_time / 1e6,
+		decompress_speed,
+		train);
+
+	codec->destroy (context);
+
+	return true;
+}
+
+static bool compress_replay_all (const char* traffic)
+{
+	compress_measure_first = compress_record_count / 2;
+
+	for (size_t iter = 0; iter < sizeof (compress_codecs) / sizeof (compress_codecs[0]); iter++)
+	{
+		if (!compress_replay (&compress_codecs[iter], traffic))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main (void)
+{
+	static const int bursts[] = {1, 8, 40};
+	char traffic[32];
+
+	if (enet_initialize () != 0)
+	{
+		printf ("compress: could not initialize enet\n");
+
+		return 1;
+	}
+
+	compress_records = malloc (COMPRESS_RECORD_CAPACITY * sizeof (Compress_record));
+	if (!compress_records)
+	{
+		return 1;
+	}
+
+	for (size_t iter = 0; iter < sizeof (bursts) / sizeof (bursts[0]); iter++)
+	{
+		if (!compress_record_traffic (bursts[iter]))
+		{
+			printf ("compress: could not record traffic\n");
+
+			return 1;
+		}
+
+		snprintf (traffic, sizeof (traffic), "burst %i", bursts[iter]);
+
+		if (!compress_replay_all (traffic))
+		{
+			return 1;
+		}
+	}
+
+	// incompressible datagrams, how much time a codec wastes before giving up
+	compress_record_count = COMPRESS_RECORD_CAPACITY / 2;
+	for (size_t iter = 0; iter < compress_record_count; iter++)
+	{
+		compress_records[iter].length = COMPRESS_RANDOM_SIZE;
+
+		for (size_t byte = 0; byte < COMPRESS_RANDOM_SIZE; byte++)
+		{
+			compress_records[iter].data[byte] = (enet_uint8) rand ();
+		}
+	}
+
+	if (!compress_replay_all ("random"))
+	{
+		return 1;
+	}
+
+	free (compress_records);
+	enet_deinitialize ();
+
+	return 0;
+}
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/*
+ * a storm of connects against a big server over loopback
+ *
+ * one client host opens CONNECT_COUNT connections in batches of CONNECT_BATCH_SIZE, and the
+ * 	server's enet_host_service time is summed over the whole storm
+ * then every peer is reset on both sides and the storm runs again, like clients reconnecting
+ * 	after a server restart
+ * last, duplicatePeers is set to 3 and six more connections come from the same address,
+ * 	of which exactly three must get in
+ *
+ * usage: enet_bench_connect [connections]
+ */
+
+#define CONNECT_SLOT_COUNT ENET_PROTOCOL_MAXIMUM_PEER_ID
+#define CONNECT_DEFAULT_COUNT 3000
+#define CONNECT_BATCH_SIZE 50
+#define CONNECT_ROUNDS 2
+#define CONNECT_DUPLICATE_LIMIT 3
+#define CONNECT_DUPLICATE_ATTEMPTS 6
+// how long the duplicate connections get to settle, in seconds
+#define CONNECT_DUPLICATE_TIME 1.5
+#define CONNECT_TIMEOUT 30.0
+
+static bool connect_storm (ENetHost* server, ENetHost* client, const ENetAddress* address, int count, double* service_time)
+{
+	ENetEvent event;
+	int connected = 0;
+	int started = 0;
+	double start = bench_now ();
+
+	*service_time = 0.0;
+
+	while (connected < count)
+	{
+		for (int iter = 0; iter < CONNECT_BATCH_SIZE && started < count; iter++, started++)
+		{
+			if (!enet_host_connect (client, address, 1, 0))
+			{
+				printf ("connect: could not start connection %i\n", started);
+
+				return false;
+			}
+		}
+
+		double service_start = bench_now ();
+
+		while (enet_host_service (server, &event, 0) > 0)
+		{
+			if (event.type == ENET_EVENT_TYPE_CONNECT)
+			{
+				connected++;
+			}
+		}
+
+		*service_time += bench_now () - service_start;
+
+		while (enet_host_service (client, &event, 0) > 0)
+		{
+			if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+			{
+				printf ("connect: a client connection failed\n");
+
+				return false;
+			}
+		}
+
+		if (bench_now () - start > CONNECT_TIMEOUT)
+		{
+			printf ("connect: only %i of %i connected\n", connected, count);
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static int connect_duplicates (ENetHost* server, ENetHost* client, const ENetAddress* address)
+{
+	ENetEvent event;
+	int connected = 0;
+
+	server->duplicatePeers = CONNECT_DUPLICATE_LIMIT;
+
+	for (int iter = 0; iter < CONNECT_DUPLICATE_ATTEMPTS; iter++)
+	{
+		enet_host_connect (client, address, 1, 0);
+	}
+
+	double start = bench_now ();
+
+	while (bench_now () - start < CONNECT_DUPLICATE_TIME)
+	{
+		while (enet_host_service (server, &event, 1) > 0)
+		{
+			if (event.type == ENET_EVENT_TYPE_CONNECT)
+			{
+				connected++;
+			}
+		}
+
+		bench_drain (client);
+	}
+
+	return connected;
+}
+
+int main (int argc, char** argv)
+{
+	int count = argc > 1 ? atoi (argv[1]) : CONNECT_DEFAULT_COUNT;
+
+	if (count < 1 || count > CONNECT_SLOT_COUNT - CONNECT_DUPLICATE_ATTEMPTS)
+	{
+		printf ("usage: %s [connections]\n", argv[0]);
+
+		return 1;
+	}
+
+	if (enet_initialize () != 0)
+	{
+		printf ("connect: could not initialize enet\n");
+
+		return 1;
+	}
+
+	ENetHost* server = bench_create_server (CONNECT_SLOT_COUNT, 1);
+	ENetHost* client = enet_host_create (NULL, CONNECT_SLOT_COUNT, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("connect: could not create hosts\n");
+
+		return 1;
+	}
+
+	ENetAddress address = bench_server_address (server);
+
+	for (int round = 0; round < CONNECT_ROUNDS; round++)
+	{
+		double service_time;
+
+		if (!connect_storm (server, client, &address, count, &service_time))
+		{
+			return 1;
+		}
+
+		printf ("%s: %i connects, server service time %.1f ms, %.2f us per connect\n",
+			round == 0 ? "storm" : "reconnect storm",
+			count,
+			service_time * 1e3,
+			service_time * 1e6 / count);
+
+		for (size_t iter = 0; iter < client->peerCount; iter++)
+		{
+			enet_peer_reset (&client->peers[iter]);
+		}
+
+		for (size_t iter = 0; iter < server->peerCount; iter++)
+		{
+			enet_peer_reset (&server->peers[iter]);
+		}
+	}
+
+	int duplicates = connect_duplicates (server, client, &address);
+
+	printf ("duplicatePeers %i: %i of %i connections from one address got in\n",
+		CONNECT_DUPLICATE_LIMIT,
+		duplicates,
+		CONNECT_DUPLICATE_ATTEMPTS);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+	enet_deinitialize ();
+
+	return duplicates != CONNECT_DUPLICATE_LIMIT;
+}
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/*
+ * checksum throughput on datagram sized buffers
+ *
+ * enet_crc32 and enet_crc32c run whichever kernels enet_initialize picked for this cpu
+ * 	they are compared against a plain byte at a time crc, which is also what checks their results
+ */
+
+#define CRC_BUFFER_SIZE 65536
+// how many bytes each measurement checksums in total
+#define CRC_BYTES_PER_RUN (256 * 1024 * 1024)
+#define CRC_VERIFY_COUNT 20000
+#define CRC32_POLYNOMIAL 0xEDB88320
+#define CRC32C_POLYNOMIAL 0x82F63B78
+
+static enet_uint8 crc_data[CRC_BUFFER_SIZE];
+static enet_uint32 crc32_table[256];
+static enet_uint32 crc32c_table[256];
+
+static void crc_initialize_table (enet_uint32* table, enet_uint32 polynomial)
+{
+	for (enet_uint32 byte = 0; byte < 256; byte++)
+	{
+		enet_uint32 crc = byte;
+
+		for (int bit = 0; bit < 8; bit++)
+		{
+			crc = (crc >> 1) ^ (polynomial & (0 - (crc & 1)));
+		}
+
+		table[byte] = crc;
+	}
+}
+
+// the same result as enet_crc32 and enet_crc32c, in network byte order
+static enet_uint32 crc_bytewise (const enet_uint32* table, const ENetBuffer* buffers, size_t buffer_count)
+{
+	enet_uint32 crc = 0xFFFFFFFF;
+
+	for (size_t iter = 0; iter < buffer_count; iter++)
+	{
+		const enet_uint8* data = buffers[iter].data;
+
+		for (size_t byte = 0; byte < buffers[iter].dataLength; byte++)
+		{
+			crc = (crc >> 8) ^ table[(crc ^ data[byte]) & 0xFF];
+		}
+	}
+
+	return ENET_HOST_TO_NET_32 (~crc);
+}
+
+static enet_uint32 crc32_bytewise (const ENetBuffer* buffers, size_t buffer_count)
+{
+	return crc_bytewise (crc32_table, buffers, buffer_count);
+}
+
+static bool crc_verify (void)
+{
+	ENetBuffer check =
+	{
+		.data = "123456789",
+		.dataLength = 9
+	};
+
+	// the standard check values of both polynomials
+	if (ENET_NET_TO_HOST_32 (enet_crc32 (&check, 1)) != 0xCBF43926
+		|| ENET_NET_TO_HOST_32 (enet_crc32c (&check, 1)) != 0xE3069283)
+	{
+		printf ("crc: wrong check value\n");
+
+		return false;
+	}
+
+	// random scatter lists, short buffers as well as long ones, at every alignment
+	for (int iter = 0; iter < CRC_VERIFY_COUNT; iter++)
+	{
+		ENetBuffer buffers[5];
+		size_t buffer_count = 1 + rand () % 5;
+
+		for (size_t buffer = 0; buffer < buffer_count; buffer++)
+		{
+			buffers[buffer].data = &crc_data[rand () % (CRC_BUFFER_SIZE / 2)];
+			buffers[buffer].dataLength = rand () % (rand () % 2 ? 2000 : 40);
+		}
+
+		if (enet_crc32 (buffers, buffer_count) != crc_bytewise (crc32_table, buffers, buffer_count)
+			|| enet_crc32c (buffers, buffer_count) != crc_bytewise (crc32c_table, buffers, buffer_count))
+		{
+			printf ("crc: mismatch against the bytewise crc on input %i\n", iter);
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// returns gigabytes per second
+static double crc_measure (enet_uint32 (* checksum) (const ENetBuffer*, size_t), size_t length)
+{
+	ENetBuffer buffer =
+	{
+		.data = crc_data,
+		.dataLength = length
+	};
+	long count = CRC_BYTES_PER_RUN / (long) length;
+	// keeps the compiler from dropping the calls
+	volatile enet_uint32 result = 0;
+	double start = bench_now ();
+
+	for (long iter = 0; iter < count; iter++)
+	{
+		result ^= checksum (&buffer, 1);
+	}
+
+	(void) result;
+
+	return (double) count * (double) length / (bench_now () - start) / 1e9;
+}
+
+int main (void)
+{
+	static const size_t lengths[] = {64, 576, 1200, 1400, 4096, 8972, 65536};
+
+	if (enet_initialize () != 0)
+	{
+		printf ("crc: could not initialize enet\n");
+
+		return 1;
+	}
+
+	crc_initialize_table (crc32_table, CRC32_POLYNOMIAL);
+	crc_initialize_table (crc32c_table, CRC32C_POLYNOMIAL);
+
+	for (size_t iter = 0; iter < CRC_BUFFER_SIZE; iter++)
+	{
+		crc_data[iter] = (enet_uint8) rand ();
+	}
+
+	if (!crc_verify ())
+	{
+		return 1;
+	}
+
+	printf ("results match the bytewise crc\n");
+	printf ("%8s %12s %12s %12s\n", "bytes", "bytewise", "enet_crc32", "enet_crc32c");
+
+	for (size_t iter = 0; iter < sizeof (lengths) / sizeof (lengths[0]); iter++)
+	{
+		printf ("%8zu %7.2f GB/s %7.2f GB/s %7.2f GB/s\n",
+			lengths[iter],
+			crc_measure (crc32_bytewise, lengths[iter]),
+			crc_measure (enet_crc32, lengths[iter]),
+			crc_measure (enet_crc32c, lengths[iter]));
+	}
+
+	enet_deinitialize ();
+
+	return 0;
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/*
+ * floods a small server with forged connects from one socket, then tries to connect a real client
+ *
+ * without connect cookies every forged connect claims a peer slot until it times out
+ * 	so the real client finds the server full
+ * with cookies the server only answers the forged connects, and the real client gets in
+ */
+
+#define FLOOD_PEER_COUNT 64
+#define FLOOD_CONNECT_COUNT 500
+// how long the real client gets to connect, in seconds
+#define FLOOD_CONNECT_TIMEOUT 2.0
+
+static void flood_send_connects (ENetSocket socket, const ENetAddress* address)
+{
+	for (int iter = 0; iter < FLOOD_CONNECT_COUNT; iter++)
+	{
+		// a bare header, no sent time and no checksum, followed by the connect
+		enet_uint16 peer_id = ENET_HOST_TO_NET_16 (ENET_PROTOCOL_MAXIMUM_PEER_ID);
+		ENetProtocolConnect connect =
+		{
+			.header =
+			{
+				.command = ENET_PROTOCOL_COMMAND_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE,
+				.channelID = 0xFF,
+				.reliableSequenceNumber = ENET_HOST_TO_NET_16 (1)
+			},
+			.outgoingPeerID = ENET_HOST_TO_NET_16 (iter % FLOOD_PEER_COUNT),
+			.incomingSessionID = 0xFF,
+			.outgoingSessionID = 0xFF,
+			.mtu = ENET_HOST_TO_NET_32 (ENET_HOST_DEFAULT_MTU),
+			.windowSize = ENET_HOST_TO_NET_32 (ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE),
+			.channelCount = ENET_HOST_TO_NET_32 (1),
+			.packetThrottleInterval = ENET_HOST_TO_NET_32 (ENET_PEER_PACKET_THROTTLE_INTERVAL),
+			.packetThrottleAcceleration = ENET_HOST_TO_NET_32 (ENET_PEER_PACKET_THROTTLE_ACCELERATION),
+			.packetThrottleDeceleration = ENET_HOST_TO_NET_32 (ENET_PEER_PACKET_THROTTLE_DECELERATION),
+			// every forged connect looks like a different client
+			.connectID = (enet_uint32) rand ()
+		};
+		ENetBuffer buffers[2] =
+		{
+			{ .data = &peer_id, .dataLength = sizeof (peer_id) },
+			{ .data = &connect, .dataLength = sizeof (connect) }
+		};
+
+		enet_socket_send (socket, address, buffers, 2);
+	}
+}
+
+static int flood_run (bool cookies, bool checksum)
+{
+	ENetEvent event;
+	ENetHost* server = bench_create_server (FLOOD_PEER_COUNT, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+	ENetSocket socket = enet_socket_create (ENET_SOCKET_TYPE_DATAGRAM);
+
+	if (!server || !client || socket == ENET_SOCKET_NULL)
+	{
+		printf ("flood: could not create hosts\n");
+
+		return 1;
+	}
+
+	enet_host_connect_cookies (server, cookies);
+
+	if (checksum)
+	{
+		server->checksum = enet_crc32;
+		client->checksum = enet_crc32;
+	}
+
+	ENetAddress address = bench_server_address (server);
+
+	flood_send_connects (socket, &address);
+
+	// let the server take in the whole flood
+	for (int iter = 0; iter < 20; iter++)
+	{
+		while (enet_host_service (server, &event, 1) > 0)
+		{
+		}
+	}
+
+	int claimed = 0;
+
+	for (size_t iter = 0; iter < server->peerCount; iter++)
+	{
+		if (server->peers[iter].state != ENET_PEER_STATE_DISCONNECTED)
+		{
+			claimed++;
+		}
+	}
+
+	bool connected = enet_host_connect (client, &address, 1, 0) != NULL;
+	bool server_connected = false;
+	bool client_connected = false;
+	double start = bench_now ();
+
+	while (connected
+		&& !(server_connected && client_connected)
+		&& bench_now () - start < FLOOD_CONNECT_TIMEOUT)
+	{
+		while (enet_host_service (client, &event, 0) > 0)
+		{
+			client_connected |= event.type == ENET_EVENT_TYPE_CONNECT;
+		}
+
+		while (enet_host_service (server, &event, 1) > 0)
+		{
+			// the forged peers never send their verify, so only the real client connects
+			server_connected |= event.type == ENET_EVENT_TYPE_CONNECT;
+		}
+	}
+
+	connected = server_connected && client_connected;
+
+	printf ("cookies %s, checksum %s: %i forged connects claimed %i/%i slots, the real client %s, server sent %u datagrams\n",
+		cookies ? "on" : "off",
+		checksum ? "on" : "off",
+		FLOOD_CONNECT_COUNT,
+		claimed,
+		FLOOD_PEER_COUNT,
+		connected ? "connected" : "could not connect",
+		server->totalSentPackets);
+
+	enet_socket_destroy (socket);
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	// with cookies on the flood must not get in the way
+	return cookies && (claimed > 0 || !connected);
+}
+
+int main (void)
+{
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("flood: could not initialize enet\n");
+
+		return 1;
+	}
+
+	result |= flood_run (false, false);
+	result |= flood_run (true, false);
+	// the forged connects carry no checksum, so these are dropped before the cookies even come into it
+	result |= flood_run (true, true);
+
+	enet_deinitialize ();
+
+	return result;
+}
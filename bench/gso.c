@@ -0,0 +1,110 @@
+#include <stdio.h>
+
+#include "bench.h"
+
+/*
+ * bulk reliable transfer over loopback, with and without udp segmentation offload
+ *
+ * the client queues GSO_PACKET_COUNT reliable packets of GSO_PACKET_SIZE bytes
+ * 	with the peer's window raised past the protocol maximum so the send pass has plenty staged
+ * 	and reports how many bytes each socket call moved
+ */
+
+#define GSO_PACKET_COUNT 50
+#define GSO_PACKET_SIZE (1024 * 1024)
+#define GSO_WINDOW_SIZE (1024 * 1024)
+// give up on a run after this many seconds
+#define GSO_TIMEOUT 60.0
+
+static int gso_run (enet_uint32 offload)
+{
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("gso: could not create hosts\n");
+
+		return 1;
+	}
+
+	enet_uint32 server_offload = enet_host_segmentation_offload (server, offload);
+	enet_uint32 client_offload = enet_host_segmentation_offload (client, offload);
+
+	ENetAddress address = bench_server_address (server);
+	ENetPeer* peer = enet_host_connect (client, &address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("gso: could not connect\n");
+
+		return 1;
+	}
+
+	// the window is only checked by the sender, so raising it after connecting is enough
+	peer->windowSize = GSO_WINDOW_SIZE;
+
+	for (int iter = 0; iter < GSO_PACKET_COUNT; iter++)
+	{
+		ENetPacket* packet = enet_packet_create (NULL, GSO_PACKET_SIZE, ENET_PACKET_FLAG_RELIABLE);
+
+		if (!packet
+			|| enet_peer_send (peer, 0, packet) < 0)
+		{
+			printf ("gso: could not queue packet %i\n", iter);
+
+			return 1;
+		}
+	}
+
+	client->totalSentData = 0;
+	client->totalSendCalls = 0;
+	server->totalReceivedData = 0;
+	server->totalReceiveCalls = 0;
+
+	size_t received = 0;
+	double start = bench_now ();
+
+	while (received < (size_t) GSO_PACKET_COUNT * GSO_PACKET_SIZE
+		&& bench_now () - start < GSO_TIMEOUT)
+	{
+		bench_drain (client);
+		received += bench_drain (server);
+	}
+
+	double elapsed = bench_now () - start;
+
+	printf ("offload send %s, receive %s: %zu bytes in %.2f s (%.1f MB/s), %.0f bytes per send call, %.0f bytes per receive call\n",
+		client_offload & ENET_SEGMENTATION_OFFLOAD_SEND ? "on" : "off",
+		server_offload & ENET_SEGMENTATION_OFFLOAD_RECEIVE ? "on" : "off",
+		received,
+		elapsed,
+		(double) received / elapsed / 1e6,
+		client->totalSendCalls ? (double) client->totalSentData / client->totalSendCalls : 0.0,
+		server->totalReceiveCalls ? (double) server->totalReceivedData / server->totalReceiveCalls : 0.0);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	return received < (size_t) GSO_PACKET_COUNT * GSO_PACKET_SIZE;
+}
+
+int main (void)
+{
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("gso: could not initialize enet\n");
+
+		return 1;
+	}
+
+	result |= gso_run (0);
+	result |= gso_run (ENET_SEGMENTATION_OFFLOAD_SEND | ENET_SEGMENTATION_OFFLOAD_RECEIVE);
+
+	enet_deinitialize ();
+
+	return result;
+}
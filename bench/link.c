@@ -0,0 +1,297 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "bench.h"
+#include "relay.h"
+
+/*
+ * bulk reliable transfer through a relay that emulates a slow, distant link
+ *
+ * the client keeps LINK_QUEUE_DEPTH packets queued for the whole run, so the bottleneck
+ * 	stays full and a queue builds in its buffer
+ * reports goodput, the mean round trip time, the commands the client retransmitted and
+ * 	the datagrams the relay really dropped, retransmits past those are spurious
+ *
+ * a polling client services its host after every short sleep, a blocking one waits in
+ * 	enet_host_service for up to LINK_BLOCKING_WAIT ms and the server runs on its own thread,
+ * 	so anything the host wants to send between wakeups has to come from its own deadlines
+ *
+ * usage: enet_bench_link [throttle|cubic|bbr] [rate MB/s] [rtt ms] [buffer KB] [loss %] [seconds] [blocking]
+ * 	without arguments every controller runs a few links, then the paced controllers run a
+ * 	fast link with a shallow buffer both ways
+ */
+
+#define LINK_PACKET_SIZE 1200
+#define LINK_QUEUE_DEPTH 512
+#define LINK_DEFAULT_SECONDS 5.0
+#define LINK_SAMPLE_INTERVAL 0.5
+#define LINK_BLOCKING_WAIT 20
+
+typedef enum
+{
+	LINK_CONTROLLER_THROTTLE,
+	LINK_CONTROLLER_CUBIC,
+	LINK_CONTROLLER_BBR,
+	LINK_CONTROLLER_COUNT
+} Link_controller;
+
+static const char* link_controller_names[] = {"throttle", "cubic", "bbr"};
+
+typedef struct link_s
+{
+	double rate;
+	double round_trip_time;
+	double buffer;
+	double loss;
+} Link;
+
+typedef struct link_server_s
+{
+	ENetHost* host;
+	atomic_llong received;
+	atomic_bool stop;
+} Link_server;
+
+static void* link_server_thread (void* data)
+{
+	Link_server* server = data;
+	ENetEvent event;
+
+	while (!atomic_load (&server->stop))
+	{
+		while (enet_host_service (server->host, &event, 1) > 0)
+		{
+			if (event.type == ENET_EVENT_TYPE_RECEIVE)
+			{
+				atomic_fetch_add (&server->received, (long long) event.packet->dataLength);
+				enet_packet_destroy (event.packet);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static int link_run (Link_controller controller, const Link* link, double seconds, bool blocking)
+{
+	static enet_uint8 data[LINK_PACKET_SIZE];
+	Relay relay =
+	{
+		.rate = link->rate,
+		.delay = link->round_trip_time / 2,
+		.buffer = link->buffer,
+		.loss = link->loss
+	};
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("link: could not create hosts\n");
+
+		return 1;
+	}
+
+	relay.server_address = bench_server_address (server);
+	if (!relay_start (&relay))
+	{
+		printf ("link: could not start the relay\n");
+
+		return 1;
+	}
+
+	switch (controller)
+	{
+		case LINK_CONTROLLER_CUBIC:
+			enet_host_congestion_control_with_cubic (client);
+			break;
+		case LINK_CONTROLLER_BBR:
+			enet_host_congestion_control_with_bbr (client);
+			break;
+		default:
+			break;
+	}
+
+	ENetPeer* peer = enet_host_connect (client, &relay.address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("link: could not connect\n");
+		relay_stop (&relay);
+
+		return 1;
+	}
+
+	Link_server link_server =
+	{
+		.host = server
+	};
+	pthread_t server_thread;
+
+	atomic_init (&link_server.received, 0);
+	atomic_init (&link_server.stop, false);
+
+	if (blocking
+		&& pthread_create (&server_thread, NULL, link_server_thread, &link_server))
+	{
+		printf ("link: could not start the server thread\n");
+		relay_stop (&relay);
+
+		return 1;
+	}
+
+	size_t received = 0;
+	double round_trip_sum = 0.0;
+	int round_trip_samples = 0;
+	enet_uint32 packets_lost = peer->packetsLost;
+	double start = bench_now ();
+	double next_sample = start + LINK_SAMPLE_INTERVAL;
+
+	while (bench_now () - start < seconds)
+	{
+		while (enet_list_size (&peer->outgoingCommands) < LINK_QUEUE_DEPTH)
+		{
+			ENetPacket* packet = enet_packet_create (data, sizeof (data), ENET_PACKET_FLAG_RELIABLE);
+
+			if (!packet
+				|| enet_peer_send (peer, 0, packet) < 0)
+			{
+				printf ("link: could not queue a packet\n");
+				relay_stop (&relay);
+
+				return 1;
+			}
+		}
+
+		if (blocking)
+		{
+			ENetEvent event;
+
+			if (enet_host_service (client, &event, LINK_BLOCKING_WAIT) > 0
+				&& event.type == ENET_EVENT_TYPE_RECEIVE)
+			{
+				enet_packet_destroy (event.packet);
+			}
+		}
+		else
+		{
+			bench_drain (client);
+			received += bench_drain (server);
+			bench_sleep (50);
+		}
+
+		if (bench_now () >= next_sample)
+		{
+			round_trip_sum += peer->roundTripTimeMicroseconds;
+			round_trip_samples++;
+			next_sample += LINK_SAMPLE_INTERVAL;
+		}
+	}
+
+	if (blocking)
+	{
+		atomic_store (&link_server.stop, true);
+		pthread_join (server_thread, NULL);
+		received = (size_t) atomic_load (&link_server.received);
+	}
+
+	// the relay's counters are only safe to read once its thread is done
+	relay_stop (&relay);
+
+	printf ("%-8s %-8s link %5.1f MB/s, rtt %3.0f ms, %5.0f KB buffer, %3.1f%% loss: %6.2f MB/s, mean rtt %6.1f ms, %u retransmitted, %lld dropped by the relay\n",
+		link_controller_names[controller],
+		blocking ? "blocking" : "polling",
+		link->rate / 1e6,
+		link->round_trip_time * 1e3,
+		link->buffer / 1024,
+		link->loss * 100,
+		(double) received / seconds / 1e6,
+		round_trip_samples ? round_trip_sum / round_trip_samples / 1e3 : 0.0,
+		peer->packetsLost - packets_lost,
+		relay.dropped);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	return 0;
+}
+
+int main (int argc, char** argv)
+{
+	static const Link links[] =
+	{
+		{2e6, 0.020, 64 * 1024, 0.0},
+		{2e6, 0.020, 16 * 1024, 0.0},
+		{20e6, 0.002, 256 * 1024, 0.0},
+		{2e6, 0.020, 64 * 1024, 0.01}
+	};
+	static const Link paced_link = {20e6, 0.004, 16 * 1024, 0.0};
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("link: could not initialize enet\n");
+
+		return 1;
+	}
+
+	if (argc > 1)
+	{
+		Link_controller controller = LINK_CONTROLLER_COUNT;
+		Link link =
+		{
+			.rate = argc > 2 ? atof (argv[2]) * 1e6 : 2e6,
+			.round_trip_time = argc > 3 ? atof (argv[3]) / 1e3 : 0.020,
+			.buffer = argc > 4 ? atof (argv[4]) * 1024 : 64 * 1024,
+			.loss = argc > 5 ? atof (argv[5]) / 100 : 0.0
+		};
+		double seconds = argc > 6 ? atof (argv[6]) : LINK_DEFAULT_SECONDS;
+		bool blocking = argc > 7 && strcmp (argv[7], "blocking") == 0;
+
+		for (int iter = 0; iter < LINK_CONTROLLER_COUNT; iter++)
+		{
+			if (strcmp (argv[1], link_controller_names[iter]) == 0)
+			{
+				controller = iter;
+			}
+		}
+
+		if (controller == LINK_CONTROLLER_COUNT
+			|| link.rate <= 0.0
+			|| link.round_trip_time < 0.0
+			|| link.buffer <= 0.0
+			|| link.loss < 0.0
+			|| seconds <= 0.0)
+		{
+			printf ("usage: %s [throttle|cubic|bbr] [rate MB/s] [rtt ms] [buffer KB] [loss %%] [seconds] [blocking]\n", argv[0]);
+
+			return 1;
+		}
+
+		result = link_run (controller, &link, seconds, blocking);
+	}
+	else
+	{
+		for (size_t iter = 0; iter < sizeof (links) / sizeof (links[0]); iter++)
+		{
+			for (int controller = 0; controller < LINK_CONTROLLER_COUNT; controller++)
+			{
+				result |= link_run (controller, &links[iter], LINK_DEFAULT_SECONDS, false);
+			}
+		}
+
+		for (int controller = LINK_CONTROLLER_CUBIC; controller < LINK_CONTROLLER_COUNT; controller++)
+		{
+			result |= link_run (controller, &paced_link, LINK_DEFAULT_SECONDS, false);
+			result |= link_run (controller, &paced_link, LINK_DEFAULT_SECONDS, true);
+		}
+	}
+
+	enet_deinitialize ();
+
+	return result;
+}
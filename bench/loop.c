@@ -0,0 +1,526 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*
+ * end to end check of a server and a few clients over loopback
+ *
+ * every client sends a run of small reliable packets, one large fragmented reliable packet,
+ * 	small unreliable packets and one fragmented unreliable packet, the server broadcasts
+ * 	a large reliable packet back, then everyone disconnects
+ * reliable data must arrive complete and in order, and unreliable data too when nothing is lost
+ *
+ * usage: enet_test_loop [option]...
+ * 	loss             drop 10% of the datagrams each host receives
+ * 	range-coder      compress with the range coder
+ * 	crc32            checksum datagrams with enet_crc32
+ * 	crc32c           checksum datagrams with enet_crc32c
+ * 	batch            stage at most a few datagrams per send call
+ * 	offload          enable udp segmentation offload where the system has it
+ * 	lz               compress with the fast lz codec
+ * 	dictionary       compress with the fast lz codec primed with the same dictionary on every host
+ * 	old-client       clients offer no protocol capabilities, like hosts that predate them
+ * 	old-server       the server offers no protocol capabilities
+ * 	cubic            use the cubic congestion controller
+ * 	bbr              use the bbr congestion controller
+ * 	probe-mtu        probe the path mtu up to ENET_PROTOCOL_MAXIMUM_MTU
+ *
+ * prints LOOP OK and exits with 0 when every check passed
+ */
+
+#define LOOP_CLIENT_COUNT 4
+#define LOOP_SMALL_COUNT 100
+#define LOOP_SMALL_SIZE 50
+#define LOOP_BIG_SIZE 200000
+#define LOOP_BROADCAST_SIZE (LOOP_BIG_SIZE / 2)
+#define LOOP_UNRELIABLE_COUNT 20
+#define LOOP_UNRELIABLE_SIZE 40
+#define LOOP_UNRELIABLE_BIG_SIZE 5000
+#define LOOP_LOSS_PERCENT 10
+#define LOOP_SOCKET_BUFFER_SIZE (4 * 1024 * 1024)
+#define LOOP_DICTIONARY_SIZE 4096
+// how long the transfer may take before the test gives up, in seconds
+#define LOOP_TIMEOUT 60.0
+
+// options are named in loop_option_names in the same order
+enum
+{
+	LOOP_OPTION_LOSS = (1 << 0),
+	LOOP_OPTION_RANGE_CODER = (1 << 1),
+	LOOP_OPTION_CRC32 = (1 << 2),
+	LOOP_OPTION_CRC32C = (1 << 3),
+	LOOP_OPTION_BATCH = (1 << 4),
+	LOOP_OPTION_OFFLOAD = (1 << 5),
+	LOOP_OPTION_LZ = (1 << 6),
+	LOOP_OPTION_DICTIONARY = (1 << 7),
+	LOOP_OPTION_OLD_CLIENT = (1 << 8),
+	LOOP_OPTION_OLD_SERVER = (1 << 9),
+	LOOP_OPTION_CUBIC = (1 << 10),
+	LOOP_OPTION_BBR = (1 << 11),
+	LOOP_OPTION_PROBE_MTU = (1 << 12)
+};
+
+static const char* loop_option_names[] =
+{
+	"loss",
+	"range-coder",
+	"crc32",
+	"crc32c",
+	"batch",
+	"offload",
+	"lz",
+	"dictionary",
+	"old-client",
+	"old-server",
+	"cubic",
+	"bbr",
+	"probe-mtu"
+};
+
+static bool loop_failed = false;
+static unsigned int loop_random = 12345;
+
+#define LOOP_CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf ("loop: check failed at line %i: %s\n", __LINE__, #condition); \
+			loop_failed = true; \
+		} \
+	} while (0)
+
+// drops incoming datagrams at random, a return of 1 tells enet the datagram was handled
+static int ENET_CALLBACK loop_intercept (ENetHost* host, ENetEvent* event)
+{
+	(void) host;
+	(void) event;
+
+	loop_random = loop_random * 1103515245 + 12345;
+
+	return (loop_random >> 16) % 100 < LOOP_LOSS_PERCENT;
+}
+
+static enet_uint8 loop_pattern (unsigned int seed, size_t index)
+{
+	return (enet_uint8) (seed * 31 + index * 7 + (index >> 8));
+}
+
+static void loop_fill (enet_uint8* data, size_t length, unsigned int seed)
+{
+	for (size_t iter = 0; iter < length; iter++)
+	{
+		data[iter] = loop_pattern (seed, iter);
+	}
+}
+
+static bool loop_verify (const enet_uint8* data, size_t length, unsigned int seed)
+{
+	for (size_t iter = 0; iter < length; iter++)
+	{
+		if (data[iter] != loop_pattern (seed, iter))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void loop_configure (ENetHost* host, int options, size_t batch_limit)
+{
+	if (options & LOOP_OPTION_LOSS)
+	{
+		host->intercept = loop_intercept;
+	}
+	if (options & LOOP_OPTION_RANGE_CODER)
+	{
+		enet_host_compress_with_range_coder (host);
+	}
+	if (options & LOOP_OPTION_CRC32)
+	{
+		host->checksum = enet_crc32;
+	}
+	if (options & LOOP_OPTION_CRC32C)
+	{
+		host->checksum = enet_crc32c;
+	}
+	if (options & LOOP_OPTION_BATCH)
+	{
+		enet_host_send_batch_limit (host, batch_limit);
+	}
+	if (options & LOOP_OPTION_OFFLOAD)
+	{
+		enet_host_segmentation_offload (host, ENET_SEGMENTATION_OFFLOAD_SEND | ENET_SEGMENTATION_OFFLOAD_RECEIVE);
+	}
+	if (options & LOOP_OPTION_LZ)
+	{
+		enet_host_compress_with_fast_lz (host);
+	}
+	if (options & LOOP_OPTION_DICTIONARY)
+	{
+		// the packets' own pattern, so matches reach into the dictionary
+		static enet_uint8 dictionary[LOOP_DICTIONARY_SIZE];
+
+		loop_fill (dictionary, sizeof (dictionary), 0);
+		LOOP_CHECK (enet_host_compress_with_dictionary (host, dictionary, sizeof (dictionary)) == 0);
+	}
+	if (options & LOOP_OPTION_CUBIC)
+	{
+		enet_host_congestion_control_with_cubic (host);
+	}
+	if (options & LOOP_OPTION_BBR)
+	{
+		enet_host_congestion_control_with_bbr (host);
+	}
+	if (options & LOOP_OPTION_PROBE_MTU)
+	{
+		LOOP_CHECK (enet_host_probe_mtu (host, ENET_PROTOCOL_MAXIMUM_MTU) == 0);
+	}
+}
+
+static void loop_send (ENetPeer* peer, enet_uint8 channel, size_t length, unsigned int seed, enet_uint32 flags)
+{
+	ENetPacket* packet = enet_packet_create (NULL, length, flags);
+
+	LOOP_CHECK (packet != NULL);
+	if (!packet)
+	{
+		return;
+	}
+
+	loop_fill (packet->data, length, seed);
+
+	// small reliable packets carry their place in the run, so the server can check the order
+	if (length == LOOP_SMALL_SIZE)
+	{
+		packet->data[0] = (enet_uint8) seed;
+	}
+
+	if (enet_peer_send (peer, channel, packet) < 0)
+	{
+		enet_packet_destroy (packet);
+		LOOP_CHECK (false);
+	}
+}
+
+static int loop_parse_options (int argc, char** argv)
+{
+	int options = 0;
+
+	for (int iter = 1; iter < argc; iter++)
+	{
+		int option = 0;
+
+		for (size_t name = 0; name < sizeof (loop_option_names) / sizeof (loop_option_names[0]); name++)
+		{
+			if (strcmp (argv[iter], loop_option_names[name]) == 0)
+			{
+				option = 1 << name;
+			}
+		}
+
+		if (!option)
+		{
+			printf ("loop: unknown option %s\n", argv[iter]);
+
+			return -1;
+		}
+
+		options |= option;
+	}
+
+	return options;
+}
+
+int main (int argc, char** argv)
+{
+	ENetEvent event;
+	ENetHost* server;
+	ENetHost* clients[LOOP_CLIENT_COUNT];
+	ENetPeer* peers[LOOP_CLIENT_COUNT];
+	int options = loop_parse_options (argc, argv);
+
+	if (options < 0)
+	{
+		return 1;
+	}
+
+	if (enet_initialize () != 0)
+	{
+		printf ("loop: could not initialize enet\n");
+
+		return 1;
+	}
+
+	server = bench_create_server (32, 2);
+	if (!server)
+	{
+		printf ("loop: could not create the server\n");
+
+		return 1;
+	}
+
+	// every client bursts its whole queue at once, and the kernel drops what does not fit in the socket
+	// 	unreliable delivery is only checked when nothing is lost, so leave room for the burst
+	enet_socket_set_option (server->socket, ENET_SOCKOPT_RCVBUF, LOOP_SOCKET_BUFFER_SIZE);
+	loop_configure (server, options, 8);
+	if (options & LOOP_OPTION_OLD_SERVER)
+	{
+		server->capabilities = 0;
+	}
+
+	ENetAddress address = bench_server_address (server);
+
+	for (int iter = 0; iter < LOOP_CLIENT_COUNT; iter++)
+	{
+		clients[iter] = enet_host_create (NULL, 1, 2, 0, 0);
+		if (!clients[iter])
+		{
+			printf ("loop: could not create client %i\n", iter);
+
+			return 1;
+		}
+
+		loop_configure (clients[iter], options, 4);
+		if (options & LOOP_OPTION_OLD_CLIENT)
+		{
+			clients[iter]->capabilities = 0;
+		}
+
+		peers[iter] = enet_host_connect (clients[iter], &address, 2, 42);
+		LOOP_CHECK (peers[iter] != NULL);
+	}
+
+	// connect
+	int connects = 0;
+	double start = bench_now ();
+
+	while (connects < LOOP_CLIENT_COUNT * 2
+		&& bench_now () - start < LOOP_TIMEOUT)
+	{
+		while (enet_host_service (server, &event, 0) > 0)
+		{
+			if (event.type == ENET_EVENT_TYPE_CONNECT)
+			{
+				LOOP_CHECK (event.data == 42);
+				connects++;
+			}
+		}
+
+		for (int iter = 0; iter < LOOP_CLIENT_COUNT; iter++)
+		{
+			while (enet_host_service (clients[iter], &event, 1) > 0)
+			{
+				if (event.type == ENET_EVENT_TYPE_CONNECT)
+				{
+					connects++;
+				}
+			}
+		}
+	}
+
+	LOOP_CHECK (connects == LOOP_CLIENT_COUNT * 2);
+	if (loop_failed)
+	{
+		return 1;
+	}
+
+	// queue everything up front, so fragments, batching and compression all get a full send queue
+	for (int iter = 0; iter < LOOP_CLIENT_COUNT; iter++)
+	{
+		for (int small = 0; small < LOOP_SMALL_COUNT; small++)
+		{
+			loop_send (peers[iter], 0, LOOP_SMALL_SIZE, small, ENET_PACKET_FLAG_RELIABLE);
+		}
+
+		loop_send (peers[iter], 1, LOOP_BIG_SIZE, 999, ENET_PACKET_FLAG_RELIABLE);
+
+		for (int unreliable = 0; unreliable < LOOP_UNRELIABLE_COUNT; unreliable++)
+		{
+			loop_send (peers[iter], 1, LOOP_UNRELIABLE_SIZE, unreliable, 0);
+		}
+
+		loop_send (peers[iter], 1, LOOP_UNRELIABLE_BIG_SIZE, 5, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+	}
+
+	ENetPacket* broadcast = enet_packet_create (NULL, LOOP_BROADCAST_SIZE, ENET_PACKET_FLAG_RELIABLE);
+
+	LOOP_CHECK (broadcast != NULL);
+	if (broadcast)
+	{
+		loop_fill (broadcast->data, LOOP_BROADCAST_SIZE, 77);
+		enet_host_broadcast (server, 0, broadcast);
+	}
+
+	// transfer
+	int next_small[LOOP_CLIENT_COUNT] = {0};
+	int small_received = 0;
+	int big_received = 0;
+	int unreliable_received = 0;
+	int unreliable_big_received = 0;
+	int broadcasts_received[LOOP_CLIENT_COUNT] = {0};
+	int clients_with_broadcast = 0;
+
+	start = bench_now ();
+
+	while (!(small_received == LOOP_CLIENT_COUNT * LOOP_SMALL_COUNT
+			&& big_received == LOOP_CLIENT_COUNT
+			&& clients_with_broadcast == LOOP_CLIENT_COUNT)
+		&& bench_now () - start < LOOP_TIMEOUT)
+	{
+		while (enet_host_service (server, &event, 0) > 0)
+		{
+			if (event.type != ENET_EVENT_TYPE_RECEIVE)
+			{
+				continue;
+			}
+
+			ENetPacket* packet = event.packet;
+			int client = -1;
+
+			for (int iter = 0; iter < LOOP_CLIENT_COUNT; iter++)
+			{
+				if (event.peer->connectID == peers[iter]->connectID)
+				{
+					client = iter;
+				}
+			}
+
+			LOOP_CHECK (client >= 0);
+
+			switch (packet->dataLength)
+			{
+				case LOOP_SMALL_SIZE:
+					LOOP_CHECK (event.channelID == 0);
+					if (client >= 0)
+					{
+						LOOP_CHECK (packet->data[0] == next_small[client]);
+						next_small[client]++;
+					}
+					small_received++;
+					break;
+				case LOOP_BIG_SIZE:
+					LOOP_CHECK (loop_verify (packet->data, LOOP_BIG_SIZE, 999));
+					big_received++;
+					break;
+				case LOOP_UNRELIABLE_SIZE:
+					unreliable_received++;
+					break;
+				case LOOP_UNRELIABLE_BIG_SIZE:
+					LOOP_CHECK (loop_verify (packet->data, LOOP_UNRELIABLE_BIG_SIZE, 5));
+					unreliable_big_received++;
+					break;
+				default:
+					LOOP_CHECK (false);
+					break;
+			}
+
+			enet_packet_destroy (packet);
+		}
+
+		for (int iter = 0; iter < LOOP_CLIENT_COUNT; iter++)
+		{
+			while (enet_host_service (clients[iter], &event, 0) > 0)
+			{
+				if (event.type != ENET_EVENT_TYPE_RECEIVE)
+				{
+					continue;
+				}
+
+				LOOP_CHECK (event.packet->dataLength == LOOP_BROADCAST_SIZE
+					&& loop_verify (event.packet->data, LOOP_BROADCAST_SIZE, 77));
+
+				if (broadcasts_received[iter]++ == 0)
+				{
+					clients_with_broadcast++;
+				}
+
+				enet_packet_destroy (event.packet);
+			}
+		}
+
+		bench_sleep (200);
+	}
+
+	LOOP_CHECK (small_received == LOOP_CLIENT_COUNT * LOOP_SMALL_COUNT);
+	LOOP_CHECK (big_received == LOOP_CLIENT_COUNT);
+
+	for (int iter = 0; iter < LOOP_CLIENT_COUNT; iter++)
+	{
+		LOOP_CHECK (broadcasts_received[iter] == 1);
+	}
+
+	if (!(options & LOOP_OPTION_LOSS))
+	{
+		LOOP_CHECK (unreliable_received == LOOP_CLIENT_COUNT * LOOP_UNRELIABLE_COUNT);
+		LOOP_CHECK (unreliable_big_received == LOOP_CLIENT_COUNT);
+	}
+
+	// disconnecting resets the peers
+	enet_uint32 mtu = peers[0]->mtu;
+
+	// disconnect
+	int disconnects = 0;
+
+	for (int iter = 0; iter < LOOP_CLIENT_COUNT; iter++)
+	{
+		enet_peer_disconnect (peers[iter], 7);
+	}
+
+	start = bench_now ();
+
+	while (disconnects < LOOP_CLIENT_COUNT * 2
+		&& bench_now () - start < LOOP_TIMEOUT)
+	{
+		while (enet_host_service (server, &event, 0) > 0)
+		{
+			if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+			{
+				LOOP_CHECK (event.data == 7);
+				disconnects++;
+			}
+		}
+
+		for (int iter = 0; iter < LOOP_CLIENT_COUNT; iter++)
+		{
+			while (enet_host_service (clients[iter], &event, 1) > 0)
+			{
+				if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+				{
+					disconnects++;
+				}
+			}
+		}
+	}
+
+	LOOP_CHECK (disconnects == LOOP_CLIENT_COUNT * 2);
+
+	printf ("loop: server sent %u datagrams in %u calls, received %u in %u calls, unreliable %i/%i, mtu %u\n",
+		server->totalSentPackets,
+		server->totalSendCalls,
+		server->totalReceivedPackets,
+		server->totalReceiveCalls,
+		unreliable_received,
+		unreliable_big_received,
+		mtu);
+
+	for (int iter = 0; iter < LOOP_CLIENT_COUNT; iter++)
+	{
+		enet_host_destroy (clients[iter]);
+	}
+
+	enet_host_destroy (server);
+	enet_deinitialize ();
+
+	if (loop_failed)
+	{
+		return 1;
+	}
+
+	printf ("LOOP OK\n");
+
+	return 0;
+}
@@ -0,0 +1,265 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "enet/enet.h"
+
+/*
+ * randomized round trips and garbage input through the fast lz codec
+ *
+ * every iteration builds a datagram of random, repetitive or mostly zero bytes, or of
+ * 	runs copied out of the dictionary, splits it over three buffers the way commands are
+ * 	scattered, compresses it and decompresses the result, which must give back the original
+ * iterations take turns between a context without a dictionary, one primed with
+ * 	LZ_DICTIONARY_SIZE bytes, one primed with a dictionary shorter than a match and one
+ * 	primed with a dictionary trained by enet_lz_train_dictionary
+ * a datagram that may grow by an eighth must always compress
+ * then random bytes are handed to the decoder, which must reject or decode them without
+ * 	reading or writing out of bounds, under a sanitizer build
+ * last, a datagram that continues the dictionary's periodic tail must shrink to a few
+ * 	bytes, with its matches running out of the dictionary into the datagram
+ *
+ * usage: enet_test_lz [iterations]
+ * prints LZ OK and exits with 0 when every check passed
+ */
+
+#define LZ_DEFAULT_ITERATIONS 100000
+#define LZ_MAXIMUM_SIZE 1500
+#define LZ_GARBAGE_SIZE 64
+#define LZ_DICTIONARY_SIZE 5000
+#define LZ_SHORT_DICTIONARY_SIZE 3
+#define LZ_TRAINED_DICTIONARY_SIZE 4096
+#define LZ_TRAINING_SAMPLE_COUNT 500
+// the dictionary ends in this period, which the last check continues in its datagram
+#define LZ_PERIOD 7
+#define LZ_PERIOD_DATAGRAM_SIZE 200
+#define LZ_PERIOD_COMPRESSED_MAXIMUM 16
+
+enum
+{
+	LZ_CONTEXT_PLAIN,
+	LZ_CONTEXT_DICTIONARY,
+	LZ_CONTEXT_SHORT_DICTIONARY,
+	LZ_CONTEXT_TRAINED,
+	LZ_CONTEXT_COUNT
+};
+
+static enet_uint8 lz_dictionary[LZ_DICTIONARY_SIZE];
+
+static unsigned int lz_random_state = 1;
+
+static unsigned int lz_random (void)
+{
+	lz_random_state = lz_random_state * 1103515245 + 12345;
+
+	return lz_random_state >> 16;
+}
+
+static void lz_fill (enet_uint8* data, size_t length, int mode)
+{
+	for (size_t iter = 0; iter < length; iter++)
+	{
+		switch (mode)
+		{
+			case 0:
+				data[iter] = (enet_uint8) lz_random ();
+				break;
+
+			case 1:
+				data[iter] = (enet_uint8) (iter % 13);
+				break;
+
+			case 2:
+				data[iter] = (enet_uint8) (lz_random () % 3);
+				break;
+
+			case 3:
+				// runs of 8 to 39 bytes from anywhere in the dictionary
+				if (iter % 32 == 0)
+				{
+					size_t offset = lz_random () % (LZ_DICTIONARY_SIZE - 40);
+					size_t run = 8 + lz_random () % 32;
+
+					if (run > length - iter)
+					{
+						run = length - iter;
+					}
+
+					memcpy (&data[iter], &lz_dictionary[offset], run);
+					iter += run - 1;
+				}
+				else
+				{
+					data[iter] = (enet_uint8) lz_random ();
+				}
+				break;
+
+			default:
+				data[iter] = iter % 300 < 200 ? 0 : (enet_uint8) lz_random ();
+				break;
+		}
+	}
+}
+
+static bool lz_round_trip (void* context, int iteration)
+{
+	static enet_uint8 input[LZ_MAXIMUM_SIZE];
+	static enet_uint8 compressed[LZ_MAXIMUM_SIZE * 2];
+	static enet_uint8 output[LZ_MAXIMUM_SIZE];
+	size_t length = lz_random () % LZ_MAXIMUM_SIZE;
+	size_t first = length ? lz_random () % (length + 1) : 0;
+	size_t second = first + (length > first ? lz_random () % (length - first + 1) : 0);
+	ENetBuffer buffers[3] =
+	{
+		{.data = input, .dataLength = first},
+		{.data = input + first, .dataLength = second - first},
+		{.data = input + second, .dataLength = length - second}
+	};
+
+	lz_fill (input, length, lz_random () % 5);
+
+	// half the time the output may not grow, the other half it has room to spare
+	size_t limit = lz_random () % 2 ? length : length + length / 8 + 16;
+	size_t compressed_length = enet_lz_compress (context, buffers, 3, length, compressed, limit);
+
+	if (compressed_length == 0)
+	{
+		if (length > 0 && limit > length)
+		{
+			printf ("lz: iteration %i, %zu bytes did not compress within %zu\n", iteration, length, limit);
+
+			return false;
+		}
+
+		return true;
+	}
+
+	if (enet_lz_decompress (context, compressed, compressed_length, output, length) != length
+		|| memcmp (output, input, length) != 0)
+	{
+		printf ("lz: iteration %i, %zu bytes did not round trip\n", iteration, length);
+
+		return false;
+	}
+
+	return true;
+}
+
+static void lz_garbage (void* context)
+{
+	static enet_uint8 input[LZ_GARBAGE_SIZE];
+	static enet_uint8 output[LZ_MAXIMUM_SIZE * 4];
+	size_t length = lz_random () % LZ_GARBAGE_SIZE;
+
+	lz_fill (input, length, 0);
+	enet_lz_decompress (context, input, length, output, lz_random () % sizeof (output));
+}
+
+static void* lz_create_trained (void)
+{
+	static enet_uint8 samples[LZ_TRAINING_SAMPLE_COUNT][LZ_MAXIMUM_SIZE];
+	static ENetBuffer buffers[LZ_TRAINING_SAMPLE_COUNT];
+	static enet_uint8 dictionary[LZ_TRAINED_DICTIONARY_SIZE];
+
+	for (int iter = 0; iter < LZ_TRAINING_SAMPLE_COUNT; iter++)
+	{
+		buffers[iter].data = samples[iter];
+		buffers[iter].dataLength = lz_random () % 300;
+		lz_fill (samples[iter], buffers[iter].dataLength, 1 + lz_random () % 4);
+	}
+
+	size_t length = enet_lz_train_dictionary (buffers, LZ_TRAINING_SAMPLE_COUNT, dictionary, sizeof (dictionary));
+
+	if (length == 0)
+	{
+		printf ("lz: training gave no dictionary\n");
+
+		return NULL;
+	}
+
+	return enet_lz_create_with_dictionary (dictionary, length);
+}
+
+static bool lz_check_period (void* context)
+{
+	static enet_uint8 input[LZ_PERIOD_DATAGRAM_SIZE];
+	static enet_uint8 compressed[LZ_PERIOD_DATAGRAM_SIZE];
+	static enet_uint8 output[LZ_PERIOD_DATAGRAM_SIZE];
+	ENetBuffer buffer =
+	{
+		.data = input,
+		.dataLength = sizeof (input)
+	};
+
+	for (size_t iter = 0; iter < sizeof (input); iter++)
+	{
+		input[iter] = lz_dictionary[LZ_DICTIONARY_SIZE - LZ_PERIOD + iter % LZ_PERIOD];
+	}
+
+	size_t length = enet_lz_compress (context, &buffer, 1, sizeof (input), compressed, sizeof (compressed));
+
+	if (length == 0
+		|| length > LZ_PERIOD_COMPRESSED_MAXIMUM
+		|| enet_lz_decompress (context, compressed, length, output, sizeof (output)) != sizeof (input)
+		|| memcmp (output, input, sizeof (input)) != 0)
+	{
+		printf ("lz: a datagram continuing the dictionary compressed to %zu bytes or did not round trip\n", length);
+
+		return false;
+	}
+
+	return true;
+}
+
+int main (int argc, char** argv)
+{
+	int iterations = argc > 1 ? atoi (argv[1]) : LZ_DEFAULT_ITERATIONS;
+	void* contexts[LZ_CONTEXT_COUNT];
+
+	for (size_t iter = 0; iter < LZ_DICTIONARY_SIZE; iter++)
+	{
+		lz_dictionary[iter] = iter % 13 == 0 ? (enet_uint8) lz_random () : (enet_uint8) (iter % LZ_PERIOD);
+	}
+
+	contexts[LZ_CONTEXT_PLAIN] = enet_lz_create ();
+	contexts[LZ_CONTEXT_DICTIONARY] = enet_lz_create_with_dictionary (lz_dictionary, LZ_DICTIONARY_SIZE);
+	contexts[LZ_CONTEXT_SHORT_DICTIONARY] = enet_lz_create_with_dictionary (lz_dictionary, LZ_SHORT_DICTIONARY_SIZE);
+	contexts[LZ_CONTEXT_TRAINED] = lz_create_trained ();
+
+	for (int context = 0; context < LZ_CONTEXT_COUNT; context++)
+	{
+		if (!contexts[context])
+		{
+			printf ("lz: could not create context %i\n", context);
+
+			return 1;
+		}
+	}
+
+	for (int iter = 0; iter < iterations; iter++)
+	{
+		void* context = contexts[iter % LZ_CONTEXT_COUNT];
+
+		if (!lz_round_trip (context, iter))
+		{
+			return 1;
+		}
+
+		lz_garbage (context);
+	}
+
+	if (!lz_check_period (contexts[LZ_CONTEXT_DICTIONARY]))
+	{
+		return 1;
+	}
+
+	for (int context = 0; context < LZ_CONTEXT_COUNT; context++)
+	{
+		enet_lz_destroy (contexts[context]);
+	}
+
+	printf ("LZ OK\n");
+
+	return 0;
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "relay.h"
+
+/*
+ * path mtu discovery on a reliable stream
+ *
+ * the client keeps MTU_QUEUE_DEPTH reliable packets queued, straight over loopback or
+ * 	through a relay that drops datagrams longer than the path carries
+ * every change of the client peer's mtu is printed as it happens, then the goodput
+ * with later set, the path shrinks half way through the run, the mtu has to fall back
+ * 	and the stream has to go on
+ */
+
+#define MTU_QUEUE_DEPTH 256
+#define MTU_SECONDS 6.0
+#define MTU_RELAY_RATE (50.0 * 1000 * 1000)
+#define MTU_RELAY_DELAY 0.005
+#define MTU_RELAY_BUFFER (4.0 * 1024 * 1024)
+
+typedef struct mtu_case_s
+{
+	bool probe;
+	size_t packet_size;
+	// what the path carries, 0 to connect straight to the server without a relay
+	size_t path_size;
+	// what the path carries after half the run, 0 to leave it
+	size_t later_path_size;
+} Mtu_case;
+
+static int mtu_run (const Mtu_case* run)
+{
+	Relay relay =
+	{
+		.rate = MTU_RELAY_RATE,
+		.delay = MTU_RELAY_DELAY,
+		.buffer = MTU_RELAY_BUFFER
+	};
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+	enet_uint8* data = calloc (1, run->packet_size);
+
+	if (!server || !client || !data)
+	{
+		printf ("mtu: could not create hosts\n");
+
+		return 1;
+	}
+
+	ENetAddress address = bench_server_address (server);
+
+	if (run->path_size)
+	{
+		relay.server_address = address;
+		atomic_init (&relay.maximum_size, run->path_size);
+
+		if (!relay_start (&relay))
+		{
+			printf ("mtu: could not start the relay\n");
+
+			return 1;
+		}
+
+		address = relay.address;
+	}
+
+	if (run->probe
+		&& enet_host_probe_mtu (client, ENET_PROTOCOL_MAXIMUM_MTU) < 0)
+	{
+		printf ("mtu: the socket cannot forbid fragmentation\n");
+
+		return 1;
+	}
+
+	printf ("probing %s, %zu byte packets, path %zu", run->probe ? "on" : "off", run->packet_size, run->path_size);
+	if (run->later_path_size)
+	{
+		printf (" then %zu", run->later_path_size);
+	}
+	printf ("\n");
+
+	ENetPeer* peer = enet_host_connect (client, &address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("mtu: could not connect\n");
+
+		return 1;
+	}
+
+	size_t received = 0;
+	enet_uint32 mtu = peer->mtu;
+	bool shrunk = false;
+	double start = bench_now ();
+
+	printf ("  %7.3f s: mtu %u\n", 0.0, mtu);
+
+	while (bench_now () - start < MTU_SECONDS
+		&& peer->state == ENET_PEER_STATE_CONNECTED)
+	{
+		while (enet_list_size (&peer->outgoingCommands) < MTU_QUEUE_DEPTH)
+		{
+			ENetPacket* packet = enet_packet_create (data, run->packet_size, ENET_PACKET_FLAG_RELIABLE);
+
+			if (!packet
+				|| enet_peer_send (peer, 0, packet) < 0)
+			{
+				printf ("mtu: could not queue a packet\n");
+
+				return 1;
+			}
+		}
+
+		bench_drain (client);
+		received += bench_drain (server);
+
+		double now = bench_now () - start;
+
+		if (run->later_path_size && !shrunk && now >= MTU_SECONDS / 2)
+		{
+			atomic_store (&relay.maximum_size, run->later_path_size);
+			shrunk = true;
+			printf ("  %7.3f s: the path now carries %zu\n", now, run->later_path_size);
+		}
+
+		if (peer->mtu != mtu)
+		{
+			mtu = peer->mtu;
+			printf ("  %7.3f s: mtu %u\n", now, mtu);
+		}
+	}
+
+	bool connected = peer->state == ENET_PEER_STATE_CONNECTED;
+
+	if (run->path_size)
+	{
+		relay_stop (&relay);
+	}
+
+	printf ("  %s, %.2f MB/s, final mtu %u\n",
+		connected ? "connected" : "disconnected",
+		(double) received / (bench_now () - start) / 1e6,
+		peer->mtu);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+	free (data);
+
+	return !connected;
+}
+
+int main (void)
+{
+	static const Mtu_case cases[] =
+	{
+		{false, 16384, 0, 0},
+		{true, 16384, 0, 0},
+		{false, 1200, 0, 0},
+		{true, 1200, 0, 0},
+		{true, 16384, 1472, 0},
+		{true, 16384, 1472, 1200}
+	};
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("mtu: could not initialize enet\n");
+
+		return 1;
+	}
+
+	for (size_t iter = 0; iter < sizeof (cases) / sizeof (cases[0]); iter++)
+	{
+		result |= mtu_run (&cases[iter]);
+	}
+
+	enet_deinitialize ();
+
+	return result;
+}
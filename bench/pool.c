@@ -0,0 +1,105 @@
+#include <stdio.h>
+
+#include "bench.h"
+
+/*
+ * sends past a capped outgoing command pool must fail cleanly
+ *
+ * the client's pool may hold POOL_LIMIT commands, and POOL_SEND_COUNT reliable packets are
+ * 	queued at once, so the sends past the cap fail and their packets go back to the caller
+ * every send that succeeded must still be delivered, and the pool must never pass its cap
+ *
+ * prints POOL OK and exits with 0 when every check passed
+ */
+
+#define POOL_LIMIT 40
+#define POOL_SEND_COUNT 100
+// how long the queued packets get to arrive, in seconds
+#define POOL_TIMEOUT 5.0
+
+int main (void)
+{
+	if (enet_initialize () != 0)
+	{
+		printf ("pool: could not initialize enet\n");
+
+		return 1;
+	}
+
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("pool: could not create hosts\n");
+
+		return 1;
+	}
+
+	// the cap only stops the pool carving out more objects, so it has to be set before the first
+	enet_host_pool_limit (client, POOL_LIMIT, 0, 0);
+
+	ENetAddress address = bench_server_address (server);
+	ENetPeer* peer = enet_host_connect (client, &address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("pool: could not connect\n");
+
+		return 1;
+	}
+
+	int failed = 0;
+
+	for (int iter = 0; iter < POOL_SEND_COUNT; iter++)
+	{
+		ENetPacket* packet = enet_packet_create ("x", 1, ENET_PACKET_FLAG_RELIABLE);
+
+		if (!packet)
+		{
+			printf ("pool: could not create a packet\n");
+
+			return 1;
+		}
+
+		if (enet_peer_send (peer, 0, packet) < 0)
+		{
+			enet_packet_destroy (packet);
+			failed++;
+		}
+	}
+
+	size_t received = 0;
+	double start = bench_now ();
+
+	while (received < (size_t) (POOL_SEND_COUNT - failed)
+		&& bench_now () - start < POOL_TIMEOUT)
+	{
+		bench_drain (client);
+		received += bench_drain (server);
+		bench_sleep (1000);
+	}
+
+	printf ("pool: %i of %i sends failed, %zu delivered, peak %zu of %i commands\n",
+		failed,
+		POOL_SEND_COUNT,
+		received,
+		client->outgoingCommandPool.peakUsedCount,
+		POOL_LIMIT);
+
+	int result = failed == 0
+		|| received != (size_t) (POOL_SEND_COUNT - failed)
+		|| client->outgoingCommandPool.peakUsedCount > POOL_LIMIT;
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+	enet_deinitialize ();
+
+	if (result == 0)
+	{
+		printf ("POOL OK\n");
+	}
+
+	return result;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*
+ * receive bursts of small datagrams over loopback
+ *
+ * the client sends RECEIVE_BURST_SIZE unsequenced packets per round, flushing after each one
+ * 	so every packet leaves in a datagram of its own, then the server drains them all
+ * reports how many datagrams each socket receive call returned and what draining cost per datagram
+ */
+
+#define RECEIVE_ROUNDS 50
+#define RECEIVE_BURST_SIZE 1000
+#define RECEIVE_PACKET_SIZE 200
+// room for a whole burst, so the kernel does not drop any of it
+#define RECEIVE_SOCKET_BUFFER_SIZE (8 * 1024 * 1024)
+
+int main (void)
+{
+	static enet_uint8 data[RECEIVE_PACKET_SIZE];
+
+	if (enet_initialize () != 0)
+	{
+		printf ("receive: could not initialize enet\n");
+
+		return 1;
+	}
+
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("receive: could not create hosts\n");
+
+		return 1;
+	}
+
+	enet_socket_set_option (server->socket, ENET_SOCKOPT_RCVBUF, RECEIVE_SOCKET_BUFFER_SIZE);
+
+	ENetAddress address = bench_server_address (server);
+	ENetPeer* peer = enet_host_connect (client, &address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("receive: could not connect\n");
+
+		return 1;
+	}
+
+	memset (data, 1, sizeof (data));
+
+	server->totalReceivedPackets = 0;
+	server->totalReceiveCalls = 0;
+
+	size_t received = 0;
+	double elapsed = 0.0;
+
+	for (int round = 0; round < RECEIVE_ROUNDS; round++)
+	{
+		for (int iter = 0; iter < RECEIVE_BURST_SIZE; iter++)
+		{
+			ENetPacket* packet = enet_packet_create (data, sizeof (data), ENET_PACKET_FLAG_UNSEQUENCED);
+
+			if (!packet
+				|| enet_peer_send (peer, 0, packet) < 0)
+			{
+				printf ("receive: could not queue a packet\n");
+
+				return 1;
+			}
+
+			enet_host_flush (client);
+		}
+
+		double start = bench_now ();
+
+		received += bench_drain (server) / RECEIVE_PACKET_SIZE;
+		elapsed += bench_now () - start;
+	}
+
+	printf ("received %zu of %i packets, %u datagrams in %u receive calls (%.1f per call), %.0f ns per datagram\n",
+		received,
+		RECEIVE_ROUNDS * RECEIVE_BURST_SIZE,
+		server->totalReceivedPackets,
+		server->totalReceiveCalls,
+		server->totalReceiveCalls ? (double) server->totalReceivedPackets / server->totalReceiveCalls : 0.0,
+		received ? elapsed * 1e9 / received : 0.0);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+	enet_deinitialize ();
+
+	return 0;
+}
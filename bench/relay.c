@@ -0,0 +1,213 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "relay.h"
+
+static bool relay_queue_initialize (Relay_queue* queue)
+{
+	queue->datagrams = malloc (RELAY_QUEUE_CAPACITY * sizeof (Relay_datagram));
+	queue->head = 0;
+	queue->count = 0;
+
+	return queue->datagrams != NULL;
+}
+
+// the slot for the next datagram, or NULL when the queue is full
+static Relay_datagram* relay_queue_back (Relay_queue* queue)
+{
+	if (queue->count == RELAY_QUEUE_CAPACITY)
+	{
+		return NULL;
+	}
+
+	return &queue->datagrams[(queue->head + queue->count) % RELAY_QUEUE_CAPACITY];
+}
+
+static Relay_datagram* relay_queue_front (Relay_queue* queue)
+{
+	return queue->count > 0 ? &queue->datagrams[queue->head] : NULL;
+}
+
+static void relay_queue_pop (Relay_queue* queue)
+{
+	queue->head = (queue->head + 1) % RELAY_QUEUE_CAPACITY;
+	queue->count--;
+}
+
+static void relay_receive (Relay* relay, double now)
+{
+	for (;;)
+	{
+		Relay_datagram incoming;
+		ENetAddress sender;
+		ENetBuffer buffer =
+		{
+			.data = incoming.data,
+			.dataLength = sizeof (incoming.data)
+		};
+		int length = enet_socket_receive (relay->socket, &sender, &buffer, 1);
+
+		// 0 when there is nothing left, whatever failed is picked up again on the next wake
+		if (length <= 0)
+		{
+			return;
+		}
+
+		if (sender.host == relay->server_address.host
+			&& sender.port == relay->server_address.port)
+		{
+			// the way back is only delayed
+			Relay_datagram* datagram = relay_queue_back (&relay->to_client);
+
+			if (!datagram)
+			{
+				relay->dropped++;
+
+				continue;
+			}
+
+			memcpy (datagram->data, incoming.data, (size_t) length);
+			datagram->length = (size_t) length;
+			datagram->due = now + relay->delay;
+			relay->to_client.count++;
+
+			continue;
+		}
+
+		relay->client_address = sender;
+
+		size_t maximum_size = atomic_load (&relay->maximum_size);
+
+		relay->random = relay->random * 1103515245 + 12345;
+		if ((relay->random >> 16) % 10000 < relay->loss * 10000
+			|| (maximum_size > 0 && (size_t) length > maximum_size))
+		{
+			relay->dropped++;
+
+			continue;
+		}
+
+		// the bottleneck, queued bytes are the ones still waiting for their turn on the link
+		double start = relay->last_departure > now ? relay->last_departure : now;
+		double queued = (start - now) * relay->rate;
+		Relay_datagram* datagram = relay_queue_back (&relay->to_server);
+
+		if (!datagram
+			|| queued + length > relay->buffer)
+		{
+			relay->dropped++;
+
+			continue;
+		}
+
+		relay->last_departure = start + (double) length / relay->rate;
+
+		memcpy (datagram->data, incoming.data, (size_t) length);
+		datagram->length = (size_t) length;
+		datagram->due = relay->last_departure + relay->delay;
+		relay->to_server.count++;
+	}
+}
+
+static void relay_send_due (Relay* relay, Relay_queue* queue, const ENetAddress* address, double now)
+{
+	Relay_datagram* datagram;
+
+	while ((datagram = relay_queue_front (queue)) && datagram->due <= now)
+	{
+		ENetBuffer buffer =
+		{
+			.data = datagram->data,
+			.dataLength = datagram->length
+		};
+
+		enet_socket_send (relay->socket, address, &buffer, 1);
+		relay->forwarded++;
+		relay_queue_pop (queue);
+	}
+}
+
+static void* relay_thread (void* data)
+{
+	Relay* relay = data;
+
+	while (!atomic_load (&relay->stop))
+	{
+		// wake at least every millisecond to send whatever has come due
+		enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE;
+
+		enet_socket_wait (relay->socket, &condition, 1);
+
+		double now = bench_now ();
+
+		relay_receive (relay, now);
+		relay_send_due (relay, &relay->to_server, &relay->server_address, now);
+		relay_send_due (relay, &relay->to_client, &relay->client_address, now);
+	}
+
+	return NULL;
+}
+
+static void relay_release (Relay* relay)
+{
+	enet_socket_destroy (relay->socket);
+	free (relay->to_server.datagrams);
+	free (relay->to_client.datagrams);
+}
+
+bool relay_start (Relay* relay)
+{
+	ENetAddress bind_address =
+	{
+		.host = ENET_HOST_ANY,
+		.port = 0
+	};
+
+	relay->socket = enet_socket_create (ENET_SOCKET_TYPE_DATAGRAM);
+	if (relay->socket == ENET_SOCKET_NULL)
+	{
+		return false;
+	}
+
+	enet_socket_set_option (relay->socket, ENET_SOCKOPT_NONBLOCK, 1);
+	enet_socket_set_option (relay->socket, ENET_SOCKOPT_RCVBUF, RELAY_SOCKET_BUFFER_SIZE);
+	enet_socket_set_option (relay->socket, ENET_SOCKOPT_SNDBUF, RELAY_SOCKET_BUFFER_SIZE);
+
+	bool to_server = relay_queue_initialize (&relay->to_server);
+	bool to_client = relay_queue_initialize (&relay->to_client);
+
+	if (!to_server || !to_client
+		|| enet_socket_bind (relay->socket, &bind_address) < 0
+		|| enet_socket_get_address (relay->socket, &relay->address) < 0)
+	{
+		relay_release (relay);
+
+		return false;
+	}
+
+	enet_address_set_host_ip (&relay->address, "127.0.0.1");
+
+	relay->last_departure = 0.0;
+	relay->random = 1;
+	relay->forwarded = 0;
+	relay->dropped = 0;
+	atomic_init (&relay->stop, false);
+
+	if (pthread_create (&relay->thread, NULL, relay_thread, relay))
+	{
+		relay_release (relay);
+
+		return false;
+	}
+
+	return true;
+}
+
+void relay_stop (Relay* relay)
+{
+	atomic_store (&relay->stop, true);
+	pthread_join (relay->thread, NULL);
+
+	relay_release (relay);
+}
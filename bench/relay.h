@@ -0,0 +1,77 @@
+#ifndef relay_h
+#define relay_h
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "enet/enet.h"
+
+/*
+ * a udp relay on loopback that behaves like a slow, distant link
+ *
+ * clients send to the relay's port instead of the server's
+ * 	datagrams towards the server leave at most rate bytes per second, the rest wait in a
+ * 	drop tail queue of buffer bytes, like a bottleneck router
+ * 	datagrams in both directions arrive delay seconds after they would have
+ * 	a loss share of the datagrams towards the server is dropped at random, like a noisy link
+ * 	datagrams towards the server longer than maximum_size are dropped, like a path with a
+ * 	smaller mtu that will not fragment them, 0 lets every size through
+ *
+ * the relay runs on its own thread between relay_start and relay_stop
+ * 	it only relays for one client address at a time
+ */
+
+// datagrams waiting in each direction, including the ones held back by the delay
+#define RELAY_QUEUE_CAPACITY 4096
+// bigger than the default socket buffers, so the relay itself does not drop a burst
+#define RELAY_SOCKET_BUFFER_SIZE (8 * 1024 * 1024)
+
+typedef struct relay_datagram_s
+{
+	double due;
+	size_t length;
+	enet_uint8 data[ENET_PROTOCOL_MAXIMUM_MTU];
+} Relay_datagram;
+
+// a ring of datagrams ordered by due time
+typedef struct relay_queue_s
+{
+	Relay_datagram* datagrams;
+	size_t head;
+	size_t count;
+} Relay_queue;
+
+typedef struct relay_s
+{
+	// set before relay_start
+	double rate;
+	double delay;
+	double buffer;
+	double loss;
+	ENetAddress server_address;
+
+	// the loopback address clients connect to, set by relay_start
+	ENetAddress address;
+
+	// may be changed while the relay runs
+	atomic_size_t maximum_size;
+
+	// only touched by the relay's thread until relay_stop returns
+	ENetSocket socket;
+	ENetAddress client_address;
+	Relay_queue to_server;
+	Relay_queue to_client;
+	double last_departure;
+	unsigned int random;
+	long long forwarded;
+	long long dropped;
+
+	atomic_bool stop;
+	pthread_t thread;
+} Relay;
+
+bool relay_start (Relay* relay);
+void relay_stop (Relay* relay);
+
+#endif
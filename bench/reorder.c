@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*
+ * queue incoming reliable commands out of order, the way loss leaves them
+ *
+ * commands go straight into enet_peer_queue_incoming_command on a peer that is never
+ * 	really connected, so only the queueing is measured
+ * every gap-th command of a run is held back and queued after the rest, so the run waits
+ * 	behind a missing command until the end, like retransmits arriving late
+ *
+ * a command more than a reliable window ahead does not fit the ring, so it has to be dropped
+ * 	without an acknowledgement and only gets in once its retransmit is close enough
+ *
+ * usage: enet_bench_reorder [commands per run] [gap]
+ * 	a gap of 0 queues every command in order
+ * 	without arguments it runs a few sizes
+ */
+
+#define REORDER_ROUNDS 20
+#define REORDER_PAYLOAD_SIZE 16
+
+static int reorder_run (int count, int gap)
+{
+	static const enet_uint8 payload[REORDER_PAYLOAD_SIZE];
+	ENetProtocol command;
+	ENetAddress address =
+	{
+		.port = 1
+	};
+	ENetHost* host = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!host)
+	{
+		printf ("reorder: could not create a host\n");
+
+		return 1;
+	}
+
+	enet_address_set_host_ip (&address, "127.0.0.1");
+
+	ENetPeer* peer = enet_host_connect (host, &address, 1, 0);
+
+	if (!peer)
+	{
+		printf ("reorder: could not set up a peer\n");
+
+		return 1;
+	}
+
+	peer->state = ENET_PEER_STATE_CONNECTED;
+
+	memset (&command, 0, sizeof (command));
+	command.header.command = ENET_PROTOCOL_COMMAND_SEND_RELIABLE | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+	command.header.channelID = 0;
+
+	double elapsed = 0.0;
+	long delivered = 0;
+	enet_uint16 base = 0;
+
+	for (int round = 0; round < REORDER_ROUNDS; round++)
+	{
+		double start = bench_now ();
+
+		// the first pass queues the commands that got through, the second the ones held back
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int iter = 1; iter <= count; iter++)
+			{
+				bool held_back = gap > 0 && iter % gap == 1;
+
+				if (held_back != (pass == 1))
+				{
+					continue;
+				}
+
+				command.header.reliableSequenceNumber = (enet_uint16) (base + iter);
+				if (!enet_peer_queue_incoming_command (peer, &command, payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE, 0))
+				{
+					printf ("reorder: could not queue command %i\n", iter);
+
+					return 1;
+				}
+			}
+		}
+
+		elapsed += bench_now () - start;
+		base += (enet_uint16) count;
+
+		ENetPacket* packet;
+		enet_uint8 channel;
+
+		while ((packet = enet_peer_receive (peer, &channel)) != NULL)
+		{
+			delivered++;
+			enet_packet_destroy (packet);
+		}
+
+		// the peer never gets serviced, so take it back off the dispatch queue by hand
+		while (!enet_list_empty (&host->dispatchQueue))
+		{
+			enet_list_remove (enet_list_begin (&host->dispatchQueue));
+		}
+
+		peer->flags &= ~ENET_PEER_FLAG_NEEDS_DISPATCH;
+		peer->totalWaitingData = 0;
+	}
+
+	printf ("%5i commands, gap %2i: %.3f us per command, %ld of %i delivered\n",
+		count,
+		gap,
+		elapsed * 1e6 / ((double) count * REORDER_ROUNDS),
+		delivered,
+		count * REORDER_ROUNDS);
+
+	enet_host_destroy (host);
+
+	return delivered != (long) count * REORDER_ROUNDS;
+}
+
+static int reorder_beyond_ring (void)
+{
+	static const enet_uint8 payload[REORDER_PAYLOAD_SIZE];
+	ENetProtocol command;
+	ENetAddress address =
+	{
+		.port = 1
+	};
+	ENetHost* host = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!host)
+	{
+		printf ("reorder: could not create a host\n");
+
+		return 1;
+	}
+
+	enet_address_set_host_ip (&address, "127.0.0.1");
+
+	ENetPeer* peer = enet_host_connect (host, &address, 1, 0);
+
+	if (!peer)
+	{
+		printf ("reorder: could not set up a peer\n");
+
+		return 1;
+	}
+
+	peer->state = ENET_PEER_STATE_CONNECTED;
+
+	memset (&command, 0, sizeof (command));
+	command.header.command = ENET_PROTOCOL_COMMAND_SEND_RELIABLE | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+	command.header.channelID = 0;
+
+	ENetChannel* channel = &peer->channels[0];
+	int result = 0;
+
+	// the first command is missing, the one a full window after it is too far ahead to hold
+	command.header.reliableSequenceNumber = ENET_PEER_RELIABLE_WINDOW_SIZE + 1;
+	if (!enet_peer_queue_incoming_command (peer, &command, payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE, 0)
+		|| channel->incomingReliableCount != 0
+		|| enet_peer_queue_acknowledgement (peer, &command, 0) != NULL)
+	{
+		printf ("reorder: a command a window ahead was queued or acknowledged\n");
+		result = 1;
+	}
+
+	for (int iter = ENET_PEER_RELIABLE_WINDOW_SIZE; iter >= 2 && !result; iter--)
+	{
+		command.header.reliableSequenceNumber = (enet_uint16) iter;
+		if (!enet_peer_queue_incoming_command (peer, &command, payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE, 0)
+			|| enet_peer_queue_acknowledgement (peer, &command, 0) == NULL)
+		{
+			printf ("reorder: command %i inside the window was refused\n", iter);
+			result = 1;
+		}
+	}
+
+	// once the gap closes, the retransmit of the command that was dropped fits
+	command.header.reliableSequenceNumber = 1;
+	if (!result
+		&& (!enet_peer_queue_incoming_command (peer, &command, payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE, 0)
+			|| channel->incomingReliableSequenceNumber != ENET_PEER_RELIABLE_WINDOW_SIZE))
+	{
+		printf ("reorder: the window was not delivered\n");
+		result = 1;
+	}
+
+	command.header.reliableSequenceNumber = ENET_PEER_RELIABLE_WINDOW_SIZE + 1;
+	if (!result
+		&& (!enet_peer_queue_incoming_command (peer, &command, payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE, 0)
+			|| channel->incomingReliableSequenceNumber != ENET_PEER_RELIABLE_WINDOW_SIZE + 1))
+	{
+		printf ("reorder: the retransmitted command was not delivered\n");
+		result = 1;
+	}
+
+	if (channel->incomingReliableCapacity > ENET_PEER_RELIABLE_WINDOW_SIZE)
+	{
+		printf ("reorder: the ring grew to %u slots\n", channel->incomingReliableCapacity);
+		result = 1;
+	}
+
+	printf ("beyond the ring: ring of %u slots, %s\n", channel->incomingReliableCapacity, result ? "failed" : "dropped until it fit");
+
+	enet_host_destroy (host);
+
+	return result;
+}
+
+int main (int argc, char** argv)
+{
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("reorder: could not initialize enet\n");
+
+		return 1;
+	}
+
+	if (argc > 1)
+	{
+		result = reorder_run (atoi (argv[1]), argc > 2 ? atoi (argv[2]) : 0);
+	}
+	else
+	{
+		result |= reorder_run (1024, 10);
+		result |= reorder_run (4096, 10);
+		result |= reorder_run (4096, 2);
+		result |= reorder_run (4096, 0);
+		result |= reorder_beyond_ring ();
+	}
+
+	enet_deinitialize ();
+
+	return result;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+
+#include "bench.h"
+
+/*
+ * reset a peer that still has a send queued, then let a new client take its slot
+ *
+ * a reset peer must leave the host's send queue, otherwise the next send pass would
+ * 	visit a peer that is no longer connected, or queue the reused slot twice
+ *
+ * prints RESET OK and exits with 0 when every round passed
+ */
+
+#define RESET_ROUNDS 4
+
+int main (void)
+{
+	ENetEvent event;
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("reset: could not initialize enet\n");
+
+		return 1;
+	}
+
+	ENetHost* server = bench_create_server (1, 1);
+
+	if (!server)
+	{
+		printf ("reset: could not create the server\n");
+
+		return 1;
+	}
+
+	ENetAddress address = bench_server_address (server);
+
+	for (int round = 0; round < RESET_ROUNDS; round++)
+	{
+		ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+		if (!client
+			|| !enet_host_connect (client, &address, 1, 0)
+			|| !bench_wait_for_connects (server, client, 1))
+		{
+			printf ("reset: round %i could not connect\n", round);
+
+			return 1;
+		}
+
+		// the server only has the one slot
+		ENetPeer* peer = &server->peers[0];
+		ENetPacket* packet = enet_packet_create ("hello", 6, ENET_PACKET_FLAG_RELIABLE);
+
+		if (!packet
+			|| enet_peer_send (peer, 0, packet) < 0)
+		{
+			printf ("reset: round %i could not queue a packet\n", round);
+
+			return 1;
+		}
+
+		enet_peer_reset (peer);
+		enet_host_service (server, &event, 10);
+
+		if (!enet_list_empty (&server->sendQueue))
+		{
+			printf ("reset: round %i left the reset peer on the send queue\n", round);
+			result = 1;
+		}
+
+		enet_host_destroy (client);
+	}
+
+	enet_host_destroy (server);
+	enet_deinitialize ();
+
+	if (result == 0)
+	{
+		printf ("RESET OK\n");
+	}
+
+	return result;
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+
+#include "bench.h"
+
+/*
+ * the round trip time a peer measures over loopback
+ *
+ * the client sends a small reliable packet every RTT_SEND_INTERVAL iterations and both
+ * 	hosts are serviced about every RTT_SLEEP microseconds, so acknowledgements come back
+ * 	far sooner than a millisecond
+ * prints the client peer's smoothed round trip time and its variance
+ */
+
+#define RTT_PACKET_COUNT 2000
+#define RTT_SEND_INTERVAL 5
+#define RTT_SLEEP 50
+#define RTT_TIMEOUT 10.0
+
+int main (void)
+{
+	if (enet_initialize () != 0)
+	{
+		printf ("rtt: could not initialize enet\n");
+
+		return 1;
+	}
+
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("rtt: could not create hosts\n");
+
+		return 1;
+	}
+
+	ENetAddress address = bench_server_address (server);
+	ENetPeer* peer = enet_host_connect (client, &address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("rtt: could not connect\n");
+
+		return 1;
+	}
+
+	size_t received = 0;
+	double start = bench_now ();
+
+	for (int iter = 0; received < RTT_PACKET_COUNT && bench_now () - start < RTT_TIMEOUT; iter++)
+	{
+		received += bench_drain (server);
+		bench_drain (client);
+
+		if (iter % RTT_SEND_INTERVAL == 0)
+		{
+			ENetPacket* packet = enet_packet_create ("x", 1, ENET_PACKET_FLAG_RELIABLE);
+
+			if (!packet
+				|| enet_peer_send (peer, 0, packet) < 0)
+			{
+				printf ("rtt: could not queue a packet\n");
+
+				return 1;
+			}
+
+			enet_host_flush (client);
+		}
+
+		bench_sleep (RTT_SLEEP);
+	}
+
+	printf ("%zu packets: rtt %u +- %u us (%u +- %u ms)\n",
+		received,
+		peer->roundTripTimeMicroseconds,
+		peer->roundTripTimeVarianceMicroseconds,
+		peer->roundTripTime,
+		peer->roundTripTimeVariance);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+	enet_deinitialize ();
+
+	return 0;
+}
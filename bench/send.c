@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*
+ * broadcast small packets to many peers over loopback
+ *
+ * the server broadcasts one unsequenced packet at a time and flushes it, so every flush sends
+ * 	one datagram to each peer
+ * runs once without batching and once for each batch limit, and reports the flush time per datagram
+ */
+
+#define SEND_PEER_COUNT 1000
+#define SEND_ROUNDS 200
+#define SEND_PACKET_SIZE 64
+// room for a whole broadcast at the clients, so the kernel does not drop any of it
+#define SEND_SOCKET_BUFFER_SIZE (8 * 1024 * 1024)
+
+static const size_t send_batch_limits[] = {0, 8, 32, 64};
+
+static int send_run (size_t batch_limit)
+{
+	static enet_uint8 data[SEND_PACKET_SIZE];
+	ENetHost* server = bench_create_server (SEND_PEER_COUNT, 1);
+	ENetHost* client = enet_host_create (NULL, SEND_PEER_COUNT, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("send: could not create hosts\n");
+
+		return 1;
+	}
+
+	enet_socket_set_option (client->socket, ENET_SOCKOPT_RCVBUF, SEND_SOCKET_BUFFER_SIZE);
+
+	ENetAddress address = bench_server_address (server);
+
+	for (int iter = 0; iter < SEND_PEER_COUNT; iter++)
+	{
+		if (!enet_host_connect (client, &address, 1, 0))
+		{
+			printf ("send: could not connect peer %i\n", iter);
+
+			return 1;
+		}
+	}
+
+	if (!bench_wait_for_connects (server, client, SEND_PEER_COUNT))
+	{
+		printf ("send: could not connect\n");
+
+		return 1;
+	}
+
+	if (batch_limit > 0)
+	{
+		enet_host_send_batch_limit (server, batch_limit);
+	}
+
+	memset (data, 1, sizeof (data));
+	server->totalSentPackets = 0;
+
+	size_t received = 0;
+	double elapsed = 0.0;
+
+	for (int round = 0; round < SEND_ROUNDS; round++)
+	{
+		ENetPacket* packet = enet_packet_create (data, sizeof (data), ENET_PACKET_FLAG_UNSEQUENCED);
+
+		if (!packet)
+		{
+			printf ("send: could not create a packet\n");
+
+			return 1;
+		}
+
+		enet_host_broadcast (server, 0, packet);
+
+		double start = bench_now ();
+
+		enet_host_flush (server);
+		elapsed += bench_now () - start;
+
+		received += bench_drain (client) / SEND_PACKET_SIZE;
+	}
+
+	printf ("batch limit %zu: %u datagrams sent, %zu packets received, %.0f ns per datagram\n",
+		batch_limit,
+		server->totalSentPackets,
+		received,
+		server->totalSentPackets ? elapsed * 1e9 / server->totalSentPackets : 0.0);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	return 0;
+}
+
+int main (void)
+{
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("send: could not initialize enet\n");
+
+		return 1;
+	}
+
+	for (size_t iter = 0; iter < sizeof (send_batch_limits) / sizeof (send_batch_limits[0]); iter++)
+	{
+		result |= send_run (send_batch_limits[iter]);
+	}
+
+	enet_deinitialize ();
+
+	return result;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/*
+ * the cost of one server enet_host_service (host, &event, 0) call with idle peers connected
+ *
+ * the peers send nothing but pings, so this is the bookkeeping enet does per call
+ * 	timeouts, pings and the send pass, for peers that mostly have nothing due
+ *
+ * usage: enet_bench_service [connected peers] [peer slots] [seconds]
+ * 	without arguments it runs a few sizes, ending with a mostly empty server
+ */
+
+#define SERVICE_DEFAULT_SECONDS 4.0
+// bigger than the default receive buffer, so thousands of pings arriving together are not dropped
+#define SERVICE_SOCKET_BUFFER_SIZE (8 * 1024 * 1024)
+// service the hosts this many times between short sleeps, so the clock keeps moving
+#define SERVICE_CALLS_PER_SLEEP 8
+
+static int service_run (int peer_count, int slot_count, double seconds)
+{
+	ENetEvent event;
+	ENetHost* server = bench_create_server (slot_count, 1);
+	ENetHost* client = enet_host_create (NULL, peer_count, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("service: could not create hosts\n");
+
+		return 1;
+	}
+
+	enet_socket_set_option (server->socket, ENET_SOCKOPT_RCVBUF, SERVICE_SOCKET_BUFFER_SIZE);
+	enet_socket_set_option (client->socket, ENET_SOCKOPT_RCVBUF, SERVICE_SOCKET_BUFFER_SIZE);
+
+	ENetAddress address = bench_server_address (server);
+
+	for (int iter = 0; iter < peer_count; iter++)
+	{
+		if (!enet_host_connect (client, &address, 1, 0))
+		{
+			printf ("service: could not connect peer %i\n", iter);
+
+			return 1;
+		}
+	}
+
+	if (!bench_wait_for_connects (server, client, peer_count))
+	{
+		printf ("service: peers did not connect\n");
+
+		return 1;
+	}
+
+	double service_time = 0.0;
+	long calls = 0;
+	enet_uint32 sent_packets = server->totalSentPackets;
+	double start = bench_now ();
+
+	while (bench_now () - start < seconds)
+	{
+		double call_start = bench_now ();
+
+		while (enet_host_service (server, &event, 0) > 0)
+		{
+			if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+			{
+				printf ("service: unexpected disconnect\n");
+
+				return 1;
+			}
+		}
+
+		service_time += bench_now () - call_start;
+		calls++;
+
+		bench_drain (client);
+
+		if (calls % SERVICE_CALLS_PER_SLEEP == 0)
+		{
+			bench_sleep (1000);
+		}
+	}
+
+	printf ("%5i peers in %5i slots: %.2f us per service call, %u datagrams sent (pings and acknowledgements)\n",
+		peer_count,
+		slot_count,
+		service_time / (double) calls * 1e6,
+		server->totalSentPackets - sent_packets);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	return 0;
+}
+
+int main (int argc, char** argv)
+{
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("service: could not initialize enet\n");
+
+		return 1;
+	}
+
+	if (argc > 1)
+	{
+		int peer_count = atoi (argv[1]);
+		int slot_count = argc > 2 ? atoi (argv[2]) : peer_count;
+		double seconds = argc > 3 ? atof (argv[3]) : SERVICE_DEFAULT_SECONDS;
+
+		if (peer_count < 1
+			|| slot_count < peer_count
+			|| slot_count > ENET_PROTOCOL_MAXIMUM_PEER_ID)
+		{
+			printf ("usage: %s [connected peers] [peer slots] [seconds]\n", argv[0]);
+
+			return 1;
+		}
+
+		result = service_run (peer_count, slot_count, seconds);
+	}
+	else
+	{
+		result |= service_run (100, 100, SERVICE_DEFAULT_SECONDS);
+		result |= service_run (1000, 1000, SERVICE_DEFAULT_SECONDS);
+		result |= service_run (2000, 2000, SERVICE_DEFAULT_SECONDS);
+		result |= service_run (8, ENET_PROTOCOL_MAXIMUM_PEER_ID, SERVICE_DEFAULT_SECONDS);
+	}
+
+	enet_deinitialize ();
+
+	return result;
+}
@@ -0,0 +1,201 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "enet/enet.h"
+#include "enet/time.h"
+
+/*
+ * random schedule, cancel and advance steps on a timer wheel, checked against a brute-force model
+ *
+ * the model keeps every live timer's deadline in an array, and after each step checks that
+ * 	no timer fired early or after being cancelled
+ * 	no timer was missed once the clock passed its deadline
+ * 	the wheel's next deadline is never later than the earliest live timer
+ *
+ * usage: enet_test_timer [start time] [seed]
+ * 	a start time just below 2^32 makes the clock wrap during the run
+ *
+ * prints TIMER OK and exits with 0 when every check passed
+ */
+
+#define TIMER_COUNT 2000
+#define TIMER_STEPS 3000000
+// the furthest deadline the test schedules, past the range the wheel covers
+#define TIMER_FAR_DEADLINE 40000000
+// what enet_timer_wheel_deadline returns when no timer is live
+#define TIMER_NO_DEADLINE 50000000
+
+static ENetTimer timer_timers[TIMER_COUNT];
+static bool timer_live[TIMER_COUNT];
+static enet_uint32 timer_deadlines[TIMER_COUNT];
+
+static int timer_random (int range)
+{
+	return rand () % range;
+}
+
+static enet_uint32 timer_pick_deadline (enet_uint32 now)
+{
+	// mostly near deadlines, like retransmits and pings, some far enough to cascade from the top level
+	if (timer_random (5) == 0)
+	{
+		return now + timer_random (TIMER_FAR_DEADLINE);
+	}
+
+	return now + timer_random (timer_random (3) ? 100 : 40000);
+}
+
+static bool timer_check_deadline (ENetTimerWheel* wheel, enet_uint32 now, enet_uint32* next)
+{
+	enet_uint32 earliest = now + TIMER_NO_DEADLINE;
+
+	*next = enet_timer_wheel_deadline (wheel, now + TIMER_NO_DEADLINE);
+
+	for (int iter = 0; iter < TIMER_COUNT; iter++)
+	{
+		if (timer_live[iter]
+			&& ENET_TIME_LESS (timer_deadlines[iter], earliest))
+		{
+			earliest = timer_deadlines[iter];
+		}
+	}
+
+	if (ENET_TIME_LESS (earliest, now))
+	{
+		earliest = now;
+	}
+
+	if (ENET_TIME_LESS (earliest, *next))
+	{
+		printf ("timer: deadline %u is later than the earliest live timer at %u, now %u\n", *next, earliest, now);
+
+		return false;
+	}
+
+	if (ENET_TIME_LESS (*next, now))
+	{
+		printf ("timer: deadline %u is in the past, now %u\n", *next, now);
+
+		return false;
+	}
+
+	return true;
+}
+
+static bool timer_advance (ENetTimerWheel* wheel, enet_uint32 now, long* fired)
+{
+	ENetTimer* timer;
+
+	enet_timer_wheel_advance (wheel, now);
+
+	while ((timer = enet_timer_wheel_pop_expired (wheel)) != NULL)
+	{
+		int index = (int) (timer - timer_timers);
+
+		if (!timer_live[index]
+			|| ENET_TIME_LESS (now, timer_deadlines[index]))
+		{
+			printf ("timer: timer %i fired early or after being cancelled, deadline %u, now %u\n", index, timer_deadlines[index], now);
+
+			return false;
+		}
+
+		timer_live[index] = false;
+		(*fired)++;
+	}
+
+	for (int iter = 0; iter < TIMER_COUNT; iter++)
+	{
+		if (timer_live[iter]
+			&& ENET_TIME_LESS_EQUAL (timer_deadlines[iter], now))
+		{
+			printf ("timer: timer %i was missed, deadline %u, now %u\n", iter, timer_deadlines[iter], now);
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main (int argc, char** argv)
+{
+	ENetTimerWheel wheel;
+	enet_uint32 now = argc > 1 ? (enet_uint32) strtoul (argv[1], NULL, 0) : 0;
+	long fired = 0;
+
+	srand (argc > 2 ? (unsigned int) atoi (argv[2]) : 1);
+
+	enet_timer_wheel_initialize (&wheel, now);
+
+	for (int iter = 0; iter < TIMER_COUNT; iter++)
+	{
+		enet_timer_initialize (&timer_timers[iter]);
+	}
+
+	for (long step = 0; step < TIMER_STEPS; step++)
+	{
+		int operation = timer_random (10);
+		int index = timer_random (TIMER_COUNT);
+		enet_uint32 next;
+
+		if (operation < 4)
+		{
+			timer_deadlines[index] = timer_pick_deadline (now);
+			timer_live[index] = true;
+			enet_timer_wheel_schedule (&wheel, &timer_timers[index], timer_deadlines[index]);
+		}
+		else if (operation < 5)
+		{
+			timer_live[index] = false;
+			enet_timer_wheel_cancel (&wheel, &timer_timers[index]);
+		}
+		else if (operation < 6)
+		{
+			if (!timer_check_deadline (&wheel, now, &next))
+			{
+				return 1;
+			}
+
+			// sometimes jump straight to the deadline, as enet_host_service does after waiting for it
+			if (timer_random (2))
+			{
+				now = next;
+
+				if (!timer_advance (&wheel, now, &fired))
+				{
+					return 1;
+				}
+			}
+		}
+		else
+		{
+			now += timer_random (7) == 0 ? timer_random (70000) : timer_random (5);
+
+			if (!timer_advance (&wheel, now, &fired))
+			{
+				return 1;
+			}
+		}
+	}
+
+	size_t live = 0;
+
+	for (int iter = 0; iter < TIMER_COUNT; iter++)
+	{
+		live += timer_live[iter];
+	}
+
+	if (live != wheel.timerCount)
+	{
+		printf ("timer: the wheel counts %zu timers, the model %zu\n", wheel.timerCount, live);
+
+		return 1;
+	}
+
+	printf ("timer: %ld timers fired, clock ended at %u\n", fired, now);
+	printf ("TIMER OK\n");
+
+	return 0;
+}
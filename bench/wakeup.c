@@ -0,0 +1,208 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "bench.h"
+
+/*
+ * round trip time and idle cost of a server thread, polling against blocking
+ *
+ * the server thread echoes every packet it receives
+ * 	polling, it services the host without waiting and then sleeps 10 ms, like the demo's 100 Hz loop
+ * 	blocking, it waits in enet_host_service for up to a second and is woken through enet_host_wakeup to stop
+ * the client times WAKEUP_ROUND_TRIPS reliable round trips, then the server thread's cpu time is
+ * 	measured over a second with nothing to do
+ */
+
+#define WAKEUP_ROUND_TRIPS 100
+#define WAKEUP_POLL_SLEEP 10000
+#define WAKEUP_BLOCKING_TIMEOUT 1000
+#define WAKEUP_IDLE_TIME 1.0
+
+typedef struct wakeup_server_s
+{
+	ENetHost* host;
+	bool blocking;
+	atomic_bool stop;
+} Wakeup_server;
+
+static void* wakeup_server_thread (void* data)
+{
+	Wakeup_server* server = data;
+	ENetEvent event;
+
+	while (!atomic_load (&server->stop))
+	{
+		enet_uint32 timeout = server->blocking ? WAKEUP_BLOCKING_TIMEOUT : 0;
+
+		while (enet_host_service (server->host, &event, timeout) > 0)
+		{
+			timeout = 0;
+
+			if (event.type == ENET_EVENT_TYPE_RECEIVE)
+			{
+				ENetPacket* echo = enet_packet_create (event.packet->data, event.packet->dataLength, ENET_PACKET_FLAG_RELIABLE);
+
+				if (echo
+					&& enet_peer_send (event.peer, 0, echo) < 0)
+				{
+					enet_packet_destroy (echo);
+				}
+
+				enet_packet_destroy (event.packet);
+			}
+		}
+
+		if (!server->blocking)
+		{
+			bench_sleep (WAKEUP_POLL_SLEEP);
+		}
+	}
+
+	return NULL;
+}
+
+static double wakeup_thread_time (pthread_t thread)
+{
+	clockid_t clock;
+	struct timespec now;
+
+	if (pthread_getcpuclockid (thread, &clock) != 0
+		|| clock_gettime (clock, &now) != 0)
+	{
+		return 0.0;
+	}
+
+	return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+static bool wakeup_receive (ENetHost* client)
+{
+	ENetEvent event;
+	double start = bench_now ();
+
+	while (bench_now () - start < BENCH_CONNECT_TIMEOUT)
+	{
+		if (enet_host_service (client, &event, 100) > 0
+			&& event.type == ENET_EVENT_TYPE_RECEIVE)
+		{
+			enet_packet_destroy (event.packet);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int wakeup_run (bool blocking)
+{
+	pthread_t thread;
+	ENetEvent event;
+	Wakeup_server server =
+	{
+		.host = bench_create_server (1, 1),
+		.blocking = blocking
+	};
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	atomic_init (&server.stop, false);
+
+	if (!server.host || !client
+		|| enet_host_enable_wakeup (server.host) < 0)
+	{
+		printf ("wakeup: could not create hosts\n");
+
+		return 1;
+	}
+
+	ENetAddress address = bench_server_address (server.host);
+	ENetPeer* peer = enet_host_connect (client, &address, 1, 0);
+
+	if (!peer
+		|| pthread_create (&thread, NULL, wakeup_server_thread, &server) != 0)
+	{
+		printf ("wakeup: could not start the server\n");
+
+		return 1;
+	}
+
+	bool connected = false;
+	double start = bench_now ();
+
+	while (!connected
+		&& bench_now () - start < BENCH_CONNECT_TIMEOUT)
+	{
+		connected = enet_host_service (client, &event, 100) > 0 && event.type == ENET_EVENT_TYPE_CONNECT;
+	}
+
+	double total = 0.0;
+	int round_trips = 0;
+
+	while (connected
+		&& round_trips < WAKEUP_ROUND_TRIPS)
+	{
+		ENetPacket* packet = enet_packet_create ("x", 1, ENET_PACKET_FLAG_RELIABLE);
+
+		start = bench_now ();
+		if (!packet
+			|| enet_peer_send (peer, 0, packet) < 0
+			|| !wakeup_receive (client))
+		{
+			break;
+		}
+
+		total += bench_now () - start;
+		round_trips++;
+	}
+
+	// keep acknowledging the server while it idles, as a connected client would
+	double idle_start = wakeup_thread_time (thread);
+
+	start = bench_now ();
+	while (bench_now () - start < WAKEUP_IDLE_TIME)
+	{
+		enet_host_service (client, &event, 100);
+	}
+
+	double idle = (wakeup_thread_time (thread) - idle_start) / (bench_now () - start);
+
+	start = bench_now ();
+	atomic_store (&server.stop, true);
+	enet_host_wakeup (server.host);
+	pthread_join (thread, NULL);
+
+	double stop = bench_now () - start;
+
+	printf ("%s: mean round trip %.0f us over %i, idle server thread cpu %.2f ms/s, stopped in %.0f us\n",
+		blocking ? "blocking" : "polling",
+		round_trips ? total * 1e6 / round_trips : 0.0,
+		round_trips,
+		idle * 1e3,
+		stop * 1e6);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server.host);
+
+	return round_trips < WAKEUP_ROUND_TRIPS;
+}
+
+int main (void)
+{
+	int result = 0;
+
+	if (enet_initialize () != 0)
+	{
+		printf ("wakeup: could not initialize enet\n");
+
+		return 1;
+	}
+
+	result |= wakeup_run (false);
+	result |= wakeup_run (true);
+
+	enet_deinitialize ();
+
+	return result;
+}
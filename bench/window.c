@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "relay.h"
+
+/*
+ * bulk reliable transfer through a relay that emulates a fast, distant link
+ *
+ * the client keeps its send queue full for the whole run, so the link stays saturated
+ * 	as far as the reliable window and the congestion controller let it
+ * every controller runs once with enet's old 64 KB window and once with a 4 MB window
+ *
+ * first, pairs of window limits connect over plain loopback, and both ends must agree on
+ * 	the lesser offer
+ * 	a host that predates window scaling offers at most 64 KB, the same as a host left at
+ * 	the default limit, so the default stands in for one
+ *
+ * usage: enet_bench_window [seconds per run]
+ */
+
+#define WINDOW_LINK_RATE (50.0 * 1000 * 1000)
+#define WINDOW_LINK_DELAY 0.010
+#define WINDOW_LINK_BUFFER (2.0 * 1024 * 1024)
+#define WINDOW_LARGE_SIZE (4 * 1024 * 1024)
+#define WINDOW_PACKET_SIZE 1200
+// how many packets the client keeps queued
+#define WINDOW_QUEUE_DEPTH 512
+#define WINDOW_DEFAULT_SECONDS 5.0
+#define WINDOW_SAMPLE_INTERVAL 0.5
+
+typedef enum
+{
+	WINDOW_CONTROLLER_THROTTLE,
+	WINDOW_CONTROLLER_CUBIC,
+	WINDOW_CONTROLLER_BBR
+} Window_controller;
+
+static const char* window_controller_names[] = {"throttle", "cubic", "bbr"};
+
+static int window_negotiate (enet_uint32 server_limit, enet_uint32 client_limit)
+{
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("window: could not create hosts\n");
+
+		return 1;
+	}
+
+	enet_host_window_limit (server, server_limit);
+	enet_host_window_limit (client, client_limit);
+
+	ENetAddress address = bench_server_address (server);
+	ENetPeer* peer = enet_host_connect (client, &address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("window: could not connect\n");
+
+		return 1;
+	}
+
+	enet_uint32 expected = server_limit < client_limit ? server_limit : client_limit;
+	enet_uint32 server_window = server->peers[0].windowSize;
+	enet_uint32 client_window = peer->windowSize;
+
+	printf ("server offers %5u KB, client offers %5u KB: server uses %5u KB, client uses %5u KB\n",
+		server_limit / 1024,
+		client_limit / 1024,
+		server_window / 1024,
+		client_window / 1024);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	return server_window != expected || client_window != expected;
+}
+
+static int window_run (Window_controller controller, enet_uint32 window_size, double seconds)
+{
+	static enet_uint8 data[WINDOW_PACKET_SIZE];
+	Relay relay =
+	{
+		.rate = WINDOW_LINK_RATE,
+		.delay = WINDOW_LINK_DELAY,
+		.buffer = WINDOW_LINK_BUFFER
+	};
+	ENetHost* server = bench_create_server (1, 1);
+	ENetHost* client = enet_host_create (NULL, 1, 1, 0, 0);
+
+	if (!server || !client)
+	{
+		printf ("window: could not create hosts\n");
+
+		return 1;
+	}
+
+	relay.server_address = bench_server_address (server);
+	if (!relay_start (&relay))
+	{
+		printf ("window: could not start the relay\n");
+
+		return 1;
+	}
+
+	// each side keeps the lesser of the two offers
+	enet_host_window_limit (server, window_size);
+	enet_host_window_limit (client, window_size);
+
+	switch (controller)
+	{
+		case WINDOW_CONTROLLER_CUBIC:
+			enet_host_congestion_control_with_cubic (client);
+			break;
+		case WINDOW_CONTROLLER_BBR:
+			enet_host_congestion_control_with_bbr (client);
+			break;
+		default:
+			break;
+	}
+
+	ENetPeer* peer = enet_host_connect (client, &relay.address, 1, 0);
+
+	if (!peer
+		|| !bench_wait_for_connects (server, client, 1))
+	{
+		printf ("window: could not connect\n");
+		relay_stop (&relay);
+
+		return 1;
+	}
+
+	size_t received = 0;
+	double round_trip_sum = 0.0;
+	int round_trip_samples = 0;
+	enet_uint32 packets_lost = peer->packetsLost;
+	double start = bench_now ();
+	double next_sample = start + WINDOW_SAMPLE_INTERVAL;
+
+	while (bench_now () - start < seconds)
+	{
+		while (enet_list_size (&peer->outgoingCommands) < WINDOW_QUEUE_DEPTH)
+		{
+			ENetPacket* packet = enet_packet_create (data, sizeof (data), ENET_PACKET_FLAG_RELIABLE);
+
+			if (!packet
+				|| enet_peer_send (peer, 0, packet) < 0)
+			{
+				printf ("window: could not queue a packet\n");
+				relay_stop (&relay);
+
+				return 1;
+			}
+		}
+
+		bench_drain (client);
+		received += bench_drain (server);
+
+		if (bench_now () >= next_sample)
+		{
+			round_trip_sum += peer->roundTripTimeMicroseconds;
+			round_trip_samples++;
+			next_sample += WINDOW_SAMPLE_INTERVAL;
+		}
+
+		bench_sleep (50);
+	}
+
+	// the relay's counters are only safe to read once its thread is done
+	relay_stop (&relay);
+
+	printf ("%-8s %5u KB window (%5u KB agreed): %6.2f MB/s, mean rtt %6.1f ms, %u lost, %lld dropped at the bottleneck\n",
+		window_controller_names[controller],
+		window_size / 1024,
+		peer->windowSize / 1024,
+		(double) received / seconds / 1e6,
+		round_trip_samples ? round_trip_sum / round_trip_samples / 1e3 : 0.0,
+		peer->packetsLost - packets_lost,
+		relay.dropped);
+
+	enet_host_destroy (client);
+	enet_host_destroy (server);
+
+	return 0;
+}
+
+int main (int argc, char** argv)
+{
+	double seconds = argc > 1 ? atof (argv[1]) : WINDOW_DEFAULT_SECONDS;
+	int result = 0;
+
+	if (seconds <= 0.0)
+	{
+		printf ("usage: %s [seconds per run]\n", argv[0]);
+
+		return 1;
+	}
+
+	if (enet_initialize () != 0)
+	{
+		printf ("window: could not initialize enet\n");
+
+		return 1;
+	}
+
+	result |= window_negotiate (WINDOW_LARGE_SIZE, 1024 * 1024);
+	result |= window_negotiate (WINDOW_LARGE_SIZE, ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE);
+	result |= window_negotiate (ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE, 1024 * 1024);
+	result |= window_negotiate (ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE, WINDOW_LARGE_SIZE);
+
+	printf ("link %.0f MB/s, rtt %.0f ms, %.0f KB bottleneck buffer\n", WINDOW_LINK_RATE / 1e6, WINDOW_LINK_DELAY * 2e3, WINDOW_LINK_BUFFER / 1024);
+
+	for (int controller = WINDOW_CONTROLLER_THROTTLE; controller <= WINDOW_CONTROLLER_BBR; controller++)
+	{
+		result |= window_run (controller, ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE, seconds);
+		result |= window_run (controller, WINDOW_LARGE_SIZE, seconds);
+	}
+
+	enet_deinitialize ();
+
+	return result;
+}
@@ -0,0 +1,273 @@
+/**
+ @file  checksum.c
+ @brief ENet CRC32 and CRC32C checksum callbacks
+*/
+#include <string.h>
+#define ENET_BUILDING_LIB 1
+#include "enet/enet.h"
+
+#if (defined (__GNUC__) || defined (__clang__)) && (defined (__x86_64__) || defined (__i386__))
+#define ENET_CHECKSUM_X86 1
+#define ENET_CHECKSUM_TARGET(features) __attribute__ ((target (features)))
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#elif defined (_MSC_VER) && (defined (_M_X64) || defined (_M_IX86))
+#define ENET_CHECKSUM_X86 1
+#define ENET_CHECKSUM_TARGET(features)
+#include <intrin.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+/** @defgroup checksum ENet checksum functions
+    @{
+*/
+
+typedef enet_uint32 (* ENetCRCUpdate) (enet_uint32 crc, const enet_uint8 * data, size_t length);
+
+enum
+{
+   ENET_CRC32_POLYNOMIAL  = 0xEDB88320, /* IEEE 802.3, bit reflected */
+   ENET_CRC32C_POLYNOMIAL = 0x82F63B78, /* Castagnoli, bit reflected */
+
+   /* below this a buffer is not worth setting up the carry-less multiply for */
+   ENET_CRC32_FOLD_MINIMUM = 64
+};
+
+/* Table n holds the CRC of each byte followed by n zero bytes, so eight bytes can be folded in
+   with eight independent lookups instead of eight dependent ones. */
+static enet_uint32 crc32Tables [8] [256];
+static enet_uint32 crc32cTables [8] [256];
+
+static void
+enet_crc_initialize_tables (enet_uint32 tables [8] [256], enet_uint32 polynomial)
+{
+    int byte, slice;
+
+    for (byte = 0; byte < 256; ++ byte)
+    {
+        enet_uint32 crc = byte;
+        int bit;
+
+        for (bit = 0; bit < 8; ++ bit)
+          crc = (crc >> 1) ^ (polynomial & (0 - (crc & 1)));
+
+        tables [0] [byte] = crc;
+    }
+
+    for (byte = 0; byte < 256; ++ byte)
+    {
+        for (slice = 1; slice < 8; ++ slice)
+          tables [slice] [byte] = (tables [slice - 1] [byte] >> 8) ^ tables [0] [tables [slice - 1] [byte] & 0xFF];
+    }
+}
+
+static enet_uint32
+enet_crc_update_slicing (enet_uint32 tables [8] [256], enet_uint32 crc, const enet_uint8 * data, size_t length)
+{
+    for (; length >= 8; data += 8, length -= 8)
+    {
+        enet_uint32 low = crc ^ ((enet_uint32) data [0] | ((enet_uint32) data [1] << 8) | ((enet_uint32) data [2] << 16) | ((enet_uint32) data [3] << 24)),
+                    high = (enet_uint32) data [4] | ((enet_uint32) data [5] << 8) | ((enet_uint32) data [6] << 16) | ((enet_uint32) data [7] << 24);
+
+        crc = tables [7] [low & 0xFF] ^ tables [6] [(low >> 8) & 0xFF] ^ tables [5] [(low >> 16) & 0xFF] ^ tables [4] [low >> 24] ^
+              tables [3] [high & 0xFF] ^ tables [2] [(high >> 8) & 0xFF] ^ tables [1] [(high >> 16) & 0xFF] ^ tables [0] [high >> 24];
+    }
+
+    while (length -- > 0)
+      crc = (crc >> 8) ^ tables [0] [(crc ^ * data ++) & 0xFF];
+
+    return crc;
+}
+
+static enet_uint32
+enet_crc32_update_slicing (enet_uint32 crc, const enet_uint8 * data, size_t length)
+{
+    return enet_crc_update_slicing (crc32Tables, crc, data, length);
+}
+
+static enet_uint32
+enet_crc32c_update_slicing (enet_uint32 crc, const enet_uint8 * data, size_t length)
+{
+    return enet_crc_update_slicing (crc32cTables, crc, data, length);
+}
+
+#ifdef ENET_CHECKSUM_X86
+
+ENET_CHECKSUM_TARGET ("sse4.2")
+static enet_uint32
+enet_crc32c_update_sse42 (enet_uint32 crc, const enet_uint8 * data, size_t length)
+{
+#if defined (__x86_64__) || defined (_M_X64)
+    unsigned long long crc64 = crc;
+
+    for (; length >= 8; data += 8, length -= 8)
+    {
+        unsigned long long word;
+
+        memcpy (& word, data, sizeof (word));
+
+        crc64 = _mm_crc32_u64 (crc64, word);
+    }
+
+    crc = (enet_uint32) crc64;
+#endif
+
+    for (; length >= 4; data += 4, length -= 4)
+    {
+        enet_uint32 word;
+
+        memcpy (& word, data, sizeof (word));
+
+        crc = _mm_crc32_u32 (crc, word);
+    }
+
+    while (length -- > 0)
+      crc = _mm_crc32_u8 (crc, * data ++);
+
+    return crc;
+}
+
+/* Folds 16 byte blocks together with carry-less multiplies and Barrett-reduces what is left to
+   32 bits, after "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+   (Gopal et al., Intel, 2009). The constants are for the bit reflected IEEE polynomial. */
+ENET_CHECKSUM_TARGET ("pclmul,sse4.1")
+static enet_uint32
+enet_crc32_update_pclmul (enet_uint32 crc, const enet_uint8 * data, size_t length)
+{
+    const __m128i fold4 = _mm_set_epi64x (0x01C6E41596LL, 0x0154442BD4LL),
+                  fold1 = _mm_set_epi64x (0x00CCAA009ELL, 0x01751997D0LL),
+                  fold64 = _mm_set_epi64x (0, 0x0163CD6124LL),
+                  barrett = _mm_set_epi64x (0x01F7011641LL, 0x01DB710641LL),
+                  low32 = _mm_setr_epi32 (~0, 0, ~0, 0);
+    __m128i x1, x2, x3, x4, t1, t2, t3, t4;
+    size_t folded;
+
+    if (length < ENET_CRC32_FOLD_MINIMUM)
+      return enet_crc32_update_slicing (crc, data, length);
+
+    folded = length & ~ (size_t) 15;
+
+    x1 = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) data), _mm_cvtsi32_si128 ((int) crc));
+    x2 = _mm_loadu_si128 ((const __m128i *) (data + 16));
+    x3 = _mm_loadu_si128 ((const __m128i *) (data + 32));
+    x4 = _mm_loadu_si128 ((const __m128i *) (data + 48));
+
+    data += 64;
+    length -= 64;
+    folded -= 64;
+
+    for (; folded >= 64; data += 64, length -= 64, folded -= 64)
+    {
+        t1 = _mm_clmulepi64_si128 (x1, fold4, 0x00);
+        t2 = _mm_clmulepi64_si128 (x2, fold4, 0x00);
+        t3 = _mm_clmulepi64_si128 (x3, fold4, 0x00);
+        t4 = _mm_clmulepi64_si128 (x4, fold4, 0x00);
+
+        x1 = _mm_clmulepi64_si128 (x1, fold4, 0x11);
+        x2 = _mm_clmulepi64_si128 (x2, fold4, 0x11);
+        x3 = _mm_clmulepi64_si128 (x3, fold4, 0x11);
+        x4 = _mm_clmulepi64_si128 (x4, fold4, 0x11);
+
+        x1 = _mm_xor_si128 (_mm_xor_si128 (x1, t1), _mm_loadu_si128 ((const __m128i *) data));
+        x2 = _mm_xor_si128 (_mm_xor_si128 (x2, t2), _mm_loadu_si128 ((const __m128i *) (data + 16)));
+        x3 = _mm_xor_si128 (_mm_xor_si128 (x3, t3), _mm_loadu_si128 ((const __m128i *) (data + 32)));
+        x4 = _mm_xor_si128 (_mm_xor_si128 (x4, t4), _mm_loadu_si128 ((const __m128i *) (data + 48)));
+    }
+
+    t1 = _mm_clmulepi64_si128 (x1, fold1, 0x00);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x1, fold1, 0x11), t1), x2);
+    t1 = _mm_clmulepi64_si128 (x1, fold1, 0x00);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x1, fold1, 0x11), t1), x3);
+    t1 = _mm_clmulepi64_si128 (x1, fold1, 0x00);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x1, fold1, 0x11), t1), x4);
+
+    for (; folded >= 16; data += 16, length -= 16, folded -= 16)
+    {
+        t1 = _mm_clmulepi64_si128 (x1, fold1, 0x00);
+        x1 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x1, fold1, 0x11), t1), _mm_loadu_si128 ((const __m128i *) data));
+    }
+
+    /* 128 bits down to 64 */
+    t1 = _mm_clmulepi64_si128 (x1, fold1, 0x10);
+    x1 = _mm_xor_si128 (_mm_srli_si128 (x1, 8), t1);
+    t1 = _mm_srli_si128 (x1, 4);
+    x1 = _mm_xor_si128 (_mm_clmulepi64_si128 (_mm_and_si128 (x1, low32), fold64, 0x00), t1);
+
+    /* Barrett reduction to 32 */
+    t1 = _mm_clmulepi64_si128 (_mm_and_si128 (x1, low32), barrett, 0x10);
+    t1 = _mm_clmulepi64_si128 (_mm_and_si128 (t1, low32), barrett, 0x00);
+    x1 = _mm_xor_si128 (x1, t1);
+
+    crc = (enet_uint32) _mm_extract_epi32 (x1, 1);
+
+    return enet_crc32_update_slicing (crc, data, length);
+}
+
+static int
+enet_cpu_supports (int sse42)
+{
+#ifdef _MSC_VER
+    int info [4];
+
+    __cpuid (info, 1);
+
+    return sse42 ? (info [2] & (1 << 20)) != 0 : (info [2] & ((1 << 1) | (1 << 19))) == ((1 << 1) | (1 << 19));
+#else
+    __builtin_cpu_init ();
+
+    return sse42 ? __builtin_cpu_supports ("sse4.2") : __builtin_cpu_supports ("pclmul") && __builtin_cpu_supports ("sse4.1");
+#endif
+}
+
+#endif /* ENET_CHECKSUM_X86 */
+
+static ENetCRCUpdate crc32Update = enet_crc32_update_slicing;
+static ENetCRCUpdate crc32cUpdate = enet_crc32c_update_slicing;
+
+/** Builds the lookup tables and picks the fastest kernels this CPU supports. Called once from
+    enet_initialize(), so the checksum callbacks themselves never have to check.
+*/
+void
+enet_checksum_initialize (void)
+{
+    enet_crc_initialize_tables (crc32Tables, ENET_CRC32_POLYNOMIAL);
+    enet_crc_initialize_tables (crc32cTables, ENET_CRC32C_POLYNOMIAL);
+
+#ifdef ENET_CHECKSUM_X86
+    if (enet_cpu_supports (0))
+      crc32Update = enet_crc32_update_pclmul;
+
+    if (enet_cpu_supports (1))
+      crc32cUpdate = enet_crc32c_update_sse42;
+#endif
+}
+
+static enet_uint32
+enet_crc_buffers (ENetCRCUpdate update, const ENetBuffer * buffers, size_t bufferCount)
+{
+    enet_uint32 crc = 0xFFFFFFFF;
+
+    for (; bufferCount > 0; ++ buffers, -- bufferCount)
+      crc = update (crc, (const enet_uint8 *) buffers -> data, buffers -> dataLength);
+
+    return ENET_HOST_TO_NET_32 (~ crc);
+}
+
+/** Computes the IEEE 802.3 CRC32 of the buffers, folded with PCLMULQDQ where the CPU has it. */
+enet_uint32
+enet_crc32 (const ENetBuffer * buffers, size_t bufferCount)
+{
+    return enet_crc_buffers (crc32Update, buffers, bufferCount);
+}
+
+/** Computes the Castagnoli CRC32C of the buffers, on the crc32 instruction where the CPU has
+    SSE4.2. Not compatible with enet_crc32(); set the same one as ENetHost::checksum on both ends.
+*/
+enet_uint32
+enet_crc32c (const ENetBuffer * buffers, size_t bufferCount)
+{
+    return enet_crc_buffers (crc32cUpdate, buffers, bufferCount);
+}
+
+/** @} */
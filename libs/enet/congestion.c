@@ -0,0 +1,466 @@
+/**
+ @file  congestion.c
+ @brief ENet CUBIC and BBR congestion controllers
+*/
+#include <string.h>
+#define ENET_BUILDING_LIB 1
+#include "enet/utility.h"
+#include "enet/enet.h"
+
+/** @defgroup congestion ENet congestion control functions
+    @{
+*/
+
+enum
+{
+   ENET_CUBIC_PACING_GAIN_SLOW_START = 2 * ENET_CONGESTION_GAIN_SCALE,
+   ENET_CUBIC_PACING_GAIN            = 307,   /* 1.2 */
+
+   ENET_BBR_STARTUP_GAIN             = 739,   /* 2 / ln 2, the least that still doubles the rate each round */
+   ENET_BBR_DRAIN_GAIN               = 88,    /* the inverse, to empty the queue startup built */
+   ENET_BBR_WINDOW_GAIN              = 2 * ENET_CONGESTION_GAIN_SCALE
+};
+
+/* CUBIC's C, in datagrams per second cubed */
+#define ENET_CUBIC_SCALE 0.4
+
+/* Probes for more bandwidth for a round trip, drains what that queued for one, then cruises. */
+static const enet_uint16 bbrGainCycle [ENET_BBR_GAIN_CYCLE_LENGTH] = { 320, 192, 256, 256, 256, 256, 256, 256 };
+
+static enet_uint32
+enet_congestion_pacing_rate (ENetPeer * peer, enet_uint32 gain)
+{
+    unsigned long long rate = (unsigned long long) peer -> congestion.window * 1000000 / ENET_MAX (peer -> roundTripTimeMicroseconds, 1);
+
+    rate = rate * gain / ENET_CONGESTION_GAIN_SCALE;
+
+    return rate > 0xFFFFFFFF ? 0xFFFFFFFF : (enet_uint32) rate;
+}
+
+static double
+enet_cubic_root (double value)
+{
+    double root = 1.0 + value / 3.0, last;
+    int iterations;
+
+    if (value <= 0.0)
+      return 0.0;
+
+    for (iterations = 0; iterations < 64; ++ iterations)
+    {
+        last = root;
+        root = (2.0 * root + value / (root * root)) / 3.0;
+        if (last - root < 1e-6 && root - last < 1e-6)
+          break;
+    }
+
+    return root;
+}
+
+/** Starts CUBIC in slow start with an initial window of ENET_CONGESTION_INITIAL_WINDOW datagrams. */
+void
+enet_cubic_reset (ENetPeer * peer)
+{
+    ENetCubicState * cubic = & peer -> congestion.state.cubic;
+
+    memset (cubic, 0, sizeof (* cubic));
+
+    cubic -> slowStartThreshold = ~0u;
+
+    peer -> congestion.window = ENET_CONGESTION_INITIAL_WINDOW * peer -> mtu;
+    peer -> congestion.pacingRate = enet_congestion_pacing_rate (peer, ENET_CUBIC_PACING_GAIN_SLOW_START);
+}
+
+/** Grows the window by the acknowledged bytes in slow start, and otherwise along the cubic curve
+    centered on the window the last loss happened at (RFC 8312), never slower than Reno would.
+*/
+void
+enet_cubic_acknowledge (ENetPeer * peer, enet_uint32 acknowledgedBytes, enet_uint32 roundTripTime)
+{
+    ENetCubicState * cubic = & peer -> congestion.state.cubic;
+    enet_uint32 window = peer -> congestion.window,
+                serviceTime = peer -> host -> serviceTimeMicroseconds;
+
+    (void) roundTripTime;
+
+    if (acknowledgedBytes == 0)
+      return;
+
+    if (window < cubic -> slowStartThreshold)
+      window += acknowledgedBytes;
+    else
+    {
+        double mtu = peer -> mtu, elapsed, target;
+
+        if (cubic -> epochStart == 0)
+        {
+            cubic -> epochStart = ENET_MAX (serviceTime, 1);
+            cubic -> windowEstimate = window;
+
+            if (window < cubic -> windowMaximum)
+            {
+                cubic -> epochOffset = (enet_uint32) (enet_cubic_root ((cubic -> windowMaximum - window) / (ENET_CUBIC_SCALE * mtu)) * 1000000.0);
+                cubic -> windowOrigin = cubic -> windowMaximum;
+            }
+            else
+            {
+                cubic -> epochOffset = 0;
+                cubic -> windowOrigin = window;
+            }
+        }
+
+        /* The curve is read a round trip ahead, where the window should be once this data is acknowledged. */
+        elapsed = ((double) (serviceTime - cubic -> epochStart) + peer -> roundTripTimeMicroseconds - cubic -> epochOffset) / 1000000.0;
+        target = cubic -> windowOrigin + ENET_CUBIC_SCALE * mtu * elapsed * elapsed * elapsed;
+
+        if (target < window)
+          target = window;
+        else
+        if (target > 1.5 * window)
+          target = 1.5 * window;
+
+        /* Reno grows by 3 (1 - beta) / (1 + beta) datagrams a round trip at the same loss rate. */
+        cubic -> windowEstimate += (enet_uint32) ((3.0 * (ENET_CONGESTION_GAIN_SCALE - ENET_CUBIC_BETA) / (ENET_CONGESTION_GAIN_SCALE + ENET_CUBIC_BETA)) * mtu * acknowledgedBytes / window);
+        if (target < cubic -> windowEstimate)
+          target = cubic -> windowEstimate;
+
+        window += (enet_uint32) ((target - window) * acknowledgedBytes / window);
+    }
+
+    peer -> congestion.window = window;
+    peer -> congestion.pacingRate = enet_congestion_pacing_rate (peer, window < cubic -> slowStartThreshold ? ENET_CUBIC_PACING_GAIN_SLOW_START : ENET_CUBIC_PACING_GAIN);
+}
+
+/** Shrinks the window by beta, at most once a round trip. */
+void
+enet_cubic_lose (ENetPeer * peer, enet_uint32 lostBytes)
+{
+    ENetCubicState * cubic = & peer -> congestion.state.cubic;
+    enet_uint32 window = peer -> congestion.window,
+                serviceTime = peer -> host -> serviceTimeMicroseconds;
+
+    (void) lostBytes;
+
+    if (cubic -> recoveryStart != 0 &&
+        serviceTime - cubic -> recoveryStart < peer -> roundTripTimeMicroseconds)
+      return;
+
+    cubic -> recoveryStart = ENET_MAX (serviceTime, 1);
+    cubic -> epochStart = 0;
+
+    /* A flow still losing below its last maximum gives up bandwidth a little faster. */
+    if (window < cubic -> windowMaximum)
+      cubic -> windowMaximum = (enet_uint32) ((unsigned long long) window * (ENET_CONGESTION_GAIN_SCALE + ENET_CUBIC_BETA) / (2 * ENET_CONGESTION_GAIN_SCALE));
+    else
+      cubic -> windowMaximum = window;
+
+    window = (enet_uint32) ((unsigned long long) window * ENET_CUBIC_BETA / ENET_CONGESTION_GAIN_SCALE);
+    window = ENET_MAX (window, ENET_CONGESTION_MINIMUM_WINDOW * peer -> mtu);
+
+    cubic -> slowStartThreshold = window;
+
+    peer -> congestion.window = window;
+    peer -> congestion.pacingRate = enet_congestion_pacing_rate (peer, ENET_CUBIC_PACING_GAIN);
+}
+
+/** Sets CUBIC as the host's congestion controller.
+    @param host host to set CUBIC for
+*/
+void
+enet_host_congestion_control_with_cubic (ENetHost * host)
+{
+    ENetCongestionControl congestionControl;
+    congestionControl.reset = enet_cubic_reset;
+    congestionControl.acknowledge = enet_cubic_acknowledge;
+    congestionControl.lose = enet_cubic_lose;
+    enet_host_congestion_control (host, & congestionControl);
+}
+
+/* Keeps the best three delivery rates of the last ENET_BBR_BANDWIDTH_ROUNDS rounds, each from a
+   later part of the window than the one before, so the maximum can age out without a history. */
+static void
+enet_bbr_update_bandwidth (ENetBBRState * bbr, enet_uint32 bandwidth)
+{
+    enet_uint32 round = bbr -> roundCount, age;
+
+    if (bandwidth >= bbr -> bandwidth [0] || round - bbr -> bandwidthRound [2] > ENET_BBR_BANDWIDTH_ROUNDS)
+    {
+        bbr -> bandwidth [0] = bbr -> bandwidth [1] = bbr -> bandwidth [2] = bandwidth;
+        bbr -> bandwidthRound [0] = bbr -> bandwidthRound [1] = bbr -> bandwidthRound [2] = round;
+        return;
+    }
+
+    if (bandwidth >= bbr -> bandwidth [1])
+    {
+        bbr -> bandwidth [1] = bbr -> bandwidth [2] = bandwidth;
+        bbr -> bandwidthRound [1] = bbr -> bandwidthRound [2] = round;
+    }
+    else
+    if (bandwidth >= bbr -> bandwidth [2])
+    {
+        bbr -> bandwidth [2] = bandwidth;
+        bbr -> bandwidthRound [2] = round;
+    }
+
+    age = round - bbr -> bandwidthRound [0];
+    if (age > ENET_BBR_BANDWIDTH_ROUNDS)
+    {
+        bbr -> bandwidth [0] = bbr -> bandwidth [1];
+        bbr -> bandwidthRound [0] = bbr -> bandwidthRound [1];
+        bbr -> bandwidth [1] = bbr -> bandwidth [2];
+        bbr -> bandwidthRound [1] = bbr -> bandwidthRound [2];
+        bbr -> bandwidth [2] = bandwidth;
+        bbr -> bandwidthRound [2] = round;
+
+        if (round - bbr -> bandwidthRound [0] > ENET_BBR_BANDWIDTH_ROUNDS)
+        {
+            bbr -> bandwidth [0] = bbr -> bandwidth [1];
+            bbr -> bandwidthRound [0] = bbr -> bandwidthRound [1];
+            bbr -> bandwidth [1] = bbr -> bandwidth [2];
+            bbr -> bandwidthRound [1] = bbr -> bandwidthRound [2];
+        }
+    }
+    else
+    if (bbr -> bandwidthRound [1] == bbr -> bandwidthRound [0] && age > ENET_BBR_BANDWIDTH_ROUNDS / 4)
+    {
+        bbr -> bandwidth [1] = bbr -> bandwidth [2] = bandwidth;
+        bbr -> bandwidthRound [1] = bbr -> bandwidthRound [2] = round;
+    }
+    else
+    if (bbr -> bandwidthRound [2] == bbr -> bandwidthRound [1] && age > ENET_BBR_BANDWIDTH_ROUNDS / 2)
+    {
+        bbr -> bandwidth [2] = bandwidth;
+        bbr -> bandwidthRound [2] = round;
+    }
+}
+
+/* The bandwidth-delay product scaled by gain, or 0 until there is a bandwidth sample. */
+static enet_uint32
+enet_bbr_window (const ENetBBRState * bbr, enet_uint32 gain)
+{
+    unsigned long long window = (unsigned long long) bbr -> bandwidth [0] * bbr -> minimumRoundTripTime / 1000000;
+
+    window = window * gain / ENET_CONGESTION_GAIN_SCALE;
+
+    return window > 0xFFFFFFFF ? 0xFFFFFFFF : (enet_uint32) window;
+}
+
+static void
+enet_bbr_set_mode (ENetBBRState * bbr, ENetBBRMode mode, enet_uint32 serviceTime)
+{
+    bbr -> mode = mode;
+
+    switch (mode)
+    {
+    case ENET_BBR_MODE_STARTUP:
+       bbr -> pacingGain = ENET_BBR_STARTUP_GAIN;
+       bbr -> windowGain = ENET_BBR_STARTUP_GAIN;
+       break;
+
+    case ENET_BBR_MODE_DRAIN:
+       bbr -> pacingGain = ENET_BBR_DRAIN_GAIN;
+       bbr -> windowGain = ENET_BBR_STARTUP_GAIN;
+       break;
+
+    case ENET_BBR_MODE_PROBE_BANDWIDTH:
+       /* Start in one of the cruising phases, spread out so peers do not all probe at once. */
+       bbr -> cycleIndex = 2 + bbr -> roundCount % (ENET_BBR_GAIN_CYCLE_LENGTH - 2);
+       bbr -> cycleStart = serviceTime;
+       bbr -> pacingGain = bbrGainCycle [bbr -> cycleIndex];
+       bbr -> windowGain = ENET_BBR_WINDOW_GAIN;
+       break;
+
+    case ENET_BBR_MODE_PROBE_ROUND_TRIP_TIME:
+       bbr -> probeRoundTripTimeDone = 0;
+       bbr -> pacingGain = ENET_CONGESTION_GAIN_SCALE;
+       bbr -> windowGain = ENET_CONGESTION_GAIN_SCALE;
+       break;
+    }
+}
+
+/** Starts BBR in STARTUP with an initial window of ENET_CONGESTION_INITIAL_WINDOW datagrams. */
+void
+enet_bbr_reset (ENetPeer * peer)
+{
+    ENetBBRState * bbr = & peer -> congestion.state.bbr;
+
+    memset (bbr, 0, sizeof (* bbr));
+
+    bbr -> minimumRoundTripTimeStamp = peer -> host -> serviceTimeMicroseconds;
+
+    enet_bbr_set_mode (bbr, ENET_BBR_MODE_STARTUP, peer -> host -> serviceTimeMicroseconds);
+
+    peer -> congestion.window = ENET_CONGESTION_INITIAL_WINDOW * peer -> mtu;
+    peer -> congestion.pacingRate = enet_congestion_pacing_rate (peer, bbr -> pacingGain);
+}
+
+/** Models the path from the delivery rate and minimum round trip time it measures, and sets the
+    window to a multiple of their product and the pacing rate to a multiple of the delivery rate.
+    The multiples cycle to probe for more bandwidth and, every ENET_BBR_MINIMUM_ROUND_TRIP_TIME_EXPIRY,
+    the window drops to ENET_CONGESTION_MINIMUM_WINDOW datagrams so queues empty and the minimum
+    round trip time can be measured afresh.
+*/
+void
+enet_bbr_acknowledge (ENetPeer * peer, enet_uint32 acknowledgedBytes, enet_uint32 roundTripTime)
+{
+    ENetBBRState * bbr = & peer -> congestion.state.bbr;
+    enet_uint32 serviceTime = peer -> host -> serviceTimeMicroseconds,
+                inTransit = peer -> reliableDataInTransit,
+                minimumWindow = ENET_CONGESTION_MINIMUM_WINDOW * peer -> mtu,
+                window = peer -> congestion.window,
+                targetWindow, pacingRate;
+    int applicationLimited = enet_list_empty (& peer -> outgoingCommands),
+        minimumRoundTripTimeExpired = serviceTime - bbr -> minimumRoundTripTimeStamp > ENET_BBR_MINIMUM_ROUND_TRIP_TIME_EXPIRY;
+
+    bbr -> roundStart = 0;
+
+    if (acknowledgedBytes > 0)
+    {
+        bbr -> delivered += acknowledgedBytes;
+
+        if (bbr -> delivered - bbr -> nextRoundDelivered < 0x80000000)
+        {
+            bbr -> nextRoundDelivered = bbr -> delivered + inTransit;
+            ++ bbr -> roundCount;
+            bbr -> roundStart = 1;
+        }
+
+        /* Delivery rates are sampled over at least a round trip so bursty acknowledgements average out;
+           rates lower than the current estimate do not count while there was nothing more to send. */
+        if (bbr -> sampleStart == 0)
+        {
+            bbr -> sampleStart = ENET_MAX (serviceTime, 1);
+            bbr -> sampleDelivered = bbr -> delivered;
+        }
+        else
+        if (serviceTime - bbr -> sampleStart >= ENET_MAX (bbr -> minimumRoundTripTime, 1))
+        {
+            unsigned long long bandwidth = (unsigned long long) (bbr -> delivered - bbr -> sampleDelivered) * 1000000 / (serviceTime - bbr -> sampleStart);
+
+            if (bandwidth > 0xFFFFFFFF)
+              bandwidth = 0xFFFFFFFF;
+
+            if (! applicationLimited || bandwidth >= bbr -> bandwidth [0])
+              enet_bbr_update_bandwidth (bbr, (enet_uint32) bandwidth);
+
+            bbr -> sampleStart = ENET_MAX (serviceTime, 1);
+            bbr -> sampleDelivered = bbr -> delivered;
+        }
+    }
+
+    if (roundTripTime > 0 &&
+        (roundTripTime <= bbr -> minimumRoundTripTime || bbr -> minimumRoundTripTime == 0 || minimumRoundTripTimeExpired))
+    {
+        bbr -> minimumRoundTripTime = roundTripTime;
+        bbr -> minimumRoundTripTimeStamp = serviceTime;
+    }
+
+    if (! bbr -> filledPipe && bbr -> roundStart && ! applicationLimited)
+    {
+        if (bbr -> bandwidth [0] >= bbr -> fullBandwidth + bbr -> fullBandwidth / 4)
+        {
+            bbr -> fullBandwidth = bbr -> bandwidth [0];
+            bbr -> fullBandwidthCount = 0;
+        }
+        else
+        if (++ bbr -> fullBandwidthCount >= ENET_BBR_FULL_BANDWIDTH_ROUNDS)
+          bbr -> filledPipe = 1;
+    }
+
+    switch (bbr -> mode)
+    {
+    case ENET_BBR_MODE_STARTUP:
+       if (bbr -> filledPipe)
+         enet_bbr_set_mode (bbr, ENET_BBR_MODE_DRAIN, serviceTime);
+       break;
+
+    case ENET_BBR_MODE_DRAIN:
+       if (inTransit <= enet_bbr_window (bbr, ENET_CONGESTION_GAIN_SCALE))
+         enet_bbr_set_mode (bbr, ENET_BBR_MODE_PROBE_BANDWIDTH, serviceTime);
+       break;
+
+    case ENET_BBR_MODE_PROBE_BANDWIDTH:
+       if (serviceTime - bbr -> cycleStart > bbr -> minimumRoundTripTime ||
+           (bbr -> pacingGain < ENET_CONGESTION_GAIN_SCALE && inTransit <= enet_bbr_window (bbr, ENET_CONGESTION_GAIN_SCALE)))
+       {
+           bbr -> cycleIndex = (bbr -> cycleIndex + 1) % ENET_BBR_GAIN_CYCLE_LENGTH;
+           bbr -> cycleStart = serviceTime;
+           bbr -> pacingGain = bbrGainCycle [bbr -> cycleIndex];
+       }
+       break;
+
+    case ENET_BBR_MODE_PROBE_ROUND_TRIP_TIME:
+       if (bbr -> probeRoundTripTimeDone == 0)
+       {
+           if (inTransit <= minimumWindow)
+             bbr -> probeRoundTripTimeDone = ENET_MAX (serviceTime + ENET_BBR_PROBE_ROUND_TRIP_TIME_DURATION, 1);
+       }
+       else
+       if (serviceTime - bbr -> probeRoundTripTimeDone < 0x80000000)
+       {
+           bbr -> minimumRoundTripTimeStamp = serviceTime;
+
+           enet_bbr_set_mode (bbr, bbr -> filledPipe ? ENET_BBR_MODE_PROBE_BANDWIDTH : ENET_BBR_MODE_STARTUP, serviceTime);
+       }
+       break;
+    }
+
+    if (minimumRoundTripTimeExpired && bbr -> mode != ENET_BBR_MODE_PROBE_ROUND_TRIP_TIME)
+      enet_bbr_set_mode (bbr, ENET_BBR_MODE_PROBE_ROUND_TRIP_TIME, serviceTime);
+
+    /* A few datagrams on top of the bandwidth-delay product keep the pipe full across delayed acknowledgements. */
+    targetWindow = bbr -> bandwidth [0] > 0 ? enet_bbr_window (bbr, bbr -> windowGain) + 3 * peer -> mtu : ENET_CONGESTION_INITIAL_WINDOW * peer -> mtu;
+
+    if (bbr -> filledPipe)
+      window = ENET_MIN (window + acknowledgedBytes, targetWindow);
+    else
+    if (window < targetWindow || bbr -> delivered < ENET_CONGESTION_INITIAL_WINDOW * peer -> mtu)
+      window += acknowledgedBytes;
+
+    window = ENET_MAX (window, minimumWindow);
+
+    if (bbr -> mode == ENET_BBR_MODE_PROBE_ROUND_TRIP_TIME)
+      window = ENET_MIN (window, minimumWindow);
+
+    peer -> congestion.window = window;
+
+    if (bbr -> bandwidth [0] > 0)
+    {
+        unsigned long long rate = (unsigned long long) bbr -> bandwidth [0] * bbr -> pacingGain / ENET_CONGESTION_GAIN_SCALE;
+
+        pacingRate = rate > 0xFFFFFFFF ? 0xFFFFFFFF : (enet_uint32) rate;
+    }
+    else
+      pacingRate = enet_congestion_pacing_rate (peer, bbr -> pacingGain);
+
+    /* Until startup is over the pacing rate only grows, so a slow round cannot stall it. */
+    if (bbr -> filledPipe || pacingRate > peer -> congestion.pacingRate)
+      peer -> congestion.pacingRate = pacingRate;
+}
+
+/** BBR does not read loss as congestion, but holds the window to what is still in transit so
+    retransmissions go out only as fast as acknowledgements come back.
+*/
+void
+enet_bbr_lose (ENetPeer * peer, enet_uint32 lostBytes)
+{
+    (void) lostBytes;
+
+    peer -> congestion.window = ENET_MIN (peer -> congestion.window,
+                                          ENET_MAX (peer -> reliableDataInTransit + peer -> mtu, ENET_CONGESTION_MINIMUM_WINDOW * peer -> mtu));
+}
+
+/** Sets BBR as the host's congestion controller.
+    @param host host to set BBR for
+*/
+void
+enet_host_congestion_control_with_bbr (ENetHost * host)
+{
+    ENetCongestionControl congestionControl;
+    congestionControl.reset = enet_bbr_reset;
+    congestionControl.acknowledge = enet_bbr_acknowledge;
+    congestionControl.lose = enet_bbr_lose;
+    enet_host_congestion_control (host, & congestionControl);
+}
+
+/** @} */
@@ -21,6 +21,8 @@ extern "C"
 #include "enet/types.h"
 #include "enet/protocol.h"
 #include "enet/list.h"
+#include "enet/timer.h"
+#include "enet/pool.h"
 #include "enet/callbacks.h"
 
 #define ENET_VERSION_MAJOR 1
@@ -62,7 +64,11 @@ typedef enum _ENetSocketOption
    ENET_SOCKOPT_RCVTIMEO  = 6,
    ENET_SOCKOPT_SNDTIMEO  = 7,
    ENET_SOCKOPT_ERROR     = 8,
-   ENET_SOCKOPT_NODELAY   = 9
+   ENET_SOCKOPT_NODELAY   = 9,
+   ENET_SOCKOPT_GSO       = 10,
+   ENET_SOCKOPT_GRO       = 11,
+   ENET_SOCKOPT_REUSEPORT = 12,
+   ENET_SOCKOPT_DONTFRAGMENT = 13
 } ENetSocketOption;
 
 typedef enum _ENetSocketShutdown
@@ -92,6 +98,35 @@ typedef struct _ENetAddress
    enet_uint16 port;
 } ENetAddress;
 
+/**
+ * A single datagram for the batched socket functions.
+ *
+ * The datagram is held in buffers[0:bufferCount-1]. After enet_socket_receive_multiple()
+ * or enet_socket_send_multiple() return, dataLength holds the number of bytes received
+ * or sent, and for receives address holds the address of the sender.
+ *
+ * If segmentSize is non-zero, the datagram is a train of segmentSize byte datagrams,
+ * of which only the last may be shorter, that is sent or was received with UDP
+ * segmentation offload.
+
+   @sa enet_socket_receive_multiple()
+   @sa enet_socket_send_multiple()
+ */
+typedef struct _ENetDatagram
+{
+   ENetAddress  address;
+   ENetBuffer * buffers;
+   size_t       bufferCount;
+   size_t       dataLength;
+   size_t       segmentSize;
+} ENetDatagram;
+
+typedef enum _ENetSegmentationOffload
+{
+   ENET_SEGMENTATION_OFFLOAD_SEND    = (1 << 0),
+   ENET_SEGMENTATION_OFFLOAD_RECEIVE = (1 << 1)
+} ENetSegmentationOffload;
+
 /**
  * Packet flag bit constants.
  *
@@ -153,6 +188,7 @@ typedef struct _ENetPacket
    size_t                   dataLength;      /**< length of data */
    ENetPacketFreeCallback   freeCallback;    /**< function to be called when the packet is no longer in use */
    void *                   userData;        /**< application private data, may be freely modified */
+   size_t                   dataCapacity;    /**< internal use only */
 } ENetPacket;
 
 typedef struct _ENetAcknowledgement
@@ -168,8 +204,9 @@ typedef struct _ENetOutgoingCommand
    enet_uint16  reliableSequenceNumber;
    enet_uint16  unreliableSequenceNumber;
    enet_uint32  sentTime;
-   enet_uint32  roundTripTimeout;
-   enet_uint32  roundTripTimeoutLimit;
+   enet_uint32  sentTimeMicroseconds;
+   enet_uint32  roundTripTimeout;      /**< retransmit timeout in microseconds */
+   enet_uint32  roundTripTimeoutLimit; /**< in microseconds, the peer times out once roundTripTimeout backs off this far */
    enet_uint32  fragmentOffset;
    enet_uint16  fragmentLength;
    enet_uint16  sendAttempts;
@@ -212,9 +249,18 @@ enum
    ENET_HOST_RECEIVE_BUFFER_SIZE          = 256 * 1024,
    ENET_HOST_SEND_BUFFER_SIZE             = 256 * 1024,
    ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL  = 1000,
+   ENET_HOST_CONNECT_COOKIE_INTERVAL      = 5000,
    ENET_HOST_DEFAULT_MTU                  = 1400,
    ENET_HOST_DEFAULT_MAXIMUM_PACKET_SIZE  = 32 * 1024 * 1024,
    ENET_HOST_DEFAULT_MAXIMUM_WAITING_DATA = 32 * 1024 * 1024,
+   ENET_HOST_RECEIVE_BATCH_SIZE           = 32,
+   ENET_HOST_DEFAULT_SEND_BATCH_LIMIT     = 64,
+   ENET_HOST_SEGMENT_COUNT_MAXIMUM        = 64,
+   ENET_HOST_SEGMENT_DATA_MAXIMUM         = 65000,
+   ENET_HOST_SEGMENT_BUFFER_MAXIMUM       = 1024,
+   ENET_HOST_SEGMENT_RECEIVE_BUFFER_SIZE  = 65536,
+   ENET_HOST_COMPRESSION_DICTIONARY_MAXIMUM = 32 * 1024,
+   ENET_HOST_DEFAULT_COMPRESSION_THRESHOLD = 32,
 
    ENET_PEER_DEFAULT_ROUND_TRIP_TIME      = 500,
    ENET_PEER_DEFAULT_PACKET_THROTTLE      = 32,
@@ -229,13 +275,34 @@ enum
    ENET_PEER_TIMEOUT_LIMIT                = 32,
    ENET_PEER_TIMEOUT_MINIMUM              = 5000,
    ENET_PEER_TIMEOUT_MAXIMUM              = 30000,
+   ENET_PEER_RETRANSMIT_MARGIN_MINIMUM    = 5000,     /* microseconds */
+   ENET_PEER_PACING_QUANTUM               = 1000,     /* microseconds of credit a paced peer may bank, one service wait */
    ENET_PEER_PING_INTERVAL                = 500,
+   ENET_PEER_MTU_PROBE_ATTEMPTS           = 3,        /* lost probes of one size before the path is taken not to carry it */
+   ENET_PEER_MTU_PROBE_GRANULARITY        = 32,
+   ENET_PEER_MTU_RAISE_INTERVAL           = 600000,   /* after a finished search, until a larger MTU is looked for again */
+   ENET_PEER_MTU_BLACK_HOLE_ATTEMPTS      = 3,        /* transmissions of a datagram lost in a row before the MTU falls back */
    ENET_PEER_UNSEQUENCED_WINDOWS          = 64,
    ENET_PEER_UNSEQUENCED_WINDOW_SIZE      = 1024,
    ENET_PEER_FREE_UNSEQUENCED_WINDOWS     = 32,
    ENET_PEER_RELIABLE_WINDOWS             = 16,
    ENET_PEER_RELIABLE_WINDOW_SIZE         = 0x1000,
-   ENET_PEER_FREE_RELIABLE_WINDOWS        = 8
+   ENET_PEER_FREE_RELIABLE_WINDOWS        = 8,
+   ENET_PEER_RELIABLE_RING_MINIMUM        = 32,
+   ENET_PEER_COMPRESSION_RATIO_SCALE      = 256,
+   ENET_PEER_COMPRESSION_RATIO_BYPASS     = 240,
+   ENET_PEER_COMPRESSION_FAILURE_LIMIT    = 4,
+   ENET_PEER_COMPRESSION_BACKOFF_MINIMUM  = 8,
+   ENET_PEER_COMPRESSION_BACKOFF_MAXIMUM  = 512,
+   ENET_CONGESTION_GAIN_SCALE             = 256,
+   ENET_CONGESTION_INITIAL_WINDOW         = 10,       /* in datagrams of the peer's MTU */
+   ENET_CONGESTION_MINIMUM_WINDOW         = 4,
+   ENET_CUBIC_BETA                        = 179,      /* 0.7 out of ENET_CONGESTION_GAIN_SCALE */
+   ENET_BBR_BANDWIDTH_ROUNDS              = 10,
+   ENET_BBR_MINIMUM_ROUND_TRIP_TIME_EXPIRY = 10000000, /* microseconds */
+   ENET_BBR_PROBE_ROUND_TRIP_TIME_DURATION = 200000,
+   ENET_BBR_FULL_BANDWIDTH_ROUNDS         = 3,
+   ENET_BBR_GAIN_CYCLE_LENGTH             = 8
 };
 
 typedef struct _ENetChannel
@@ -246,15 +313,92 @@ typedef struct _ENetChannel
    enet_uint16  reliableWindows [ENET_PEER_RELIABLE_WINDOWS];
    enet_uint16  incomingReliableSequenceNumber;
    enet_uint16  incomingUnreliableSequenceNumber;
-   ENetList     incomingReliableCommands;
+   enet_uint16  incomingReliableCapacity;
+   enet_uint16  incomingReliableCount;
+   ENetIncomingCommand ** incomingReliableCommands;   /**< ring of incomingReliableCapacity slots indexed by reliable sequence number, grown on demand up to ENET_PEER_RELIABLE_WINDOW_SIZE slots */
    ENetList     incomingUnreliableCommands;
+   ENetIncomingCommand * incomingUnreliableFragment;   /**< the unreliable fragmented packet last added to, while it is still being reassembled */
 } ENetChannel;
 
+typedef enum _ENetBBRMode
+{
+   ENET_BBR_MODE_STARTUP         = 0,
+   ENET_BBR_MODE_DRAIN           = 1,
+   ENET_BBR_MODE_PROBE_BANDWIDTH = 2,
+   ENET_BBR_MODE_PROBE_ROUND_TRIP_TIME = 3
+} ENetBBRMode;
+
+/** CUBIC state of a peer; times are in microseconds on the host's service clock. */
+typedef struct _ENetCubicState
+{
+   enet_uint32 slowStartThreshold;
+   enet_uint32 windowMaximum;          /**< window just before the last reduction */
+   enet_uint32 windowOrigin;           /**< window the current growth curve levels off at */
+   enet_uint32 windowEstimate;         /**< window a Reno flow would have reached, the curve never grows slower */
+   enet_uint32 epochStart;             /**< when the current growth curve started, 0 if it has not yet */
+   enet_uint32 epochOffset;            /**< time from epochStart until the curve reaches windowOrigin */
+   enet_uint32 recoveryStart;          /**< when the window was last reduced; losses within a round trip of it are not counted again */
+} ENetCubicState;
+
+/** BBR state of a peer; times are in microseconds on the host's service clock. */
+typedef struct _ENetBBRState
+{
+   enet_uint32 bandwidth [3];          /**< windowed maximum of the delivery rate in bytes per second, best first */
+   enet_uint32 bandwidthRound [3];     /**< round each bandwidth sample was taken in */
+   enet_uint32 minimumRoundTripTime;
+   enet_uint32 minimumRoundTripTimeStamp;
+   enet_uint32 delivered;              /**< bytes acknowledged so far */
+   enet_uint32 roundCount;
+   enet_uint32 nextRoundDelivered;     /**< a round ends once delivered gets here, i.e. when what was in transit at its start is acknowledged */
+   enet_uint32 sampleStart;            /**< start of the current delivery rate sample, 0 if none */
+   enet_uint32 sampleDelivered;
+   enet_uint32 fullBandwidth;
+   enet_uint32 fullBandwidthCount;     /**< rounds in a row the bandwidth failed to grow by a quarter */
+   enet_uint32 cycleStart;
+   enet_uint32 probeRoundTripTimeDone; /**< when PROBE_RTT may end, 0 until the window has drained */
+   enet_uint16 pacingGain;             /**< out of ENET_CONGESTION_GAIN_SCALE */
+   enet_uint16 windowGain;
+   enet_uint8  mode;                   /**< an ENetBBRMode */
+   enet_uint8  cycleIndex;
+   enet_uint8  filledPipe;             /**< whether STARTUP has found the bottleneck bandwidth */
+   enet_uint8  roundStart;
+} ENetBBRState;
+
+/** Congestion state of a peer, kept up to date by the host's ENetCongestionControl. */
+typedef struct _ENetCongestion
+{
+   enet_uint32 window;                 /**< bytes of reliable data allowed in transit */
+   enet_uint32 pacingRate;             /**< bytes per second to spread datagrams at, 0 for no pacing */
+   int         pacingCredit;           /**< bytes the pacer lets out before holding datagrams back, negative once overdrawn */
+   enet_uint32 pacingTime;             /**< microsecond clock pacingCredit was last topped up at */
+   enet_uint32 pacingDeadline;         /**< service time the pacer releases the peer at while ENET_PEER_FLAG_PACED is set */
+   union
+   {
+      ENetCubicState cubic;
+      ENetBBRState   bbr;
+      void *         data;             /**< for other controllers */
+   } state;
+} ENetCongestion;
+
 typedef enum _ENetPeerFlag
 {
-   ENET_PEER_FLAG_NEEDS_DISPATCH = (1 << 0)
+   ENET_PEER_FLAG_NEEDS_DISPATCH = (1 << 0),
+   ENET_PEER_FLAG_SEND_STAGED    = (1 << 1),
+   ENET_PEER_FLAG_NEEDS_SEND     = (1 << 2),
+   ENET_PEER_FLAG_INDEXED        = (1 << 3),
+   ENET_PEER_FLAG_CONNECT_COOKIE = (1 << 4),
+   ENET_PEER_FLAG_CAPABILITIES   = (1 << 5),
+   ENET_PEER_FLAG_PACED          = (1 << 6),
+   ENET_PEER_FLAG_MTU_PROBE      = (1 << 7)
 } ENetPeerFlag;
 
+/** How many indexed peers share one IP address, an entry of ENetHost::addressCounts. */
+typedef struct _ENetAddressCount
+{
+   enet_uint32 host;
+   enet_uint32 count;                                /**< 0 if the entry is empty */
+} ENetAddressCount;
+
 /**
  * An ENet peer which data packets may be sent or received from. 
  *
@@ -263,6 +407,8 @@ typedef enum _ENetPeerFlag
 typedef struct _ENetPeer
 { 
    ENetListNode  dispatchList;
+   ENetListNode  sendList;
+   ENetTimer     timer;
    struct _ENetHost * host;
    enet_uint16   outgoingPeerID;
    enet_uint16   incomingPeerID;
@@ -304,8 +450,10 @@ typedef struct _ENetPeer
    enet_uint32   lowestRoundTripTime;
    enet_uint32   lastRoundTripTimeVariance;
    enet_uint32   highestRoundTripTimeVariance;
-   enet_uint32   roundTripTime;            /**< mean round trip time (RTT), in milliseconds, between sending a reliable packet and receiving its acknowledgement */
+   enet_uint32   roundTripTime;            /**< mean round trip time (RTT), in milliseconds, between sending a reliable packet and receiving its acknowledgement; roundTripTimeMicroseconds rounded up */
    enet_uint32   roundTripTimeVariance;
+   enet_uint32   roundTripTimeMicroseconds;          /**< mean round trip time in microseconds, which retransmit timeouts are computed from */
+   enet_uint32   roundTripTimeVarianceMicroseconds;
    enet_uint32   mtu;
    enet_uint32   windowSize;
    enet_uint32   reliableDataInTransit;
@@ -322,8 +470,31 @@ typedef struct _ENetPeer
    enet_uint32   unsequencedWindow [ENET_PEER_UNSEQUENCED_WINDOW_SIZE / 32]; 
    enet_uint32   eventData;
    size_t        totalWaitingData;
+   enet_uint32   connectCookie [2];                  /**< cookie the foreign host handed out, echoed with the connect while ENET_PEER_FLAG_CONNECT_COOKIE is set */
+   enet_uint16   compressionRatio;                   /**< moving average of compressed / original datagram size, out of ENET_PEER_COMPRESSION_RATIO_SCALE */
+   enet_uint16   compressionFailures;                /**< datagrams in a row the compressor could not shrink */
+   enet_uint16   compressionBackoff;                 /**< datagrams to send uncompressed the next time compression is given up on */
+   enet_uint16   compressionBypass;                  /**< datagrams left to send uncompressed before compression is tried again */
+   enet_uint32   capabilities;                       /**< ENetProtocolCapability extensions offered by both hosts; ENET_PEER_FLAG_CAPABILITIES is set once the foreign host has sent its offer */
+   enet_uint32   maximumWindowSize;                  /**< largest windowSize both hosts agreed to when connecting, ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE unless both scale their windows */
+   ENetCongestion congestion;                        /**< only kept while the host has an ENetCongestionControl */
+   enet_uint32   mtuProbeSize;                       /**< size of the path MTU probe in flight, 0 if none */
+   enet_uint32   mtuProbeLimit;                      /**< smallest size the path is known not to carry, past the largest size probed for; 0 until a search starts */
+   enet_uint32   mtuProbeTime;                       /**< service time the next path MTU probe is due */
+   enet_uint16   mtuProbeSequenceNumber;             /**< reliable sequence number of the ping carrying the probe */
+   enet_uint16   mtuProbeAttempts;                   /**< probes of mtuProbeSize lost so far */
 } ENetPeer;
 
+/** A datagram built by enet_host_service() and held until the next batched socket send.
+ */
+typedef struct _ENetStagedDatagram
+{
+   ENetPeer *   peer;
+   ENetProtocol commands [ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS];
+   enet_uint8   headerData [sizeof (ENetProtocolHeader) + sizeof (enet_uint32)];
+   enet_uint8   compressedData [ENET_PROTOCOL_MAXIMUM_MTU];
+} ENetStagedDatagram;
+
 /** An ENet packet compressor for compressing UDP packets before socket sends or receives.
  */
 typedef struct _ENetCompressor
@@ -338,6 +509,20 @@ typedef struct _ENetCompressor
    void (ENET_CALLBACK * destroy) (void * context);
 } ENetCompressor;
 
+/** A congestion controller for the reliable data sent to each peer. While a host has one, the
+    window it keeps in ENetPeer::congestion replaces the packetThrottle scaled window for reliable
+    data; packetThrottle is still kept and still drops unreliable packets.
+ */
+typedef struct _ENetCongestionControl
+{
+   /** Sets up peer -> congestion when the peer finishes connecting. */
+   void (ENET_CALLBACK * reset) (struct _ENetPeer * peer);
+   /** Called after an acknowledgement retired acknowledgedBytes of reliable data in transit, which may be 0; roundTripTime is the round trip it measured, in microseconds. */
+   void (ENET_CALLBACK * acknowledge) (struct _ENetPeer * peer, enet_uint32 acknowledgedBytes, enet_uint32 roundTripTime);
+   /** Called when a reliable command carrying lostBytes of data went unacknowledged for its retransmit timeout. */
+   void (ENET_CALLBACK * lose) (struct _ENetPeer * peer, enet_uint32 lostBytes);
+} ENetCongestionControl;
+
 /** Callback that computes the checksum of the data held in buffers[0:bufferCount-1] */
 typedef enet_uint32 (ENET_CALLBACK * ENetChecksumCallback) (const ENetBuffer * buffers, size_t bufferCount);
 
@@ -356,13 +541,24 @@ typedef int (ENET_CALLBACK * ENetInterceptCallback) (struct _ENetHost * host, st
     @sa enet_host_broadcast()
     @sa enet_host_compress()
     @sa enet_host_compress_with_range_coder()
+    @sa enet_host_compress_with_fast_lz()
+    @sa enet_host_compress_with_dictionary()
+    @sa enet_host_congestion_control()
+    @sa enet_host_congestion_control_with_cubic()
+    @sa enet_host_congestion_control_with_bbr()
     @sa enet_host_channel_limit()
     @sa enet_host_bandwidth_limit()
     @sa enet_host_bandwidth_throttle()
+    @sa enet_host_send_batch_limit()
+    @sa enet_host_segmentation_offload()
+    @sa enet_host_enable_wakeup()
+    @sa enet_host_wakeup()
   */
 typedef struct _ENetHost
 {
    ENetSocket           socket;
+   ENetSocket           wakeupSocket;                /**< readable while a wakeup is pending, ENET_SOCKET_NULL unless enet_host_enable_wakeup() was called */
+   ENetSocket           wakeupSignal;                /**< written by enet_host_wakeup(), may be the same descriptor as wakeupSocket */
    ENetAddress          address;                     /**< Internet address of the host */
    enet_uint32          incomingBandwidth;           /**< downstream bandwidth of the host */
    enet_uint32          outgoingBandwidth;           /**< upstream bandwidth of the host */
@@ -374,7 +570,20 @@ typedef struct _ENetHost
    size_t               peerCount;                   /**< number of peers allocated for this host */
    size_t               channelLimit;                /**< maximum number of channels allowed for connected peers */
    enet_uint32          serviceTime;
+   enet_uint32          serviceTimeMicroseconds;     /**< microsecond clock read together with serviceTime, only differences are meaningful */
    ENetList             dispatchQueue;
+   ENetList             sendQueue;                   /**< peers with acknowledgements or outgoing commands, or whose timer expired; the only peers a send pass visits */
+   ENetList             sendVisited;                 /**< peers already visited by the current send pass */
+   ENetTimerWheel       timers;                      /**< each live peer's next retransmit timeout or ping */
+   ENetPool             outgoingCommandPool;         /**< ENetOutgoingCommand objects for all peers, see enet_host_pool_limit() */
+   ENetPool             incomingCommandPool;         /**< ENetIncomingCommand objects for all peers */
+   ENetPool             acknowledgementPool;         /**< ENetAcknowledgement objects for all peers */
+   ENetPeer **          peerIndex;                   /**< open addressing table of peers that are neither disconnected nor connecting, by address and connectID */
+   ENetAddressCount *   addressCounts;               /**< open addressing table of how many indexed peers each IP address has */
+   size_t               indexMask;                   /**< peerIndex and addressCounts both have indexMask + 1 entries */
+   enet_uint32          indexSeed;
+   ENetPeer **          freePeers;                   /**< stack of disconnected peers */
+   size_t               freePeerCount;
    int                  continueSending;
    size_t               packetSize;
    enet_uint16          headerFlags;
@@ -384,20 +593,46 @@ typedef struct _ENetHost
    size_t               bufferCount;
    ENetChecksumCallback checksum;                    /**< callback the user can set to enable packet checksums for this host */
    ENetCompressor       compressor;
+   ENetCongestionControl congestionControl;          /**< all NULL while reliable data is only limited by the packet throttle */
    enet_uint8           packetData [2][ENET_PROTOCOL_MAXIMUM_MTU];
    ENetAddress          receivedAddress;
    enet_uint8 *         receivedData;
    size_t               receivedDataLength;
+   ENetDatagram         receivedDatagrams [ENET_HOST_RECEIVE_BATCH_SIZE];
+   ENetBuffer           receivedBuffers [ENET_HOST_RECEIVE_BATCH_SIZE];
+   enet_uint8 *         receivedDatagramData;
+   size_t               receivedDatagramIndex;
+   size_t               receivedDatagramCount;
+   size_t               receivedDatagramOffset;
+   ENetDatagram *       sendDatagrams;
+   ENetStagedDatagram * stagedDatagrams;
+   size_t               stagedDatagramCount;
+   ENetBuffer *         stagedBuffers;
+   size_t               stagedBufferCount;
+   size_t               sendBatchLimit;              /**< maximum number of datagrams staged per socket send, or 0 if sends are not batched */
+   enet_uint32          segmentationOffload;         /**< bitwise-or of the ENetSegmentationOffload directions currently in use */
    enet_uint32          totalSentData;               /**< total data sent, user should reset to 0 as needed to prevent overflow */
    enet_uint32          totalSentPackets;            /**< total UDP packets sent, user should reset to 0 as needed to prevent overflow */
+   enet_uint32          totalSendCalls;              /**< total socket send calls made, user should reset to 0 as needed to prevent overflow */
    enet_uint32          totalReceivedData;           /**< total data received, user should reset to 0 as needed to prevent overflow */
    enet_uint32          totalReceivedPackets;        /**< total UDP packets received, user should reset to 0 as needed to prevent overflow */
+   enet_uint32          totalReceiveCalls;           /**< total socket receive calls made, totalReceivedPackets / totalReceiveCalls gives the datagrams read per call, user should reset to 0 as needed to prevent overflow */
+   size_t               compressionThreshold;        /**< datagrams with fewer bytes than this after the header are never compressed, defaults to ENET_HOST_DEFAULT_COMPRESSION_THRESHOLD */
+   enet_uint32          totalCompressedDatagrams;    /**< total datagrams run through the compressor, user should reset to 0 as needed to prevent overflow */
+   enet_uint32          totalCompressionBypasses;    /**< total datagrams sent without trying the compressor, user should reset to 0 as needed to prevent overflow */
+   enet_uint32          totalCompressionSavedData;   /**< total bytes compression took off sent datagrams, user should reset to 0 as needed to prevent overflow */
+   enet_uint32          totalCompressionTime;        /**< total microseconds spent in the compressor, user should reset to 0 as needed to prevent overflow */
    ENetInterceptCallback intercept;                  /**< callback the user can set to intercept received raw UDP packets */
    size_t               connectedPeers;
    size_t               bandwidthLimitedPeers;
    size_t               duplicatePeers;              /**< optional number of allowed peers from duplicate IPs, defaults to ENET_PROTOCOL_MAXIMUM_PEER_ID */
    size_t               maximumPacketSize;           /**< the maximum allowable packet size that may be sent or received on a peer */
    size_t               maximumWaitingData;          /**< the maximum aggregate amount of buffer space a peer may use waiting for packets to be delivered */
+   int                  connectCookies;              /**< whether connects must echo a cookie before a peer is set up for them, see enet_host_connect_cookies() */
+   enet_uint32          connectCookieKey [2];
+   enet_uint32          capabilities;                /**< ENetProtocolCapability extensions offered to peers when connecting, may be narrowed before connecting; defaults to ENET_PROTOCOL_CAPABILITY_ALL */
+   enet_uint32          maximumWindowSize;           /**< largest reliable window offered to peers when connecting, see enet_host_window_limit() */
+   enet_uint32          probeMtu;                    /**< largest MTU probed for on the path to each peer, 0 to keep the MTU agreed on when connecting; see enet_host_probe_mtu() */
 } ENetHost;
 
 /**
@@ -502,7 +737,13 @@ ENET_API ENetSocket enet_socket_accept (ENetSocket, ENetAddress *);
 ENET_API int        enet_socket_connect (ENetSocket, const ENetAddress *);
 ENET_API int        enet_socket_send (ENetSocket, const ENetAddress *, const ENetBuffer *, size_t);
 ENET_API int        enet_socket_receive (ENetSocket, ENetAddress *, ENetBuffer *, size_t);
+ENET_API int        enet_socket_receive_multiple (ENetSocket, ENetDatagram *, size_t);
+ENET_API int        enet_socket_send_multiple (ENetSocket, ENetDatagram *, size_t);
 ENET_API int        enet_socket_wait (ENetSocket, enet_uint32 *, enet_uint32);
+ENET_API int        enet_socket_wait_interruptible (ENetSocket, ENetSocket, enet_uint32 *, enet_uint32);
+ENET_API int        enet_socket_create_wakeup (ENetSocket *, ENetSocket *);
+ENET_API int        enet_socket_signal_wakeup (ENetSocket);
+ENET_API void       enet_socket_drain_wakeup (ENetSocket);
 ENET_API int        enet_socket_set_option (ENetSocket, ENetSocketOption, int);
 ENET_API int        enet_socket_get_option (ENetSocket, ENetSocketOption, int *);
 ENET_API int        enet_socket_shutdown (ENetSocket, ENetSocketShutdown);
@@ -561,6 +802,7 @@ ENET_API ENetPacket * enet_packet_create (const void *, size_t, enet_uint32);
 ENET_API void         enet_packet_destroy (ENetPacket *);
 ENET_API int          enet_packet_resize  (ENetPacket *, size_t);
 ENET_API enet_uint32  enet_crc32 (const ENetBuffer *, size_t);
+ENET_API enet_uint32  enet_crc32c (const ENetBuffer *, size_t);
                 
 ENET_API ENetHost * enet_host_create (const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32);
 ENET_API void       enet_host_destroy (ENetHost *);
@@ -571,11 +813,33 @@ ENET_API void       enet_host_flush (ENetHost *);
 ENET_API void       enet_host_broadcast (ENetHost *, enet_uint8, ENetPacket *);
 ENET_API void       enet_host_compress (ENetHost *, const ENetCompressor *);
 ENET_API int        enet_host_compress_with_range_coder (ENetHost * host);
+ENET_API int        enet_host_compress_with_fast_lz (ENetHost * host);
+ENET_API int        enet_host_compress_with_dictionary (ENetHost * host, const void * dictionary, size_t dictionaryLength);
+ENET_API void       enet_host_congestion_control (ENetHost *, const ENetCongestionControl *);
+ENET_API void       enet_host_congestion_control_with_cubic (ENetHost * host);
+ENET_API void       enet_host_congestion_control_with_bbr (ENetHost * host);
 ENET_API void       enet_host_channel_limit (ENetHost *, size_t);
+ENET_API void       enet_host_window_limit (ENetHost *, enet_uint32);
+ENET_API int        enet_host_probe_mtu (ENetHost *, enet_uint32);
 ENET_API void       enet_host_bandwidth_limit (ENetHost *, enet_uint32, enet_uint32);
+ENET_API int        enet_host_send_batch_limit (ENetHost *, size_t);
+ENET_API enet_uint32 enet_host_segmentation_offload (ENetHost *, enet_uint32);
+ENET_API void       enet_host_connect_cookies (ENetHost *, int);
+ENET_API void       enet_host_pool_limit (ENetHost *, size_t, size_t, size_t);
+ENET_API int        enet_host_enable_wakeup (ENetHost *);
+ENET_API int        enet_host_wakeup (ENetHost *);
+extern   void       enet_checksum_initialize (void);
 extern   void       enet_host_bandwidth_throttle (ENetHost *);
 extern  enet_uint32 enet_host_random_seed (void);
+extern  enet_uint32 enet_time_get_microseconds (void);
+extern  enet_uint32 enet_time_get_precise (enet_uint32 *);
 extern  enet_uint32 enet_host_random (ENetHost *);
+extern   ENetPeer * enet_host_find_peer (ENetHost *, const ENetAddress *, enet_uint32);
+extern   size_t     enet_host_address_peer_count (ENetHost *, enet_uint32);
+extern   void       enet_host_index_peer (ENetHost *, ENetPeer *);
+extern   void       enet_host_unindex_peer (ENetHost *, ENetPeer *);
+extern   ENetPeer * enet_host_pop_free_peer (ENetHost *);
+extern   void       enet_host_push_free_peer (ENetHost *, ENetPeer *);
 
 ENET_API int                 enet_peer_send (ENetPeer *, enet_uint8, ENetPacket *);
 ENET_API ENetPacket *        enet_peer_receive (ENetPeer *, enet_uint8 * channelID);
@@ -590,18 +854,41 @@ ENET_API void                enet_peer_throttle_configure (ENetPeer *, enet_uint
 extern int                   enet_peer_throttle (ENetPeer *, enet_uint32);
 extern void                  enet_peer_reset_queues (ENetPeer *);
 extern void                  enet_peer_setup_outgoing_command (ENetPeer *, ENetOutgoingCommand *);
+extern size_t                enet_peer_fragment_length (const ENetPeer *);
+extern void                  enet_peer_setup_fragment (ENetOutgoingCommand *, ENetPacket *, enet_uint8, size_t, enet_uint32, enet_uint32);
+extern int                   enet_peer_send_fragments (ENetPeer *, enet_uint8, ENetPacket *, size_t, enet_uint32, const ENetOutgoingCommand *);
+extern void                  enet_peer_schedule_send (ENetPeer *);
+extern void                  enet_peer_schedule_timer (ENetPeer *);
 extern ENetOutgoingCommand * enet_peer_queue_outgoing_command (ENetPeer *, const ENetProtocol *, ENetPacket *, enet_uint32, enet_uint16);
 extern ENetIncomingCommand * enet_peer_queue_incoming_command (ENetPeer *, const ENetProtocol *, const void *, size_t, enet_uint32, enet_uint32);
 extern ENetAcknowledgement * enet_peer_queue_acknowledgement (ENetPeer *, const ENetProtocol *, enet_uint16);
 extern void                  enet_peer_dispatch_incoming_unreliable_commands (ENetPeer *, ENetChannel *, ENetIncomingCommand *);
 extern void                  enet_peer_dispatch_incoming_reliable_commands (ENetPeer *, ENetChannel *, ENetIncomingCommand *);
+extern ENetIncomingCommand * enet_peer_find_incoming_reliable_command (ENetChannel *, enet_uint16);
+extern int                   enet_peer_beyond_incoming_reliable_commands (const ENetChannel *, enet_uint16);
 extern void                  enet_peer_on_connect (ENetPeer *);
 extern void                  enet_peer_on_disconnect (ENetPeer *);
+extern void                  enet_peer_reset_congestion (ENetPeer *);
 
 ENET_API void * enet_range_coder_create (void);
 ENET_API void   enet_range_coder_destroy (void *);
 ENET_API size_t enet_range_coder_compress (void *, const ENetBuffer *, size_t, size_t, enet_uint8 *, size_t);
 ENET_API size_t enet_range_coder_decompress (void *, const enet_uint8 *, size_t, enet_uint8 *, size_t);
+
+ENET_API void * enet_lz_create (void);
+ENET_API void * enet_lz_create_with_dictionary (const void *, size_t);
+ENET_API size_t enet_lz_train_dictionary (const ENetBuffer *, size_t, enet_uint8 *, size_t);
+ENET_API void   enet_lz_destroy (void *);
+ENET_API size_t enet_lz_compress (void *, const ENetBuffer *, size_t, size_t, enet_uint8 *, size_t);
+ENET_API size_t enet_lz_decompress (void *, const enet_uint8 *, size_t, enet_uint8 *, size_t);
+
+ENET_API void   enet_cubic_reset (ENetPeer *);
+ENET_API void   enet_cubic_acknowledge (ENetPeer *, enet_uint32, enet_uint32);
+ENET_API void   enet_cubic_lose (ENetPeer *, enet_uint32);
+
+ENET_API void   enet_bbr_reset (ENetPeer *);
+ENET_API void   enet_bbr_acknowledge (ENetPeer *, enet_uint32, enet_uint32);
+ENET_API void   enet_bbr_lose (ENetPeer *, enet_uint32);
    
 extern size_t enet_protocol_command_size (enet_uint8);
 
@@ -10,6 +10,58 @@
     @{
 */
 
+static int
+enet_host_allocate_receive_buffers (ENetHost * host, size_t bufferSize)
+{
+    enet_uint8 * data = (enet_uint8 *) enet_malloc (ENET_HOST_RECEIVE_BATCH_SIZE * bufferSize);
+    size_t i;
+
+    if (data == NULL)
+      return -1;
+
+    if (host -> receivedDatagramData != NULL)
+      enet_free (host -> receivedDatagramData);
+
+    host -> receivedDatagramData = data;
+    host -> receivedDatagramIndex = 0;
+    host -> receivedDatagramCount = 0;
+    host -> receivedDatagramOffset = 0;
+
+    for (i = 0; i < ENET_HOST_RECEIVE_BATCH_SIZE; ++ i)
+    {
+       host -> receivedBuffers [i].data = & data [i * bufferSize];
+       host -> receivedBuffers [i].dataLength = bufferSize;
+
+       host -> receivedDatagrams [i].buffers = & host -> receivedBuffers [i];
+       host -> receivedDatagrams [i].bufferCount = 1;
+    }
+
+    return 0;
+}
+
+static int
+enet_host_allocate_peer_index (ENetHost * host, size_t peerCount)
+{
+    size_t indexSize = 2;
+
+    /* Keep both tables at most half full so probe sequences stay short. */
+    while (indexSize < peerCount * 2)
+      indexSize <<= 1;
+
+    host -> peerIndex = (ENetPeer **) enet_malloc (indexSize * (sizeof (ENetPeer *) + sizeof (ENetAddressCount)) + peerCount * sizeof (ENetPeer *));
+    if (host -> peerIndex == NULL)
+      return -1;
+
+    memset (host -> peerIndex, 0, indexSize * (sizeof (ENetPeer *) + sizeof (ENetAddressCount)));
+
+    host -> addressCounts = (ENetAddressCount *) & host -> peerIndex [indexSize];
+    host -> freePeers = (ENetPeer **) & host -> addressCounts [indexSize];
+    host -> indexMask = indexSize - 1;
+    host -> freePeerCount = 0;
+
+    return 0;
+}
+
 /** Creates a host for communicating to peers.  
 
     @param address   the address at which other peers may connect to this host.  If NULL, then no peers may connect to the host.
@@ -48,12 +100,31 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     }
     memset (host -> peers, 0, peerCount * sizeof (ENetPeer));
 
+    if (enet_host_allocate_receive_buffers (host, ENET_PROTOCOL_MAXIMUM_MTU) < 0)
+    {
+       enet_free (host -> peers);
+       enet_free (host);
+
+       return NULL;
+    }
+
+    if (enet_host_allocate_peer_index (host, peerCount) < 0)
+    {
+       enet_free (host -> receivedDatagramData);
+       enet_free (host -> peers);
+       enet_free (host);
+
+       return NULL;
+    }
+
     host -> socket = enet_socket_create (ENET_SOCKET_TYPE_DATAGRAM);
     if (host -> socket == ENET_SOCKET_NULL || (address != NULL && enet_socket_bind (host -> socket, address) < 0))
     {
        if (host -> socket != ENET_SOCKET_NULL)
          enet_socket_destroy (host -> socket);
 
+       enet_free (host -> peerIndex);
+       enet_free (host -> receivedDatagramData);
        enet_free (host -> peers);
        enet_free (host);
 
@@ -68,6 +139,9 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     if (address != NULL && enet_socket_get_address (host -> socket, & host -> address) < 0)   
       host -> address = * address;
 
+    host -> wakeupSocket = ENET_SOCKET_NULL;
+    host -> wakeupSignal = ENET_SOCKET_NULL;
+
     if (! channelLimit || channelLimit > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT)
       channelLimit = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
     else
@@ -77,6 +151,13 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     host -> randomSeed = (enet_uint32) (size_t) host;
     host -> randomSeed += enet_host_random_seed ();
     host -> randomSeed = (host -> randomSeed << 16) | (host -> randomSeed >> 16);
+    host -> indexSeed = enet_host_random (host);
+    host -> connectCookies = 0;
+    host -> connectCookieKey [0] = enet_host_random (host);
+    host -> connectCookieKey [1] = enet_host_random (host);
+    host -> capabilities = ENET_PROTOCOL_CAPABILITY_ALL;
+    host -> maximumWindowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    host -> probeMtu = 0;
     host -> channelLimit = channelLimit;
     host -> incomingBandwidth = incomingBandwidth;
     host -> outgoingBandwidth = outgoingBandwidth;
@@ -91,11 +172,26 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     host -> receivedAddress.port = 0;
     host -> receivedData = NULL;
     host -> receivedDataLength = 0;
+    host -> sendDatagrams = NULL;
+    host -> stagedDatagrams = NULL;
+    host -> stagedDatagramCount = 0;
+    host -> stagedBuffers = NULL;
+    host -> stagedBufferCount = 0;
+    host -> sendBatchLimit = 0;
+    host -> segmentationOffload = 0;
      
     host -> totalSentData = 0;
     host -> totalSentPackets = 0;
+    host -> totalSendCalls = 0;
     host -> totalReceivedData = 0;
     host -> totalReceivedPackets = 0;
+    host -> totalReceiveCalls = 0;
+
+    host -> compressionThreshold = ENET_HOST_DEFAULT_COMPRESSION_THRESHOLD;
+    host -> totalCompressedDatagrams = 0;
+    host -> totalCompressionBypasses = 0;
+    host -> totalCompressionSavedData = 0;
+    host -> totalCompressionTime = 0;
 
     host -> connectedPeers = 0;
     host -> bandwidthLimitedPeers = 0;
@@ -108,9 +204,18 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     host -> compressor.decompress = NULL;
     host -> compressor.destroy = NULL;
 
+    memset (& host -> congestionControl, 0, sizeof (host -> congestionControl));
+
     host -> intercept = NULL;
 
     enet_list_clear (& host -> dispatchQueue);
+    enet_list_clear (& host -> sendQueue);
+    enet_list_clear (& host -> sendVisited);
+    enet_timer_wheel_initialize (& host -> timers, 0);
+
+    enet_pool_initialize (& host -> outgoingCommandPool, sizeof (ENetOutgoingCommand));
+    enet_pool_initialize (& host -> incomingCommandPool, sizeof (ENetIncomingCommand));
+    enet_pool_initialize (& host -> acknowledgementPool, sizeof (ENetAcknowledgement));
 
     for (currentPeer = host -> peers;
          currentPeer < & host -> peers [host -> peerCount];
@@ -126,10 +231,17 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
        enet_list_clear (& currentPeer -> sentUnreliableCommands);
        enet_list_clear (& currentPeer -> outgoingCommands);
        enet_list_clear (& currentPeer -> dispatchedCommands);
+       enet_timer_initialize (& currentPeer -> timer);
 
        enet_peer_reset (currentPeer);
     }
 
+    /* Hand out free peers in array order at first. */
+    for (currentPeer = & host -> peers [host -> peerCount];
+         currentPeer > host -> peers;
+         -- currentPeer)
+      enet_host_push_free_peer (host, currentPeer - 1);
+
     return host;
 }
 
@@ -146,6 +258,14 @@ enet_host_destroy (ENetHost * host)
 
     enet_socket_destroy (host -> socket);
 
+    if (host -> wakeupSocket != ENET_SOCKET_NULL)
+    {
+       if (host -> wakeupSignal != host -> wakeupSocket)
+         enet_socket_destroy (host -> wakeupSignal);
+
+       enet_socket_destroy (host -> wakeupSocket);
+    }
+
     for (currentPeer = host -> peers;
          currentPeer < & host -> peers [host -> peerCount];
          ++ currentPeer)
@@ -153,9 +273,22 @@ enet_host_destroy (ENetHost * host)
        enet_peer_reset (currentPeer);
     }
 
+    enet_pool_destroy (& host -> outgoingCommandPool);
+    enet_pool_destroy (& host -> incomingCommandPool);
+    enet_pool_destroy (& host -> acknowledgementPool);
+
     if (host -> compressor.context != NULL && host -> compressor.destroy)
       (* host -> compressor.destroy) (host -> compressor.context);
 
+    if (host -> sendDatagrams != NULL)
+      enet_free (host -> sendDatagrams);
+    if (host -> stagedDatagrams != NULL)
+      enet_free (host -> stagedDatagrams);
+    if (host -> stagedBuffers != NULL)
+      enet_free (host -> stagedBuffers);
+
+    enet_free (host -> peerIndex);
+    enet_free (host -> receivedDatagramData);
     enet_free (host -> peers);
     enet_free (host);
 }
@@ -170,6 +303,161 @@ enet_host_random (ENetHost * host)
     return n ^ (n >> 14);
 }
 
+static size_t
+enet_host_hash_peer (ENetHost * host, enet_uint32 address, enet_uint16 port, enet_uint32 connectID)
+{
+    enet_uint32 hash = (host -> indexSeed ^ address) * 0x9E3779B1U;
+
+    hash = (hash ^ (hash >> 15) ^ port) * 0x85EBCA6BU;
+    hash = (hash ^ (hash >> 13) ^ connectID) * 0xC2B2AE35U;
+
+    return (hash ^ (hash >> 16)) & host -> indexMask;
+}
+
+static size_t
+enet_host_hash_address (ENetHost * host, enet_uint32 address)
+{
+    enet_uint32 hash = (host -> indexSeed ^ address) * 0x9E3779B1U;
+
+    hash = (hash ^ (hash >> 15)) * 0x85EBCA6BU;
+
+    return (hash ^ (hash >> 13)) & host -> indexMask;
+}
+
+/** Finds the peer, neither disconnected nor connecting, with the given address and connectID. */
+ENetPeer *
+enet_host_find_peer (ENetHost * host, const ENetAddress * address, enet_uint32 connectID)
+{
+    size_t index = enet_host_hash_peer (host, address -> host, address -> port, connectID);
+    ENetPeer * peer;
+
+    for (; (peer = host -> peerIndex [index]) != NULL; index = (index + 1) & host -> indexMask)
+    {
+        if (peer -> address.host == address -> host &&
+            peer -> address.port == address -> port &&
+            peer -> connectID == connectID)
+          return peer;
+    }
+
+    return NULL;
+}
+
+/** Returns how many peers, neither disconnected nor connecting, have the IP address. */
+size_t
+enet_host_address_peer_count (ENetHost * host, enet_uint32 address)
+{
+    size_t index = enet_host_hash_address (host, address);
+
+    for (; host -> addressCounts [index].count > 0; index = (index + 1) & host -> indexMask)
+    {
+        if (host -> addressCounts [index].host == address)
+          return host -> addressCounts [index].count;
+    }
+
+    return 0;
+}
+
+/** Adds the peer to the host's lookup tables. Its address and connectID must not change until
+    it is removed again with enet_host_unindex_peer().
+*/
+void
+enet_host_index_peer (ENetHost * host, ENetPeer * peer)
+{
+    size_t index;
+
+    if (peer -> flags & ENET_PEER_FLAG_INDEXED)
+      return;
+
+    index = enet_host_hash_peer (host, peer -> address.host, peer -> address.port, peer -> connectID);
+    while (host -> peerIndex [index] != NULL)
+      index = (index + 1) & host -> indexMask;
+
+    host -> peerIndex [index] = peer;
+
+    index = enet_host_hash_address (host, peer -> address.host);
+    while (host -> addressCounts [index].count > 0 &&
+           host -> addressCounts [index].host != peer -> address.host)
+      index = (index + 1) & host -> indexMask;
+
+    host -> addressCounts [index].host = peer -> address.host;
+    ++ host -> addressCounts [index].count;
+
+    peer -> flags |= ENET_PEER_FLAG_INDEXED;
+}
+
+/** Removes the peer from the host's lookup tables.
+*/
+void
+enet_host_unindex_peer (ENetHost * host, ENetPeer * peer)
+{
+    size_t index, hole, home;
+
+    if (! (peer -> flags & ENET_PEER_FLAG_INDEXED))
+      return;
+
+    /* Both tables delete by shifting later entries of the probe sequence back into the hole, so
+       lookups never need tombstones. An entry may only move back as far as its home slot. */
+
+    peer -> flags &= ~ ENET_PEER_FLAG_INDEXED;
+
+    index = enet_host_hash_peer (host, peer -> address.host, peer -> address.port, peer -> connectID);
+    while (host -> peerIndex [index] != peer)
+      index = (index + 1) & host -> indexMask;
+
+    for (hole = index, index = (index + 1) & host -> indexMask;
+         host -> peerIndex [index] != NULL;
+         index = (index + 1) & host -> indexMask)
+    {
+        ENetPeer * entry = host -> peerIndex [index];
+
+        home = enet_host_hash_peer (host, entry -> address.host, entry -> address.port, entry -> connectID);
+        if (((index - home) & host -> indexMask) >= ((index - hole) & host -> indexMask))
+        {
+            host -> peerIndex [hole] = entry;
+            hole = index;
+        }
+    }
+
+    host -> peerIndex [hole] = NULL;
+
+    index = enet_host_hash_address (host, peer -> address.host);
+    while (host -> addressCounts [index].host != peer -> address.host)
+      index = (index + 1) & host -> indexMask;
+
+    if (-- host -> addressCounts [index].count > 0)
+      return;
+
+    for (hole = index, index = (index + 1) & host -> indexMask;
+         host -> addressCounts [index].count > 0;
+         index = (index + 1) & host -> indexMask)
+    {
+        home = enet_host_hash_address (host, host -> addressCounts [index].host);
+        if (((index - home) & host -> indexMask) >= ((index - hole) & host -> indexMask))
+        {
+            host -> addressCounts [hole] = host -> addressCounts [index];
+            hole = index;
+        }
+    }
+
+    host -> addressCounts [hole].count = 0;
+}
+
+/** Takes a disconnected peer off the host's free stack, or returns NULL if every peer is in use. */
+ENetPeer *
+enet_host_pop_free_peer (ENetHost * host)
+{
+    if (host -> freePeerCount == 0)
+      return NULL;
+
+    return host -> freePeers [-- host -> freePeerCount];
+}
+
+void
+enet_host_push_free_peer (ENetHost * host, ENetPeer * peer)
+{
+    host -> freePeers [host -> freePeerCount ++] = peer;
+}
+
 /** Initiates a connection to a foreign host.
     @param host host seeking the connection
     @param address destination for the connection
@@ -192,27 +480,25 @@ enet_host_connect (ENetHost * host, const ENetAddress * address, size_t channelC
     if (channelCount > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT)
       channelCount = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
 
-    for (currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
-         ++ currentPeer)
-    {
-       if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED)
-         break;
-    }
-
-    if (currentPeer >= & host -> peers [host -> peerCount])
+    currentPeer = enet_host_pop_free_peer (host);
+    if (currentPeer == NULL)
       return NULL;
 
     currentPeer -> channels = (ENetChannel *) enet_malloc (channelCount * sizeof (ENetChannel));
     if (currentPeer -> channels == NULL)
-      return NULL;
+    {
+       enet_host_push_free_peer (host, currentPeer);
+
+       return NULL;
+    }
     currentPeer -> channelCount = channelCount;
     currentPeer -> state = ENET_PEER_STATE_CONNECTING;
     currentPeer -> address = * address;
     currentPeer -> connectID = enet_host_random (host);
+    currentPeer -> maximumWindowSize = host -> maximumWindowSize;
 
     if (host -> outgoingBandwidth == 0)
-      currentPeer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+      currentPeer -> windowSize = currentPeer -> maximumWindowSize;
     else
       currentPeer -> windowSize = (host -> outgoingBandwidth /
                                     ENET_PEER_WINDOW_SIZE_SCALE) * 
@@ -221,8 +507,8 @@ enet_host_connect (ENetHost * host, const ENetAddress * address, size_t channelC
     if (currentPeer -> windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       currentPeer -> windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
     else
-    if (currentPeer -> windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      currentPeer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    if (currentPeer -> windowSize > currentPeer -> maximumWindowSize)
+      currentPeer -> windowSize = currentPeer -> maximumWindowSize;
          
     for (channel = currentPeer -> channels;
          channel < & currentPeer -> channels [channelCount];
@@ -233,8 +519,11 @@ enet_host_connect (ENetHost * host, const ENetAddress * address, size_t channelC
         channel -> incomingReliableSequenceNumber = 0;
         channel -> incomingUnreliableSequenceNumber = 0;
 
-        enet_list_clear (& channel -> incomingReliableCommands);
+        channel -> incomingReliableCapacity = 0;
+        channel -> incomingReliableCount = 0;
+        channel -> incomingReliableCommands = NULL;
         enet_list_clear (& channel -> incomingUnreliableCommands);
+        channel -> incomingUnreliableFragment = NULL;
 
         channel -> usedReliableWindows = 0;
         memset (channel -> reliableWindows, 0, sizeof (channel -> reliableWindows));
@@ -270,17 +559,61 @@ void
 enet_host_broadcast (ENetHost * host, enet_uint8 channelID, ENetPacket * packet)
 {
     ENetPeer * currentPeer;
+    ENetOutgoingCommand * fragments = NULL;
+    size_t fragmentsLength = 0;
+    enet_uint32 fragmentCount = 0,
+                fragmentNumber;
 
     for (currentPeer = host -> peers;
          currentPeer < & host -> peers [host -> peerCount];
          ++ currentPeer)
     {
+       size_t fragmentLength;
+
        if (currentPeer -> state != ENET_PEER_STATE_CONNECTED)
          continue;
 
-       enet_peer_send (currentPeer, channelID, packet);
+       fragmentLength = enet_peer_fragment_length (currentPeer);
+       if (packet -> dataLength <= fragmentLength ||
+           channelID >= currentPeer -> channelCount ||
+           packet -> dataLength > host -> maximumPacketSize)
+       {
+          enet_peer_send (currentPeer, channelID, packet);
+          continue;
+       }
+
+       /* Peers mostly share an MTU, so the fragments are only filled in again when it changes. */
+       if (fragmentLength != fragmentsLength)
+       {
+          if (fragments != NULL)
+            enet_free (fragments);
+
+          fragments = NULL;
+          fragmentsLength = 0;
+
+          fragmentCount = (packet -> dataLength + fragmentLength - 1) / fragmentLength;
+          if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
+            continue;
+
+          fragments = (ENetOutgoingCommand *) enet_malloc (fragmentCount * sizeof (ENetOutgoingCommand));
+          if (fragments == NULL)
+          {
+             enet_peer_send (currentPeer, channelID, packet);
+             continue;
+          }
+
+          for (fragmentNumber = 0; fragmentNumber < fragmentCount; ++ fragmentNumber)
+            enet_peer_setup_fragment (& fragments [fragmentNumber], packet, channelID, fragmentLength, fragmentCount, fragmentNumber);
+
+          fragmentsLength = fragmentLength;
+       }
+
+       enet_peer_send_fragments (currentPeer, channelID, packet, fragmentLength, fragmentCount, fragments);
     }
 
+    if (fragments != NULL)
+      enet_free (fragments);
+
     if (packet -> referenceCount == 0)
       enet_packet_destroy (packet);
 }
@@ -301,6 +634,30 @@ enet_host_compress (ENetHost * host, const ENetCompressor * compressor)
       host -> compressor.context = NULL;
 }
 
+/** Sets the congestion controller the host should use for the reliable data sent to its peers.
+    Connected peers start over with the new controller.
+    @param host host to set the congestion controller for
+    @param congestionControl callbacks for the congestion controller; if NULL, then reliable data is only limited by the packet throttle
+*/
+void
+enet_host_congestion_control (ENetHost * host, const ENetCongestionControl * congestionControl)
+{
+    ENetPeer * currentPeer;
+
+    if (congestionControl)
+      host -> congestionControl = * congestionControl;
+    else
+      memset (& host -> congestionControl, 0, sizeof (host -> congestionControl));
+
+    for (currentPeer = host -> peers;
+         currentPeer < & host -> peers [host -> peerCount];
+         ++ currentPeer)
+    {
+       if (currentPeer -> state == ENET_PEER_STATE_CONNECTED || currentPeer -> state == ENET_PEER_STATE_DISCONNECT_LATER)
+         enet_peer_reset_congestion (currentPeer);
+    }
+}
+
 /** Limits the maximum allowed channels of future incoming connections.
     @param host host to limit
     @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
@@ -317,6 +674,239 @@ enet_host_channel_limit (ENetHost * host, size_t channelLimit)
     host -> channelLimit = channelLimit;
 }
 
+/** Limits the reliable window offered to future connections. A window above
+    ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE is only used with peers that offer one too; hosts that
+    predate window scaling keep connecting with ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE.
+    @param host host to limit
+    @param windowLimit the largest window in bytes; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE
+*/
+void
+enet_host_window_limit (ENetHost * host, enet_uint32 windowLimit)
+{
+    if (! windowLimit || windowLimit > ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE)
+      windowLimit = ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE;
+    else
+    if (windowLimit < ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
+      windowLimit = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+
+    host -> maximumWindowSize = windowLimit;
+}
+
+/** Turns on path MTU discovery: the MTU of each connected peer is raised as far as padded pings
+    sent without fragmentation show the path carries, and falls back to ENET_PROTOCOL_MINIMUM_MTU
+    when datagrams at the raised MTU stop getting through. Only peers that offer
+    ENET_PROTOCOL_CAPABILITY_JUMBO_FRAMES are probed above ENET_PROTOCOL_STANDARD_MAXIMUM_MTU.
+    @param host host to configure
+    @param probeMtu the largest MTU to probe for, at most ENET_PROTOCOL_MAXIMUM_MTU; if 0, no more probes are sent and peers keep the MTU they have
+    @returns 0 on success, < 0 if the host's socket cannot forbid fragmentation, in which case no probes are sent
+*/
+int
+enet_host_probe_mtu (ENetHost * host, enet_uint32 probeMtu)
+{
+    ENetPeer * currentPeer;
+    int dontFragment;
+
+    /* A probe that went through in pieces would vouch for a size the path does not carry. */
+    if (probeMtu != 0 &&
+        (enet_socket_get_option (host -> socket, ENET_SOCKOPT_DONTFRAGMENT, & dontFragment) < 0 ||
+         enet_socket_set_option (host -> socket, ENET_SOCKOPT_DONTFRAGMENT, 1) < 0 ||
+         enet_socket_set_option (host -> socket, ENET_SOCKOPT_DONTFRAGMENT, dontFragment) < 0))
+    {
+       host -> probeMtu = 0;
+
+       return -1;
+    }
+
+    if (probeMtu > ENET_PROTOCOL_MAXIMUM_MTU)
+      probeMtu = ENET_PROTOCOL_MAXIMUM_MTU;
+    else
+    if (probeMtu != 0 && probeMtu < ENET_PROTOCOL_MINIMUM_MTU)
+      probeMtu = ENET_PROTOCOL_MINIMUM_MTU;
+
+    host -> probeMtu = probeMtu;
+
+    /* Searches under the old limit start over. */
+    for (currentPeer = host -> peers;
+         currentPeer < & host -> peers [host -> peerCount];
+         ++ currentPeer)
+      currentPeer -> mtuProbeLimit = 0;
+
+    return 0;
+}
+
+/** Sets the number of datagrams staged before they are sent together in one socket call.
+    @param host host to configure
+    @param datagramLimit the maximum number of datagrams staged per socket send; if 0, each datagram is sent as soon as it is built
+    @returns 0 on success, < 0 on failure
+
+    @remarks Staging takes about 7KB of memory per datagram. On Linux the staged datagrams are
+    sent with a single sendmmsg call, which greatly reduces system calls for hosts with many peers.
+*/
+int
+enet_host_send_batch_limit (ENetHost * host, size_t datagramLimit)
+{
+    if (host -> sendDatagrams != NULL)
+    {
+       enet_free (host -> sendDatagrams);
+
+       host -> sendDatagrams = NULL;
+    }
+
+    if (host -> stagedDatagrams != NULL)
+    {
+       enet_free (host -> stagedDatagrams);
+
+       host -> stagedDatagrams = NULL;
+    }
+
+    if (host -> stagedBuffers != NULL)
+    {
+       enet_free (host -> stagedBuffers);
+
+       host -> stagedBuffers = NULL;
+    }
+
+    host -> stagedDatagramCount = 0;
+    host -> stagedBufferCount = 0;
+    host -> sendBatchLimit = 0;
+
+    if (datagramLimit == 0)
+    {
+       host -> segmentationOffload &= ~ ENET_SEGMENTATION_OFFLOAD_SEND;
+
+       return 0;
+    }
+
+    host -> sendDatagrams = (ENetDatagram *) enet_malloc (datagramLimit * sizeof (ENetDatagram));
+    host -> stagedDatagrams = (ENetStagedDatagram *) enet_malloc (datagramLimit * sizeof (ENetStagedDatagram));
+    host -> stagedBuffers = (ENetBuffer *) enet_malloc (datagramLimit * ENET_BUFFER_MAXIMUM * sizeof (ENetBuffer));
+    if (host -> sendDatagrams == NULL || host -> stagedDatagrams == NULL || host -> stagedBuffers == NULL)
+    {
+       enet_host_send_batch_limit (host, 0);
+
+       return -1;
+    }
+
+    host -> sendBatchLimit = datagramLimit;
+
+    return 0;
+}
+
+/** Enables UDP segmentation offload on the host's socket where the system supports it.
+    @param host host to configure
+    @param offload bitwise-or of the ENetSegmentationOffload directions to enable
+    @returns the directions that were actually enabled
+
+    @remarks This should be set right after enet_host_create(). With ENET_SEGMENTATION_OFFLOAD_SEND,
+    batched sends are turned on if they are not already, and runs of equally sized datagrams to the
+    same peer, such as the fragments of a large packet, leave in one socket send. If the system refuses
+    a segmented send, the host falls back to sending the datagrams one at a time. With
+    ENET_SEGMENTATION_OFFLOAD_RECEIVE, datagrams coalesced by the system are split back into ENet
+    datagrams as they are received; this needs 2MB of receive buffers instead of 128KB.
+*/
+enet_uint32
+enet_host_segmentation_offload (ENetHost * host, enet_uint32 offload)
+{
+    if (offload & ENET_SEGMENTATION_OFFLOAD_SEND)
+    {
+       if (! (host -> segmentationOffload & ENET_SEGMENTATION_OFFLOAD_SEND) &&
+           enet_socket_set_option (host -> socket, ENET_SOCKOPT_GSO, 0) >= 0 &&
+           (host -> sendBatchLimit > 0 || enet_host_send_batch_limit (host, ENET_HOST_DEFAULT_SEND_BATCH_LIMIT) >= 0))
+         host -> segmentationOffload |= ENET_SEGMENTATION_OFFLOAD_SEND;
+    }
+    else
+      host -> segmentationOffload &= ~ ENET_SEGMENTATION_OFFLOAD_SEND;
+
+    if (offload & ENET_SEGMENTATION_OFFLOAD_RECEIVE)
+    {
+       if (! (host -> segmentationOffload & ENET_SEGMENTATION_OFFLOAD_RECEIVE) &&
+           enet_host_allocate_receive_buffers (host, ENET_HOST_SEGMENT_RECEIVE_BUFFER_SIZE) >= 0)
+       {
+          if (enet_socket_set_option (host -> socket, ENET_SOCKOPT_GRO, 1) >= 0)
+            host -> segmentationOffload |= ENET_SEGMENTATION_OFFLOAD_RECEIVE;
+          else
+            enet_host_allocate_receive_buffers (host, ENET_PROTOCOL_MAXIMUM_MTU);
+       }
+    }
+    else
+    if (host -> segmentationOffload & ENET_SEGMENTATION_OFFLOAD_RECEIVE)
+    {
+       enet_socket_set_option (host -> socket, ENET_SOCKOPT_GRO, 0);
+
+       if (enet_host_allocate_receive_buffers (host, ENET_PROTOCOL_MAXIMUM_MTU) >= 0)
+         host -> segmentationOffload &= ~ ENET_SEGMENTATION_OFFLOAD_RECEIVE;
+    }
+
+    return host -> segmentationOffload;
+}
+
+/** Lets other threads interrupt enet_host_service() on this host with enet_host_wakeup().
+    @param host host to configure
+    @returns 0 on success, < 0 if the wakeup channel could not be created
+
+    @remarks Once enabled, enet_host_service() waits on the host's socket and the wakeup channel
+    together and returns 0 as soon as a wakeup arrives, so a caller can block with a long timeout
+    and still react immediately to work handed over from other threads.
+*/
+int
+enet_host_enable_wakeup (ENetHost * host)
+{
+    if (host -> wakeupSocket != ENET_SOCKET_NULL)
+      return 0;
+
+    return enet_socket_create_wakeup (& host -> wakeupSocket, & host -> wakeupSignal);
+}
+
+/** Interrupts a wait inside enet_host_service() on this host, or the next one if it is not waiting.
+    @param host host to wake, which must have had enet_host_enable_wakeup() called on it
+    @returns 0 on success, < 0 on failure
+
+    @remarks This is the only function that may be called on a host from a thread other than the
+    one servicing it.
+*/
+int
+enet_host_wakeup (ENetHost * host)
+{
+    if (host -> wakeupSignal == ENET_SOCKET_NULL)
+      return -1;
+
+    return enet_socket_signal_wakeup (host -> wakeupSignal);
+}
+
+/** Makes the host check that connecting peers can receive at their address before it sets a peer up for them.
+    @param host host to configure
+    @param enable nonzero to require connect cookies, 0 to accept connects directly
+
+    @remarks A connect without a valid cookie is answered with a cookie computed from the sender's address,
+    its connect ID and the current time, and is otherwise forgotten. Only a connect that echoes the cookie
+    claims a peer and allocates its channels, so a flood of connects from spoofed addresses costs the host one
+    small reply each. Cookies stay valid for ENET_HOST_CONNECT_COOKIE_INTERVAL to twice that. Connecting peers
+    answer cookies on their own; a peer that does not know the cookie command can no longer connect.
+*/
+void
+enet_host_connect_cookies (ENetHost * host, int enable)
+{
+    host -> connectCookies = enable ? 1 : 0;
+}
+
+/** Limits how many protocol commands a host may hold in memory at once.
+    @param host host to limit
+    @param outgoingCommands most outgoing commands queued or awaiting acknowledgement, across all peers
+    @param incomingCommands most incoming commands awaiting reassembly, ordering or dispatch
+    @param acknowledgements most acknowledgements waiting to be sent
+
+    @remarks A limit of 0 leaves that kind of command unlimited, which is the default. A limit takes
+    effect as the host next needs more memory for commands; what is already allocated is kept. Once a
+    limit is reached, sends fail and incoming commands are treated as if memory had run out. The peak
+    number of commands used is kept in each pool's peakUsedCount, which helps pick a limit.
+*/
+void
+enet_host_pool_limit (ENetHost * host, size_t outgoingCommands, size_t incomingCommands, size_t acknowledgements)
+{
+    host -> outgoingCommandPool.maximumObjects = outgoingCommands;
+    host -> incomingCommandPool.maximumObjects = incomingCommands;
+    host -> acknowledgementPool.maximumObjects = acknowledgements;
+}
 
 /** Adjusts the bandwidth limits of a host.
     @param host host to adjust
@@ -10,35 +10,71 @@
     @{ 
 */
 
+/* Payloads that fit share one allocation with their packet, rounded up to one of these sizes so a
+   packet that grows a little, like one resized to append to it, usually stays where it is. */
+static const size_t packetSizeClasses [] = { 128, 256, 512 };
+
+#define ENET_PACKET_SIZE_CLASSES (sizeof (packetSizeClasses) / sizeof (packetSizeClasses [0]))
+#define ENET_PACKET_INLINE_DATA(packet) ((enet_uint8 *) ((packet) + 1))
+
 /** Creates a packet that may be sent to a peer.
     @param data         initial contents of the packet's data; the packet's data will remain uninitialized if data is NULL.
     @param dataLength   size of the data allocated for this packet
     @param flags        flags for this packet as described for the ENetPacket structure.
     @returns the packet on success, NULL on failure
+    @remarks Small packets are allocated together with their data, so creating one costs a single allocation.
 */
 ENetPacket *
 enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
 {
-    ENetPacket * packet = (ENetPacket *) enet_malloc (sizeof (ENetPacket));
-    if (packet == NULL)
-      return NULL;
+    ENetPacket * packet;
+    size_t sizeClass = ENET_PACKET_SIZE_CLASSES;
 
-    if (flags & ENET_PACKET_FLAG_NO_ALLOCATE)
-      packet -> data = (enet_uint8 *) data;
-    else
-    if (dataLength <= 0)
-      packet -> data = NULL;
+    if (! (flags & ENET_PACKET_FLAG_NO_ALLOCATE) && dataLength > 0)
+    {
+       for (sizeClass = 0;
+            sizeClass < ENET_PACKET_SIZE_CLASSES && sizeof (ENetPacket) + dataLength > packetSizeClasses [sizeClass];
+            ++ sizeClass)
+         ;
+    }
+
+    if (sizeClass < ENET_PACKET_SIZE_CLASSES)
+    {
+       packet = (ENetPacket *) enet_malloc (packetSizeClasses [sizeClass]);
+       if (packet == NULL)
+         return NULL;
+
+       packet -> data = ENET_PACKET_INLINE_DATA (packet);
+       packet -> dataCapacity = packetSizeClasses [sizeClass] - sizeof (ENetPacket);
+
+       if (data != NULL)
+         memcpy (packet -> data, data, dataLength);
+    }
     else
     {
-       packet -> data = (enet_uint8 *) enet_malloc (dataLength);
-       if (packet -> data == NULL)
+       packet = (ENetPacket *) enet_malloc (sizeof (ENetPacket));
+       if (packet == NULL)
+         return NULL;
+
+       if (flags & ENET_PACKET_FLAG_NO_ALLOCATE)
+         packet -> data = (enet_uint8 *) data;
+       else
+       if (dataLength <= 0)
+         packet -> data = NULL;
+       else
        {
-          enet_free (packet);
-          return NULL;
+          packet -> data = (enet_uint8 *) enet_malloc (dataLength);
+          if (packet -> data == NULL)
+          {
+             enet_free (packet);
+             return NULL;
+          }
+
+          if (data != NULL)
+            memcpy (packet -> data, data, dataLength);
        }
 
-       if (data != NULL)
-         memcpy (packet -> data, data, dataLength);
+       packet -> dataCapacity = dataLength;
     }
 
     packet -> referenceCount = 0;
@@ -62,7 +98,8 @@ enet_packet_destroy (ENetPacket * packet)
     if (packet -> freeCallback != NULL)
       (* packet -> freeCallback) (packet);
     if (! (packet -> flags & ENET_PACKET_FLAG_NO_ALLOCATE) &&
-        packet -> data != NULL)
+        packet -> data != NULL &&
+        packet -> data != ENET_PACKET_INLINE_DATA (packet))
       enet_free (packet -> data);
     enet_free (packet);
 }
@@ -78,7 +115,7 @@ enet_packet_resize (ENetPacket * packet, size_t dataLength)
 {
     enet_uint8 * newData;
    
-    if (dataLength <= packet -> dataLength || (packet -> flags & ENET_PACKET_FLAG_NO_ALLOCATE))
+    if (dataLength <= packet -> dataCapacity || (packet -> flags & ENET_PACKET_FLAG_NO_ALLOCATE))
     {
        packet -> dataLength = dataLength;
 
@@ -90,76 +127,14 @@ enet_packet_resize (ENetPacket * packet, size_t dataLength)
       return -1;
 
     memcpy (newData, packet -> data, packet -> dataLength);
-    enet_free (packet -> data);
+    if (packet -> data != ENET_PACKET_INLINE_DATA (packet))
+      enet_free (packet -> data);
     
     packet -> data = newData;
     packet -> dataLength = dataLength;
+    packet -> dataCapacity = dataLength;
 
     return 0;
 }
 
-static int initializedCRC32 = 0;
-static enet_uint32 crcTable [256];
-
-static enet_uint32 
-reflect_crc (int val, int bits)
-{
-    int result = 0, bit;
-
-    for (bit = 0; bit < bits; bit ++)
-    {
-        if(val & 1) result |= 1 << (bits - 1 - bit); 
-        val >>= 1;
-    }
-
-    return result;
-}
-
-static void 
-initialize_crc32 (void)
-{
-    int byte;
-
-    for (byte = 0; byte < 256; ++ byte)
-    {
-        enet_uint32 crc = reflect_crc (byte, 8) << 24;
-        int offset;
-
-        for(offset = 0; offset < 8; ++ offset)
-        {
-            if (crc & 0x80000000)
-                crc = (crc << 1) ^ 0x04c11db7;
-            else
-                crc <<= 1;
-        }
-
-        crcTable [byte] = reflect_crc (crc, 32);
-    }
-
-    initializedCRC32 = 1;
-}
-    
-enet_uint32
-enet_crc32 (const ENetBuffer * buffers, size_t bufferCount)
-{
-    enet_uint32 crc = 0xFFFFFFFF;
-    
-    if (! initializedCRC32) initialize_crc32 ();
-
-    while (bufferCount -- > 0)
-    {
-        const enet_uint8 * data = (const enet_uint8 *) buffers -> data,
-                         * dataEnd = & data [buffers -> dataLength];
-
-        while (data < dataEnd)
-        {
-            crc = (crc >> 8) ^ crcTable [(crc & 0xFF) ^ *data++];        
-        }
-
-        ++ buffers;
-    }
-
-    return ENET_HOST_TO_NET_32 (~ crc);
-}
-
 /** @} */
@@ -4,6 +4,7 @@
 */
 #include <string.h>
 #define ENET_BUILDING_LIB 1
+#include "enet/time.h"
 #include "enet/enet.h"
 
 /** @defgroup peer ENet peer functions 
@@ -89,6 +90,86 @@ enet_peer_throttle (ENetPeer * peer, enet_uint32 rtt)
     return 0;
 }
 
+/** Returns how much of a packet fits in each fragment sent to peer. */
+size_t
+enet_peer_fragment_length (const ENetPeer * peer)
+{
+   size_t fragmentLength = peer -> mtu - sizeof (ENetProtocolHeader) - sizeof (ENetProtocolSendFragment);
+
+   if (peer -> host -> checksum != NULL)
+     fragmentLength -= sizeof (enet_uint32);
+
+   return fragmentLength;
+}
+
+/** Fills in everything about fragment fragmentNumber of packet that does not depend on the peer it goes to. */
+void
+enet_peer_setup_fragment (ENetOutgoingCommand * fragment, ENetPacket * packet, enet_uint8 channelID, size_t fragmentLength, enet_uint32 fragmentCount, enet_uint32 fragmentNumber)
+{
+   enet_uint32 fragmentOffset = fragmentNumber * fragmentLength;
+
+   if (packet -> dataLength - fragmentOffset < fragmentLength)
+     fragmentLength = packet -> dataLength - fragmentOffset;
+
+   fragment -> fragmentOffset = fragmentOffset;
+   fragment -> fragmentLength = fragmentLength;
+   fragment -> packet = packet;
+   fragment -> command.header.channelID = channelID;
+   fragment -> command.sendFragment.dataLength = ENET_HOST_TO_NET_16 (fragmentLength);
+   fragment -> command.sendFragment.fragmentCount = ENET_HOST_TO_NET_32 (fragmentCount);
+   fragment -> command.sendFragment.fragmentNumber = ENET_HOST_TO_NET_32 (fragmentNumber);
+   fragment -> command.sendFragment.totalLength = ENET_HOST_TO_NET_32 (packet -> dataLength);
+   fragment -> command.sendFragment.fragmentOffset = ENET_HOST_TO_NET_32 (fragmentOffset);
+}
+
+/** Queues packet to peer as fragmentCount fragments of fragmentLength bytes each but the last.
+    If fragments is not NULL, it holds the fragments as enet_peer_setup_fragment () filled them in,
+    so a broadcast only does that once; each is copied and only gets the peer's sequence numbers.
+*/
+int
+enet_peer_send_fragments (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, size_t fragmentLength, enet_uint32 fragmentCount, const ENetOutgoingCommand * fragments)
+{
+   ENetChannel * channel = & peer -> channels [channelID];
+   enet_uint32 fragmentNumber;
+   enet_uint8 commandNumber;
+   enet_uint16 startSequenceNumber;
+   ENetOutgoingCommand * fragment;
+
+   if ((packet -> flags & (ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT)) == ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT &&
+       channel -> outgoingUnreliableSequenceNumber < 0xFFFF)
+   {
+      commandNumber = ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT;
+      startSequenceNumber = ENET_HOST_TO_NET_16 (channel -> outgoingUnreliableSequenceNumber + 1);
+   }
+   else
+   {
+      commandNumber = ENET_PROTOCOL_COMMAND_SEND_FRAGMENT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+      startSequenceNumber = ENET_HOST_TO_NET_16 (channel -> outgoingReliableSequenceNumber + 1);
+   }
+
+   /* Each fragment is queued as soon as it is filled in, so make sure none of them can fail to allocate. */
+   if (enet_pool_reserve (& peer -> host -> outgoingCommandPool, fragmentCount) < 0)
+     return -1;
+
+   for (fragmentNumber = 0; fragmentNumber < fragmentCount; ++ fragmentNumber)
+   {
+      fragment = (ENetOutgoingCommand *) enet_pool_allocate (& peer -> host -> outgoingCommandPool);
+      if (fragments != NULL)
+        * fragment = fragments [fragmentNumber];
+      else
+        enet_peer_setup_fragment (fragment, packet, channelID, fragmentLength, fragmentCount, fragmentNumber);
+
+      fragment -> command.header.command = commandNumber;
+      fragment -> command.sendFragment.startSequenceNumber = startSequenceNumber;
+
+      enet_peer_setup_outgoing_command (peer, fragment);
+   }
+
+   packet -> referenceCount += fragmentCount;
+
+   return 0;
+}
+
 /** Queues a packet to be sent.
 
     On success, ENet will assume ownership of the packet, and so enet_packet_destroy
@@ -116,84 +197,16 @@ enet_peer_send (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet)
      return -1;
 
    channel = & peer -> channels [channelID];
-   fragmentLength = peer -> mtu - sizeof (ENetProtocolHeader) - sizeof (ENetProtocolSendFragment);
-   if (peer -> host -> checksum != NULL)
-     fragmentLength -= sizeof(enet_uint32);
+   fragmentLength = enet_peer_fragment_length (peer);
 
    if (packet -> dataLength > fragmentLength)
    {
-      enet_uint32 fragmentCount = (packet -> dataLength + fragmentLength - 1) / fragmentLength,
-             fragmentNumber,
-             fragmentOffset;
-      enet_uint8 commandNumber;
-      enet_uint16 startSequenceNumber; 
-      ENetList fragments;
-      ENetOutgoingCommand * fragment;
+      enet_uint32 fragmentCount = (packet -> dataLength + fragmentLength - 1) / fragmentLength;
 
       if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
         return -1;
 
-      if ((packet -> flags & (ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT)) == ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT &&
-          channel -> outgoingUnreliableSequenceNumber < 0xFFFF)
-      {
-         commandNumber = ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT;
-         startSequenceNumber = ENET_HOST_TO_NET_16 (channel -> outgoingUnreliableSequenceNumber + 1);
-      }
-      else
-      {
-         commandNumber = ENET_PROTOCOL_COMMAND_SEND_FRAGMENT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
-         startSequenceNumber = ENET_HOST_TO_NET_16 (channel -> outgoingReliableSequenceNumber + 1);
-      }
-        
-      enet_list_clear (& fragments);
-
-      for (fragmentNumber = 0,
-             fragmentOffset = 0;
-           fragmentOffset < packet -> dataLength;
-           ++ fragmentNumber,
-             fragmentOffset += fragmentLength)
-      {
-         if (packet -> dataLength - fragmentOffset < fragmentLength)
-           fragmentLength = packet -> dataLength - fragmentOffset;
-
-         fragment = (ENetOutgoingCommand *) enet_malloc (sizeof (ENetOutgoingCommand));
-         if (fragment == NULL)
-         {
-            while (! enet_list_empty (& fragments))
-            {
-               fragment = (ENetOutgoingCommand *) enet_list_remove (enet_list_begin (& fragments));
-               
-               enet_free (fragment);
-            }
-            
-            return -1;
-         }
-         
-         fragment -> fragmentOffset = fragmentOffset;
-         fragment -> fragmentLength = fragmentLength;
-         fragment -> packet = packet;
-         fragment -> command.header.command = commandNumber;
-         fragment -> command.header.channelID = channelID;
-         fragment -> command.sendFragment.startSequenceNumber = startSequenceNumber;
-         fragment -> command.sendFragment.dataLength = ENET_HOST_TO_NET_16 (fragmentLength);
-         fragment -> command.sendFragment.fragmentCount = ENET_HOST_TO_NET_32 (fragmentCount);
-         fragment -> command.sendFragment.fragmentNumber = ENET_HOST_TO_NET_32 (fragmentNumber);
-         fragment -> command.sendFragment.totalLength = ENET_HOST_TO_NET_32 (packet -> dataLength);
-         fragment -> command.sendFragment.fragmentOffset = ENET_NET_TO_HOST_32 (fragmentOffset);
-        
-         enet_list_insert (enet_list_end (& fragments), fragment);
-      }
-
-      packet -> referenceCount += fragmentNumber;
-
-      while (! enet_list_empty (& fragments))
-      {
-         fragment = (ENetOutgoingCommand *) enet_list_remove (enet_list_begin (& fragments));
- 
-         enet_peer_setup_outgoing_command (peer, fragment);
-      }
-
-      return 0;
+      return enet_peer_send_fragments (peer, channelID, packet, fragmentLength, fragmentCount, NULL);
    }
 
    command.header.channelID = channelID;
@@ -247,7 +260,7 @@ enet_peer_receive (ENetPeer * peer, enet_uint8 * channelID)
    if (incomingCommand -> fragments != NULL)
      enet_free (incomingCommand -> fragments);
 
-   enet_free (incomingCommand);
+   enet_pool_free (& peer -> host -> incomingCommandPool, incomingCommand);
 
    peer -> totalWaitingData -= packet -> dataLength;
 
@@ -255,7 +268,7 @@ enet_peer_receive (ENetPeer * peer, enet_uint8 * channelID)
 }
 
 static void
-enet_peer_reset_outgoing_commands (ENetList * queue)
+enet_peer_reset_outgoing_commands (ENetHost * host, ENetList * queue)
 {
     ENetOutgoingCommand * outgoingCommand;
 
@@ -271,12 +284,29 @@ enet_peer_reset_outgoing_commands (ENetList * queue)
             enet_packet_destroy (outgoingCommand -> packet);
        }
 
-       enet_free (outgoingCommand);
+       enet_pool_free (& host -> outgoingCommandPool, outgoingCommand);
+    }
+}
+
+static void
+enet_peer_destroy_incoming_command (ENetHost * host, ENetIncomingCommand * incomingCommand)
+{
+    if (incomingCommand -> packet != NULL)
+    {
+       -- incomingCommand -> packet -> referenceCount;
+
+       if (incomingCommand -> packet -> referenceCount == 0)
+         enet_packet_destroy (incomingCommand -> packet);
     }
+
+    if (incomingCommand -> fragments != NULL)
+      enet_free (incomingCommand -> fragments);
+
+    enet_pool_free (& host -> incomingCommandPool, incomingCommand);
 }
 
 static void
-enet_peer_remove_incoming_commands (ENetList * queue, ENetListIterator startCommand, ENetListIterator endCommand, ENetIncomingCommand * excludeCommand)
+enet_peer_remove_incoming_commands (ENetHost * host, ENetList * queue, ENetListIterator startCommand, ENetListIterator endCommand, ENetIncomingCommand * excludeCommand)
 {
     ENetListIterator currentCommand;    
     
@@ -291,25 +321,102 @@ enet_peer_remove_incoming_commands (ENetList * queue, ENetListIterator startComm
 
        enet_list_remove (& incomingCommand -> incomingCommandList);
  
-       if (incomingCommand -> packet != NULL)
+       enet_peer_destroy_incoming_command (host, incomingCommand);
+    }
+}
+
+static void
+enet_peer_reset_incoming_reliable_commands (ENetHost * host, ENetChannel * channel)
+{
+    enet_uint16 slot;
+
+    if (channel -> incomingReliableCommands == NULL)
+      return;
+
+    for (slot = 0; slot < channel -> incomingReliableCapacity; ++ slot)
+    {
+       if (channel -> incomingReliableCommands [slot] != NULL)
+         enet_peer_destroy_incoming_command (host, channel -> incomingReliableCommands [slot]);
+    }
+
+    enet_free (channel -> incomingReliableCommands);
+
+    channel -> incomingReliableCommands = NULL;
+    channel -> incomingReliableCapacity = 0;
+    channel -> incomingReliableCount = 0;
+}
+
+/* Every queued reliable command lies less than incomingReliableCapacity sequence numbers past
+   incomingReliableSequenceNumber, so each has a slot of its own and a full slot is a duplicate.
+   Growing keeps that true for a command distance past the next expected one, and distance stays
+   below ENET_PEER_RELIABLE_WINDOW_SIZE, so the ring never outgrows one reliable window. */
+static int
+enet_peer_grow_incoming_reliable_commands (ENetChannel * channel, enet_uint16 distance)
+{
+    ENetIncomingCommand ** incomingReliableCommands;
+    size_t capacity = channel -> incomingReliableCapacity > 0 ? channel -> incomingReliableCapacity : ENET_PEER_RELIABLE_RING_MINIMUM;
+    enet_uint16 slot;
+
+    while (capacity <= distance)
+      capacity *= 2;
+
+    incomingReliableCommands = (ENetIncomingCommand **) enet_malloc (capacity * sizeof (ENetIncomingCommand *));
+    if (incomingReliableCommands == NULL)
+      return -1;
+
+    memset (incomingReliableCommands, 0, capacity * sizeof (ENetIncomingCommand *));
+
+    if (channel -> incomingReliableCommands != NULL)
+    {
+       for (slot = 0; slot < channel -> incomingReliableCapacity; ++ slot)
        {
-          -- incomingCommand -> packet -> referenceCount;
+          ENetIncomingCommand * incomingCommand = channel -> incomingReliableCommands [slot];
 
-          if (incomingCommand -> packet -> referenceCount == 0)
-            enet_packet_destroy (incomingCommand -> packet);
+          if (incomingCommand != NULL)
+            incomingReliableCommands [incomingCommand -> reliableSequenceNumber & (capacity - 1)] = incomingCommand;
        }
 
-       if (incomingCommand -> fragments != NULL)
-         enet_free (incomingCommand -> fragments);
-
-       enet_free (incomingCommand);
+       enet_free (channel -> incomingReliableCommands);
     }
+
+    channel -> incomingReliableCommands = incomingReliableCommands;
+    channel -> incomingReliableCapacity = capacity;
+
+    return 0;
+}
+
+/** Returns the reliable command queued on channel for reliableSequenceNumber, or NULL if none is. */
+ENetIncomingCommand *
+enet_peer_find_incoming_reliable_command (ENetChannel * channel, enet_uint16 reliableSequenceNumber)
+{
+    ENetIncomingCommand * incomingCommand;
+
+    if (channel -> incomingReliableCount == 0)
+      return NULL;
+
+    incomingCommand = channel -> incomingReliableCommands [reliableSequenceNumber & (channel -> incomingReliableCapacity - 1)];
+    if (incomingCommand == NULL || incomingCommand -> reliableSequenceNumber != reliableSequenceNumber)
+      return NULL;
+
+    return incomingCommand;
+}
+
+/** Returns whether reliableSequenceNumber is ahead of the next expected reliable command on channel
+    by more than its ring holds. Such commands are dropped without an acknowledgement, so the sender
+    retransmits them once the ring has caught up. */
+int
+enet_peer_beyond_incoming_reliable_commands (const ENetChannel * channel, enet_uint16 reliableSequenceNumber)
+{
+    enet_uint16 reliableDistance = (enet_uint16) (reliableSequenceNumber - channel -> incomingReliableSequenceNumber - 1);
+
+    return reliableDistance >= ENET_PEER_RELIABLE_WINDOW_SIZE &&
+           reliableDistance < (ENET_PEER_FREE_RELIABLE_WINDOWS - 1) * ENET_PEER_RELIABLE_WINDOW_SIZE;
 }
 
 static void
-enet_peer_reset_incoming_commands (ENetList * queue)
+enet_peer_reset_incoming_commands (ENetHost * host, ENetList * queue)
 {
-    enet_peer_remove_incoming_commands(queue, enet_list_begin (queue), enet_list_end (queue), NULL);
+    enet_peer_remove_incoming_commands (host, queue, enet_list_begin (queue), enet_list_end (queue), NULL);
 }
  
 void
@@ -324,13 +431,22 @@ enet_peer_reset_queues (ENetPeer * peer)
        peer -> flags &= ~ ENET_PEER_FLAG_NEEDS_DISPATCH;
     }
 
+    if (peer -> flags & ENET_PEER_FLAG_NEEDS_SEND)
+    {
+       enet_list_remove (& peer -> sendList);
+
+       peer -> flags &= ~ ENET_PEER_FLAG_NEEDS_SEND;
+    }
+
+    enet_timer_wheel_cancel (& peer -> host -> timers, & peer -> timer);
+
     while (! enet_list_empty (& peer -> acknowledgements))
-      enet_free (enet_list_remove (enet_list_begin (& peer -> acknowledgements)));
+      enet_pool_free (& peer -> host -> acknowledgementPool, enet_list_remove (enet_list_begin (& peer -> acknowledgements)));
 
-    enet_peer_reset_outgoing_commands (& peer -> sentReliableCommands);
-    enet_peer_reset_outgoing_commands (& peer -> sentUnreliableCommands);
-    enet_peer_reset_outgoing_commands (& peer -> outgoingCommands);
-    enet_peer_reset_incoming_commands (& peer -> dispatchedCommands);
+    enet_peer_reset_outgoing_commands (peer -> host, & peer -> sentReliableCommands);
+    enet_peer_reset_outgoing_commands (peer -> host, & peer -> sentUnreliableCommands);
+    enet_peer_reset_outgoing_commands (peer -> host, & peer -> outgoingCommands);
+    enet_peer_reset_incoming_commands (peer -> host, & peer -> dispatchedCommands);
 
     if (peer -> channels != NULL && peer -> channelCount > 0)
     {
@@ -338,8 +454,8 @@ enet_peer_reset_queues (ENetPeer * peer)
              channel < & peer -> channels [peer -> channelCount];
              ++ channel)
         {
-            enet_peer_reset_incoming_commands (& channel -> incomingReliableCommands);
-            enet_peer_reset_incoming_commands (& channel -> incomingUnreliableCommands);
+            enet_peer_reset_incoming_reliable_commands (peer -> host, channel);
+            enet_peer_reset_incoming_commands (peer -> host, & channel -> incomingUnreliableCommands);
         }
 
         enet_free (peer -> channels);
@@ -358,9 +474,21 @@ enet_peer_on_connect (ENetPeer * peer)
           ++ peer -> host -> bandwidthLimitedPeers;
 
         ++ peer -> host -> connectedPeers;
+
+        enet_peer_reset_congestion (peer);
     }
 }
 
+/** Starts the peer's congestion state afresh under the host's congestion controller. */
+void
+enet_peer_reset_congestion (ENetPeer * peer)
+{
+    memset (& peer -> congestion, 0, sizeof (peer -> congestion));
+
+    if (peer -> host -> congestionControl.reset != NULL)
+      peer -> host -> congestionControl.reset (peer);
+}
+
 void
 enet_peer_on_disconnect (ENetPeer * peer)
 {
@@ -382,6 +510,11 @@ void
 enet_peer_reset (ENetPeer * peer)
 {
     enet_peer_on_disconnect (peer);
+
+    enet_host_unindex_peer (peer -> host, peer);
+
+    if (peer -> state != ENET_PEER_STATE_DISCONNECTED)
+      enet_host_push_free_peer (peer -> host, peer);
         
     peer -> outgoingPeerID = ENET_PROTOCOL_MAXIMUM_PEER_ID;
     peer -> connectID = 0;
@@ -420,19 +553,36 @@ enet_peer_reset (ENetPeer * peer)
     peer -> highestRoundTripTimeVariance = 0;
     peer -> roundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME;
     peer -> roundTripTimeVariance = 0;
+    peer -> roundTripTimeMicroseconds = ENET_PEER_DEFAULT_ROUND_TRIP_TIME * 1000;
+    peer -> roundTripTimeVarianceMicroseconds = 0;
     peer -> mtu = peer -> host -> mtu;
     peer -> reliableDataInTransit = 0;
     peer -> outgoingReliableSequenceNumber = 0;
     peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    peer -> maximumWindowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
     peer -> incomingUnsequencedGroup = 0;
     peer -> outgoingUnsequencedGroup = 0;
     peer -> eventData = 0;
     peer -> totalWaitingData = 0;
-    peer -> flags = 0;
+    peer -> compressionRatio = ENET_PEER_COMPRESSION_RATIO_SCALE / 2;
+    peer -> compressionFailures = 0;
+    peer -> compressionBackoff = ENET_PEER_COMPRESSION_BACKOFF_MINIMUM;
+    peer -> compressionBypass = 0;
+    peer -> capabilities = 0;
+    peer -> mtuProbeSize = 0;
+    peer -> mtuProbeLimit = 0;
+    peer -> mtuProbeTime = 0;
+    peer -> mtuProbeSequenceNumber = 0;
+    peer -> mtuProbeAttempts = 0;
+
+    memset (& peer -> congestion, 0, sizeof (peer -> congestion));
 
     memset (peer -> unsequencedWindow, 0, sizeof (peer -> unsequencedWindow));
     
+    /* The queue flags say which host queues still link the peer, so they go last. */
     enet_peer_reset_queues (peer);
+
+    peer -> flags = 0;
 }
 
 /** Sends a ping request to a peer.
@@ -469,6 +619,9 @@ void
 enet_peer_ping_interval (ENetPeer * peer, enet_uint32 pingInterval)
 {
     peer -> pingInterval = pingInterval ? pingInterval : ENET_PEER_PING_INTERVAL;
+
+    if (! (peer -> flags & ENET_PEER_FLAG_NEEDS_SEND))
+      enet_peer_schedule_timer (peer);
 }
 
 /** Sets the timeout parameters for a peer.
@@ -607,9 +760,25 @@ enet_peer_queue_acknowledgement (ENetPeer * peer, const ENetProtocol * command,
 
         if (reliableWindow >= currentWindow + ENET_PEER_FREE_RELIABLE_WINDOWS - 1 && reliableWindow <= currentWindow + ENET_PEER_FREE_RELIABLE_WINDOWS)
           return NULL;
+
+        switch (command -> header.command & ENET_PROTOCOL_COMMAND_MASK)
+        {
+        case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
+           if (enet_peer_beyond_incoming_reliable_commands (channel, command -> header.reliableSequenceNumber))
+             return NULL;
+           break;
+
+        case ENET_PROTOCOL_COMMAND_SEND_FRAGMENT:
+           if (enet_peer_beyond_incoming_reliable_commands (channel, ENET_NET_TO_HOST_16 (command -> sendFragment.startSequenceNumber)))
+             return NULL;
+           break;
+
+        default:
+           break;
+        }
     }
 
-    acknowledgement = (ENetAcknowledgement *) enet_malloc (sizeof (ENetAcknowledgement));
+    acknowledgement = (ENetAcknowledgement *) enet_pool_allocate (& peer -> host -> acknowledgementPool);
     if (acknowledgement == NULL)
       return NULL;
 
@@ -619,6 +788,8 @@ enet_peer_queue_acknowledgement (ENetPeer * peer, const ENetProtocol * command,
     acknowledgement -> command = * command;
     
     enet_list_insert (enet_list_end (& peer -> acknowledgements), acknowledgement);
+
+    enet_peer_schedule_send (peer);
     
     return acknowledgement;
 }
@@ -667,6 +838,7 @@ enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoin
 
     outgoingCommand -> sendAttempts = 0;
     outgoingCommand -> sentTime = 0;
+    outgoingCommand -> sentTimeMicroseconds = 0;
     outgoingCommand -> roundTripTimeout = 0;
     outgoingCommand -> roundTripTimeoutLimit = 0;
     outgoingCommand -> command.header.reliableSequenceNumber = ENET_HOST_TO_NET_16 (outgoingCommand -> reliableSequenceNumber);
@@ -686,12 +858,56 @@ enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoin
     }
 
     enet_list_insert (enet_list_end (& peer -> outgoingCommands), outgoingCommand);
+
+    enet_peer_schedule_send (peer);
+}
+
+/** Queues the peer for the host's next send pass, if it is not queued already.
+*/
+void
+enet_peer_schedule_send (ENetPeer * peer)
+{
+    if (peer -> flags & ENET_PEER_FLAG_NEEDS_SEND)
+      return;
+
+    enet_list_insert (enet_list_end (& peer -> host -> sendQueue), & peer -> sendList);
+
+    peer -> flags |= ENET_PEER_FLAG_NEEDS_SEND;
+}
+
+/** Arms the peer's timer for its next retransmit timeout or, with nothing awaiting
+    acknowledgement, its next ping, or sooner if the pacer is holding back data.
+    An expired timer queues the peer for a send pass.
+*/
+void
+enet_peer_schedule_timer (ENetPeer * peer)
+{
+    enet_uint32 deadline;
+
+    if (peer -> state == ENET_PEER_STATE_DISCONNECTED ||
+        peer -> state == ENET_PEER_STATE_ZOMBIE)
+    {
+        enet_timer_wheel_cancel (& peer -> host -> timers, & peer -> timer);
+
+        return;
+    }
+
+    if (! enet_list_empty (& peer -> sentReliableCommands))
+      deadline = peer -> nextTimeout;
+    else
+      deadline = peer -> lastReceiveTime + peer -> pingInterval;
+
+    if (peer -> flags & ENET_PEER_FLAG_PACED &&
+        ENET_TIME_LESS (peer -> congestion.pacingDeadline, deadline))
+      deadline = peer -> congestion.pacingDeadline;
+
+    enet_timer_wheel_schedule (& peer -> host -> timers, & peer -> timer, deadline);
 }
 
 ENetOutgoingCommand *
 enet_peer_queue_outgoing_command (ENetPeer * peer, const ENetProtocol * command, ENetPacket * packet, enet_uint32 offset, enet_uint16 length)
 {
-    ENetOutgoingCommand * outgoingCommand = (ENetOutgoingCommand *) enet_malloc (sizeof (ENetOutgoingCommand));
+    ENetOutgoingCommand * outgoingCommand = (ENetOutgoingCommand *) enet_pool_allocate (& peer -> host -> outgoingCommandPool);
     if (outgoingCommand == NULL)
       return NULL;
 
@@ -787,37 +1003,81 @@ enet_peer_dispatch_incoming_unreliable_commands (ENetPeer * peer, ENetChannel *
        droppedCommand = currentCommand;
     }
 
-    enet_peer_remove_incoming_commands (& channel -> incomingUnreliableCommands, enet_list_begin (& channel -> incomingUnreliableCommands), droppedCommand, queuedCommand);
+    if (channel -> incomingUnreliableFragment != NULL &&
+        channel -> incomingUnreliableFragment != queuedCommand)
+    {
+       for (currentCommand = enet_list_begin (& channel -> incomingUnreliableCommands);
+            currentCommand != droppedCommand;
+            currentCommand = enet_list_next (currentCommand))
+       {
+          if ((ENetIncomingCommand *) currentCommand == channel -> incomingUnreliableFragment)
+          {
+             channel -> incomingUnreliableFragment = NULL;
+
+             break;
+          }
+       }
+    }
+
+    enet_peer_remove_incoming_commands (peer -> host, & channel -> incomingUnreliableCommands, enet_list_begin (& channel -> incomingUnreliableCommands), droppedCommand, queuedCommand);
 }
 
 void
 enet_peer_dispatch_incoming_reliable_commands (ENetPeer * peer, ENetChannel * channel, ENetIncomingCommand * queuedCommand)
 {
-    ENetListIterator currentCommand;
+    ENetIncomingCommand * incomingCommand;
+    int dispatched = 0;
 
-    for (currentCommand = enet_list_begin (& channel -> incomingReliableCommands);
-         currentCommand != enet_list_end (& channel -> incomingReliableCommands);
-         currentCommand = enet_list_next (currentCommand))
+    while (channel -> incomingReliableCount > 0)
     {
-       ENetIncomingCommand * incomingCommand = (ENetIncomingCommand *) currentCommand;
-         
-       if (incomingCommand -> fragmentsRemaining > 0 ||
-           incomingCommand -> reliableSequenceNumber != (enet_uint16) (channel -> incomingReliableSequenceNumber + 1))
+       enet_uint16 reliableSequenceNumber = channel -> incomingReliableSequenceNumber + 1;
+       ENetIncomingCommand ** slot = & channel -> incomingReliableCommands [reliableSequenceNumber & (channel -> incomingReliableCapacity - 1)];
+
+       incomingCommand = * slot;
+       if (incomingCommand == NULL ||
+           incomingCommand -> fragmentsRemaining > 0 ||
+           incomingCommand -> reliableSequenceNumber != reliableSequenceNumber)
          break;
 
-       channel -> incomingReliableSequenceNumber = incomingCommand -> reliableSequenceNumber;
+       * slot = NULL;
+       -- channel -> incomingReliableCount;
+
+       channel -> incomingReliableSequenceNumber = reliableSequenceNumber;
 
        if (incomingCommand -> fragmentCount > 0)
-         channel -> incomingReliableSequenceNumber += incomingCommand -> fragmentCount - 1;
+       {
+          enet_uint32 fragmentNumber;
+
+          /* The fragments of a packet use up its sequence numbers, so nothing queued under them can ever be dispatched. */
+          for (fragmentNumber = 1;
+               fragmentNumber < incomingCommand -> fragmentCount && fragmentNumber < channel -> incomingReliableCapacity && channel -> incomingReliableCount > 0;
+               ++ fragmentNumber)
+          {
+             ENetIncomingCommand ** fragmentSlot = & channel -> incomingReliableCommands [(reliableSequenceNumber + fragmentNumber) & (channel -> incomingReliableCapacity - 1)];
+
+             if (* fragmentSlot != NULL &&
+                 (enet_uint16) ((* fragmentSlot) -> reliableSequenceNumber - reliableSequenceNumber) < incomingCommand -> fragmentCount)
+             {
+                enet_peer_destroy_incoming_command (peer -> host, * fragmentSlot);
+
+                * fragmentSlot = NULL;
+                -- channel -> incomingReliableCount;
+             }
+          }
+
+          channel -> incomingReliableSequenceNumber += incomingCommand -> fragmentCount - 1;
+       }
+
+       enet_list_insert (enet_list_end (& peer -> dispatchedCommands), incomingCommand);
+
+       dispatched = 1;
     } 
 
-    if (currentCommand == enet_list_begin (& channel -> incomingReliableCommands))
+    if (! dispatched)
       return;
 
     channel -> incomingUnreliableSequenceNumber = 0;
 
-    enet_list_move (enet_list_end (& peer -> dispatchedCommands), enet_list_begin (& channel -> incomingReliableCommands), enet_list_previous (currentCommand));
-
     if (! (peer -> flags & ENET_PEER_FLAG_NEEDS_DISPATCH))
     {
        enet_list_insert (enet_list_end (& peer -> host -> dispatchQueue), & peer -> dispatchList);
@@ -836,9 +1096,9 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
 
     ENetChannel * channel = & peer -> channels [command -> header.channelID];
     enet_uint32 unreliableSequenceNumber = 0, reliableSequenceNumber = 0;
-    enet_uint16 reliableWindow, currentWindow;
+    enet_uint16 reliableWindow, currentWindow, reliableDistance;
     ENetIncomingCommand * incomingCommand;
-    ENetListIterator currentCommand;
+    ENetListIterator currentCommand = NULL;
     ENetPacket * packet = NULL;
 
     if (peer -> state == ENET_PEER_STATE_DISCONNECT_LATER)
@@ -863,30 +1123,17 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
        if (reliableSequenceNumber == channel -> incomingReliableSequenceNumber)
          goto discardCommand;
-       
-       for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingReliableCommands));
-            currentCommand != enet_list_end (& channel -> incomingReliableCommands);
-            currentCommand = enet_list_previous (currentCommand))
-       {
-          incomingCommand = (ENetIncomingCommand *) currentCommand;
 
-          if (reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-          {
-             if (incomingCommand -> reliableSequenceNumber < channel -> incomingReliableSequenceNumber)
-               continue;
-          }
-          else
-          if (incomingCommand -> reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-            break;
+       reliableDistance = (enet_uint16) (reliableSequenceNumber - channel -> incomingReliableSequenceNumber - 1);
+       if (reliableDistance >= ENET_PEER_RELIABLE_WINDOW_SIZE)
+         goto discardCommand;
 
-          if (incomingCommand -> reliableSequenceNumber <= reliableSequenceNumber)
-          {
-             if (incomingCommand -> reliableSequenceNumber < reliableSequenceNumber)
-               break;
+       if (reliableDistance >= channel -> incomingReliableCapacity &&
+           enet_peer_grow_incoming_reliable_commands (channel, reliableDistance) < 0)
+         goto notifyError;
 
-             goto discardCommand;
-          }
-       }
+       if (channel -> incomingReliableCommands [reliableSequenceNumber & (channel -> incomingReliableCapacity - 1)] != NULL)
+         goto discardCommand;
        break;
 
     case ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE:
@@ -946,7 +1193,7 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     if (packet == NULL)
       goto notifyError;
 
-    incomingCommand = (ENetIncomingCommand *) enet_malloc (sizeof (ENetIncomingCommand));
+    incomingCommand = (ENetIncomingCommand *) enet_pool_allocate (& peer -> host -> incomingCommandPool);
     if (incomingCommand == NULL)
       goto notifyError;
 
@@ -964,7 +1211,7 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
          incomingCommand -> fragments = (enet_uint32 *) enet_malloc ((fragmentCount + 31) / 32 * sizeof (enet_uint32));
        if (incomingCommand -> fragments == NULL)
        {
-          enet_free (incomingCommand);
+          enet_pool_free (& peer -> host -> incomingCommandPool, incomingCommand);
 
           goto notifyError;
        }
@@ -978,16 +1225,19 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
        peer -> totalWaitingData += packet -> dataLength;
     }
 
-    enet_list_insert (enet_list_next (currentCommand), incomingCommand);
-
     switch (command -> header.command & ENET_PROTOCOL_COMMAND_MASK)
     {
     case ENET_PROTOCOL_COMMAND_SEND_FRAGMENT:
     case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
+       channel -> incomingReliableCommands [reliableSequenceNumber & (channel -> incomingReliableCapacity - 1)] = incomingCommand;
+       ++ channel -> incomingReliableCount;
+
        enet_peer_dispatch_incoming_reliable_commands (peer, channel, incomingCommand);
        break;
 
     default:
+       enet_list_insert (enet_list_next (currentCommand), incomingCommand);
+
        enet_peer_dispatch_incoming_unreliable_commands (peer, channel, incomingCommand);
        break;
     }
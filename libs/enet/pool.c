@@ -0,0 +1,126 @@
+/**
+ @file pool.c
+ @brief ENet fixed size object pools
+*/
+#define ENET_BUILDING_LIB 1
+#include "enet/utility.h"
+#include "enet/enet.h"
+
+/**
+    @defgroup pool ENet object pool functions
+    @ingroup private
+    @{
+*/
+
+/* Slabs are chained through their first word and free objects through theirs, so objects are
+   padded to pointer alignment and start one pointer into their slab. */
+#define ENET_POOL_ALIGN(size) (((size) + sizeof (void *) - 1) & ~ (sizeof (void *) - 1))
+
+void
+enet_pool_initialize (ENetPool * pool, size_t objectSize)
+{
+    pool -> objectSize = ENET_POOL_ALIGN (ENET_MAX (objectSize, sizeof (void *)));
+    pool -> freeObjects = NULL;
+    pool -> slabs = NULL;
+    pool -> objectCount = 0;
+    pool -> usedCount = 0;
+    pool -> peakUsedCount = 0;
+    pool -> maximumObjects = 0;
+}
+
+void
+enet_pool_destroy (ENetPool * pool)
+{
+    while (pool -> slabs != NULL)
+    {
+        void * slab = pool -> slabs;
+
+        pool -> slabs = * (void **) slab;
+
+        enet_free (slab);
+    }
+
+    pool -> freeObjects = NULL;
+    pool -> objectCount = 0;
+    pool -> usedCount = 0;
+}
+
+static int
+enet_pool_grow (ENetPool * pool)
+{
+    size_t objectCount = ENET_POOL_SLAB_OBJECTS, objectIndex;
+    enet_uint8 * slab;
+
+    if (pool -> maximumObjects > 0)
+    {
+        if (pool -> objectCount >= pool -> maximumObjects)
+          return -1;
+
+        objectCount = ENET_MIN (objectCount, pool -> maximumObjects - pool -> objectCount);
+    }
+
+    slab = (enet_uint8 *) enet_malloc (sizeof (void *) + objectCount * pool -> objectSize);
+    if (slab == NULL)
+      return -1;
+
+    * (void **) slab = pool -> slabs;
+    pool -> slabs = slab;
+
+    for (objectIndex = objectCount; objectIndex > 0; -- objectIndex)
+    {
+        void * object = slab + sizeof (void *) + (objectIndex - 1) * pool -> objectSize;
+
+        * (void **) object = pool -> freeObjects;
+        pool -> freeObjects = object;
+    }
+
+    pool -> objectCount += objectCount;
+
+    return 0;
+}
+
+/** Makes sure the next objectCount allocations from the pool succeed.
+    @returns 0 on success, < 0 if the heap or the pool's limit is exhausted first
+*/
+int
+enet_pool_reserve (ENetPool * pool, size_t objectCount)
+{
+    while (pool -> objectCount - pool -> usedCount < objectCount)
+    {
+        if (enet_pool_grow (pool) < 0)
+          return -1;
+    }
+
+    return 0;
+}
+
+/** Returns an uninitialized object, or NULL if the heap or the pool's limit is exhausted. */
+void *
+enet_pool_allocate (ENetPool * pool)
+{
+    void * object;
+
+    if (pool -> freeObjects == NULL && enet_pool_grow (pool) < 0)
+      return NULL;
+
+    object = pool -> freeObjects;
+    pool -> freeObjects = * (void **) object;
+
+    ++ pool -> usedCount;
+    if (pool -> usedCount > pool -> peakUsedCount)
+      pool -> peakUsedCount = pool -> usedCount;
+
+    return object;
+}
+
+void
+enet_pool_free (ENetPool * pool, void * object)
+{
+    * (void **) object = pool -> freeObjects;
+    pool -> freeObjects = object;
+
+    -- pool -> usedCount;
+}
+
+/** @} */
+
@@ -0,0 +1,37 @@
+/**
+ @file  pool.h
+ @brief ENet fixed size object pools
+*/
+#ifndef __ENET_POOL_H__
+#define __ENET_POOL_H__
+
+#include <stddef.h>
+
+enum
+{
+   ENET_POOL_SLAB_OBJECTS = 64
+};
+
+/** Objects of one size carved out of slabs of ENET_POOL_SLAB_OBJECTS and recycled through a free
+    list, so a host that has reached its working set allocates nothing more. Slabs are only returned
+    to the heap when the pool is destroyed.
+*/
+typedef struct _ENetPool
+{
+   size_t objectSize;
+   void * freeObjects;
+   void * slabs;
+   size_t objectCount;                  /**< objects carved out of slabs so far */
+   size_t usedCount;                    /**< objects currently allocated */
+   size_t peakUsedCount;                /**< most objects ever allocated at once */
+   size_t maximumObjects;               /**< objects the pool may carve out before allocations fail, 0 for no limit */
+} ENetPool;
+
+extern void   enet_pool_initialize (ENetPool *, size_t);
+extern void   enet_pool_destroy (ENetPool *);
+extern int    enet_pool_reserve (ENetPool *, size_t);
+extern void * enet_pool_allocate (ENetPool *);
+extern void   enet_pool_free (ENetPool *, void *);
+
+#endif /* __ENET_POOL_H__ */
+
@@ -23,9 +23,16 @@ static size_t commandSizes [ENET_PROTOCOL_COMMAND_COUNT] =
     sizeof (ENetProtocolSendUnsequenced),
     sizeof (ENetProtocolBandwidthLimit),
     sizeof (ENetProtocolThrottleConfigure),
-    sizeof (ENetProtocolSendFragment)
+    sizeof (ENetProtocolSendFragment),
+    sizeof (ENetProtocolConnectCookie),
+    sizeof (ENetProtocolCapabilities),
+    sizeof (ENetProtocolSelectiveAcknowledge)
 };
 
+/* What path MTU probes are padded out with. The zero byte reads as ENET_PROTOCOL_COMMAND_NONE,
+   which stops every host, whatever its version, from reading further commands. */
+static const enet_uint8 probePadding [ENET_PROTOCOL_MAXIMUM_MTU];
+
 size_t
 enet_protocol_command_size (enet_uint8 commandNumber)
 {
@@ -41,6 +48,10 @@ enet_protocol_change_state (ENetHost * host, ENetPeer * peer, ENetPeerState stat
       enet_peer_on_disconnect (peer);
 
     peer -> state = state;
+
+    /* Peers join the lookup tables once past connecting; enet_peer_reset() takes them out. */
+    if (state != ENET_PEER_STATE_CONNECTING)
+      enet_host_index_peer (host, peer);
 }
 
 static void
@@ -184,7 +195,7 @@ enet_protocol_remove_sent_unreliable_commands (ENetPeer * peer)
            }
         }
 
-        enet_free (outgoingCommand);
+        enet_pool_free (& peer -> host -> outgoingCommandPool, outgoingCommand);
     } while (! enet_list_empty (& peer -> sentUnreliableCommands));
 
     if (peer -> state == ENET_PEER_STATE_DISCONNECT_LATER &&
@@ -193,8 +204,174 @@ enet_protocol_remove_sent_unreliable_commands (ENetPeer * peer)
       enet_peer_disconnect (peer, peer -> eventData);
 }
 
+/* Retransmit timeouts are kept in microseconds but the timer wheel counts milliseconds; the extra
+   millisecond covers whatever part of sentTime's millisecond had already gone by. */
+static enet_uint32
+enet_protocol_retransmit_time (const ENetOutgoingCommand * outgoingCommand)
+{
+    return outgoingCommand -> sentTime + (outgoingCommand -> roundTripTimeout + 999) / 1000 + 1;
+}
+
+static int
+enet_protocol_is_mtu_probe (const ENetPeer * peer, const ENetOutgoingCommand * outgoingCommand)
+{
+    return peer -> mtuProbeSize != 0 &&
+           outgoingCommand -> command.header.channelID == 0xFF &&
+           outgoingCommand -> reliableSequenceNumber == peer -> mtuProbeSequenceNumber &&
+           (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_PING;
+}
+
+/** Queues a ping to be padded out to the next size tried for the peer's path MTU, unless a probe
+    is still in flight. The largest size goes first; after that the search halves the range
+    between the MTU in use, which the path carries, and mtuProbeLimit, which it does not.
+*/
+static void
+enet_protocol_probe_mtu (ENetHost * host, ENetPeer * peer)
+{
+    ENetOutgoingCommand * outgoingCommand;
+    ENetProtocol command;
+    enet_uint32 maximumMtu = host -> probeMtu,
+                probeSize;
+
+    if (peer -> mtuProbeSize != 0)
+      return;
+
+    if (! (peer -> capabilities & ENET_PROTOCOL_CAPABILITY_JUMBO_FRAMES))
+      maximumMtu = ENET_MIN (maximumMtu, ENET_PROTOCOL_STANDARD_MAXIMUM_MTU);
+
+    if (peer -> mtuProbeLimit == 0)
+    {
+        peer -> mtuProbeLimit = maximumMtu + 1;
+        peer -> mtuProbeTime = host -> serviceTime;
+    }
+
+    if (ENET_TIME_LESS (host -> serviceTime, peer -> mtuProbeTime))
+      return;
+
+    if (peer -> mtuProbeLimit <= peer -> mtu + ENET_PEER_MTU_PROBE_GRANULARITY)
+    {
+        /* The search is done, though the path may come to carry more later on. */
+        peer -> mtuProbeLimit = maximumMtu + 1;
+        peer -> mtuProbeTime = host -> serviceTime + ENET_PEER_MTU_RAISE_INTERVAL;
+
+        return;
+    }
+
+    probeSize = peer -> mtuProbeLimit > maximumMtu ? maximumMtu : (peer -> mtu + peer -> mtuProbeLimit) / 2;
+
+    command.header.command = ENET_PROTOCOL_COMMAND_PING | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+    command.header.channelID = 0xFF;
+
+    outgoingCommand = enet_peer_queue_outgoing_command (peer, & command, NULL, 0, 0);
+    if (outgoingCommand == NULL)
+      return;
+
+    peer -> mtuProbeSize = probeSize;
+    peer -> mtuProbeSequenceNumber = outgoingCommand -> reliableSequenceNumber;
+}
+
+/* The path carried the probe whole, so the MTU goes up to its size and the search goes on. */
+static void
+enet_protocol_confirm_mtu_probe (ENetPeer * peer)
+{
+    if (peer -> mtuProbeSize > peer -> mtu)
+      peer -> mtu = peer -> mtuProbeSize;
+
+    peer -> mtuProbeSize = 0;
+    peer -> mtuProbeAttempts = 0;
+    peer -> mtuProbeTime = peer -> host -> serviceTime;
+
+    enet_peer_schedule_send (peer);
+}
+
+static void
+enet_protocol_lose_mtu_probe (ENetPeer * peer)
+{
+    if (++ peer -> mtuProbeAttempts >= ENET_PEER_MTU_PROBE_ATTEMPTS)
+    {
+        peer -> mtuProbeLimit = peer -> mtuProbeSize;
+        peer -> mtuProbeAttempts = 0;
+    }
+
+    peer -> mtuProbeSize = 0;
+    peer -> mtuProbeTime = peer -> host -> serviceTime;
+}
+
+/* Frees an acknowledged command, taking it off whichever list it is on. */
+static void
+enet_protocol_retire_reliable_command (ENetPeer * peer, ENetOutgoingCommand * outgoingCommand, int wasSent)
+{
+    enet_uint8 channelID = outgoingCommand -> command.header.channelID;
+
+    if (enet_protocol_is_mtu_probe (peer, outgoingCommand))
+      enet_protocol_confirm_mtu_probe (peer);
+
+    if (channelID < peer -> channelCount)
+    {
+       ENetChannel * channel = & peer -> channels [channelID];
+       enet_uint16 reliableWindow = outgoingCommand -> reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
+       if (channel -> reliableWindows [reliableWindow] > 0)
+       {
+          -- channel -> reliableWindows [reliableWindow];
+          if (! channel -> reliableWindows [reliableWindow])
+            channel -> usedReliableWindows &= ~ (1 << reliableWindow);
+       }
+    }
+
+    enet_list_remove (& outgoingCommand -> outgoingCommandList);
+
+    if (outgoingCommand -> packet != NULL)
+    {
+       if (wasSent)
+         peer -> reliableDataInTransit -= outgoingCommand -> fragmentLength;
+
+       -- outgoingCommand -> packet -> referenceCount;
+
+       if (outgoingCommand -> packet -> referenceCount == 0)
+       {
+          outgoingCommand -> packet -> flags |= ENET_PACKET_FLAG_SENT;
+
+          enet_packet_destroy (outgoingCommand -> packet);
+       }
+    }
+
+    enet_pool_free (& peer -> host -> outgoingCommandPool, outgoingCommand);
+}
+
+/* Moves the retransmit timeout up to the oldest command still waiting for an acknowledgement. */
+static void
+enet_protocol_update_next_timeout (ENetPeer * peer)
+{
+    ENetOutgoingCommand * outgoingCommand;
+
+    if (enet_list_empty (& peer -> sentReliableCommands))
+      return;
+    
+    outgoingCommand = (ENetOutgoingCommand *) enet_list_front (& peer -> sentReliableCommands);
+    
+    peer -> nextTimeout = enet_protocol_retransmit_time (outgoingCommand);
+
+    /* The next timeout can come sooner than the one the timer was armed for. */
+    if (! (peer -> flags & ENET_PEER_FLAG_NEEDS_SEND))
+      enet_peer_schedule_timer (peer);
+}
+
+/* Stores the round trip of an acknowledged transmission in roundTripTime, if the echoed sent time
+   says the acknowledgement is for the command's latest transmission. */
+static void
+enet_protocol_sample_round_trip_time (ENetPeer * peer, const ENetOutgoingCommand * outgoingCommand, enet_uint32 receivedSentTime, enet_uint32 * roundTripTime)
+{
+    if (roundTripTime != NULL &&
+        ((outgoingCommand -> sentTime ^ receivedSentTime) & 0xFFFF) == 0)
+      * roundTripTime = ENET_MAX (peer -> host -> serviceTimeMicroseconds - outgoingCommand -> sentTimeMicroseconds, 1);
+}
+
+/** Removes the acknowledged command. If it was sent and the acknowledgement is for its latest
+    transmission, as told by the echoed receivedSentTime, its round trip time in microseconds is
+    stored in roundTripTime.
+*/
 static ENetProtocolCommand
-enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliableSequenceNumber, enet_uint8 channelID)
+enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliableSequenceNumber, enet_uint8 channelID, enet_uint32 receivedSentTime, enet_uint32 * roundTripTime)
 {
     ENetOutgoingCommand * outgoingCommand = NULL;
     ENetListIterator currentCommand;
@@ -239,57 +416,241 @@ enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliabl
     if (outgoingCommand == NULL)
       return ENET_PROTOCOL_COMMAND_NONE;
 
-    if (channelID < peer -> channelCount)
+    commandNumber = (ENetProtocolCommand) (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK);
+
+    if (wasSent)
+      enet_protocol_sample_round_trip_time (peer, outgoingCommand, receivedSentTime, roundTripTime);
+    
+    enet_protocol_retire_reliable_command (peer, outgoingCommand, wasSent);
+
+    enet_protocol_update_next_timeout (peer);
+
+    return commandNumber;
+} 
+
+static int
+enet_protocol_selectively_acknowledged (const ENetOutgoingCommand * outgoingCommand, enet_uint8 channelID, enet_uint16 reliableSequenceNumber, enet_uint32 reliableSequenceMask)
+{
+    enet_uint16 offset = (enet_uint16) (outgoingCommand -> reliableSequenceNumber - reliableSequenceNumber);
+
+    if (outgoingCommand -> command.header.channelID != channelID)
+      return 0;
+
+    return offset == 0 || (offset <= 32 && (reliableSequenceMask & (1u << (offset - 1))));
+}
+
+/** Removes every command a selective acknowledgement covers in a single walk over
+    sentReliableCommands, then over the commands at the front of outgoingCommands that are
+    queued for retransmission. roundTripTime is sampled from the most recently sent of them.
+*/
+static void
+enet_protocol_remove_sent_reliable_commands (ENetPeer * peer, enet_uint8 channelID, enet_uint16 reliableSequenceNumber, enet_uint32 reliableSequenceMask, enet_uint32 receivedSentTime, enet_uint32 * roundTripTime)
+{
+    ENetOutgoingCommand * outgoingCommand;
+    ENetListIterator currentCommand;
+    enet_uint32 remaining = 1, mask;
+
+    for (mask = reliableSequenceMask; mask != 0; mask &= mask - 1)
+      ++ remaining;
+
+    currentCommand = enet_list_begin (& peer -> sentReliableCommands);
+
+    while (remaining > 0 && currentCommand != enet_list_end (& peer -> sentReliableCommands))
     {
-       ENetChannel * channel = & peer -> channels [channelID];
-       enet_uint16 reliableWindow = reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
-       if (channel -> reliableWindows [reliableWindow] > 0)
-       {
-          -- channel -> reliableWindows [reliableWindow];
-          if (! channel -> reliableWindows [reliableWindow])
-            channel -> usedReliableWindows &= ~ (1 << reliableWindow);
-       }
+       outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+
+       currentCommand = enet_list_next (currentCommand);
+
+       if (! enet_protocol_selectively_acknowledged (outgoingCommand, channelID, reliableSequenceNumber, reliableSequenceMask))
+         continue;
+
+       enet_protocol_sample_round_trip_time (peer, outgoingCommand, receivedSentTime, roundTripTime);
+
+       enet_protocol_retire_reliable_command (peer, outgoingCommand, 1);
+
+       -- remaining;
     }
 
-    commandNumber = (ENetProtocolCommand) (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK);
-    
-    enet_list_remove (& outgoingCommand -> outgoingCommandList);
+    currentCommand = enet_list_begin (& peer -> outgoingCommands);
 
-    if (outgoingCommand -> packet != NULL)
+    while (remaining > 0 && currentCommand != enet_list_end (& peer -> outgoingCommands))
     {
-       if (wasSent)
-         peer -> reliableDataInTransit -= outgoingCommand -> fragmentLength;
+       outgoingCommand = (ENetOutgoingCommand *) currentCommand;
 
-       -- outgoingCommand -> packet -> referenceCount;
+       currentCommand = enet_list_next (currentCommand);
 
-       if (outgoingCommand -> packet -> referenceCount == 0)
-       {
-          outgoingCommand -> packet -> flags |= ENET_PACKET_FLAG_SENT;
+       if (! (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE))
+         continue;
 
-          enet_packet_destroy (outgoingCommand -> packet);
-       }
+       if (outgoingCommand -> sendAttempts < 1)
+         break;
+
+       if (! enet_protocol_selectively_acknowledged (outgoingCommand, channelID, reliableSequenceNumber, reliableSequenceMask))
+         continue;
+
+       enet_protocol_retire_reliable_command (peer, outgoingCommand, 0);
+
+       -- remaining;
     }
 
-    enet_free (outgoingCommand);
+    enet_protocol_update_next_timeout (peer);
+}
+
+/* One HalfSipHash round; cookies are keyed with the host's connectCookieKey so they cannot be forged
+   without it, and a 64 bit output keeps guessing them out of reach. */
+static void
+enet_protocol_cookie_round (enet_uint32 * v)
+{
+#define ENET_ROTATE_LEFT(x, b) (((x) << (b)) | ((x) >> (32 - (b))))
+    v [0] += v [1]; v [1] = ENET_ROTATE_LEFT (v [1], 5); v [1] ^= v [0]; v [0] = ENET_ROTATE_LEFT (v [0], 16);
+    v [2] += v [3]; v [3] = ENET_ROTATE_LEFT (v [3], 8); v [3] ^= v [2];
+    v [0] += v [3]; v [3] = ENET_ROTATE_LEFT (v [3], 7); v [3] ^= v [0];
+    v [2] += v [1]; v [1] = ENET_ROTATE_LEFT (v [1], 13); v [1] ^= v [2]; v [2] = ENET_ROTATE_LEFT (v [2], 16);
+#undef ENET_ROTATE_LEFT
+}
+
+static void
+enet_protocol_connect_cookie (ENetHost * host, const ENetAddress * address, enet_uint32 connectID, enet_uint32 epoch, enet_uint32 * cookie)
+{
+    enet_uint32 v [4], input [5];
+    int i;
+
+    input [0] = address -> host;
+    input [1] = address -> port;
+    input [2] = connectID;
+    input [3] = epoch;
+    input [4] = (enet_uint32) (4 * sizeof (enet_uint32)) << 24;
+
+    v [0] = host -> connectCookieKey [0];
+    v [1] = host -> connectCookieKey [1] ^ 0xEE;
+    v [2] = host -> connectCookieKey [0] ^ 0x6C796765;
+    v [3] = host -> connectCookieKey [1] ^ 0x74656462;
+
+    for (i = 0; i < 5; ++ i)
+    {
+        v [3] ^= input [i];
+        enet_protocol_cookie_round (v);
+        enet_protocol_cookie_round (v);
+        v [0] ^= input [i];
+    }
+
+    v [2] ^= 0xEE;
+    for (i = 0; i < 4; ++ i)
+      enet_protocol_cookie_round (v);
+    cookie [0] = v [1] ^ v [3];
+
+    v [1] ^= 0xDD;
+    for (i = 0; i < 4; ++ i)
+      enet_protocol_cookie_round (v);
+    cookie [1] = v [1] ^ v [3];
+}
+
+/* A cookie is accepted in the interval it was handed out in and the one after. */
+static int
+enet_protocol_check_connect_cookie (ENetHost * host, const ENetProtocol * command, const ENetProtocol * connectCookie)
+{
+    enet_uint32 epoch = host -> serviceTime / ENET_HOST_CONNECT_COOKIE_INTERVAL, cookie [2];
+    int i;
+
+    if (connectCookie == NULL ||
+        connectCookie -> connectCookie.connectID != command -> connect.connectID)
+      return 0;
+
+    for (i = 0; i < 2; ++ i)
+    {
+        enet_protocol_connect_cookie (host, & host -> receivedAddress, command -> connect.connectID, epoch - i, cookie);
+
+        if (cookie [0] == connectCookie -> connectCookie.cookie [0] &&
+            cookie [1] == connectCookie -> connectCookie.cookie [1])
+          return 1;
+    }
+
+    return 0;
+}
+
+/* Answers a connect straight from the socket, without setting up any peer state for it. */
+static void
+enet_protocol_send_connect_cookie (ENetHost * host, const ENetProtocol * command)
+{
+    enet_uint8 headerData [sizeof (ENetProtocolHeader) + sizeof (enet_uint32)];
+    ENetProtocolHeader * header = (ENetProtocolHeader *) headerData;
+    ENetProtocol cookieCommand;
+    ENetBuffer buffers [2];
+    enet_uint32 cookie [2];
+    enet_uint16 outgoingPeerID = ENET_NET_TO_HOST_16 (command -> connect.outgoingPeerID);
+    int sentLength;
+
+    if (outgoingPeerID >= ENET_PROTOCOL_MAXIMUM_PEER_ID)
+      return;
+
+    cookieCommand.header.command = ENET_PROTOCOL_COMMAND_CONNECT_COOKIE;
+    cookieCommand.header.channelID = 0xFF;
+    cookieCommand.header.reliableSequenceNumber = 0;
+    cookieCommand.connectCookie.connectID = command -> connect.connectID;
+    enet_protocol_connect_cookie (host, & host -> receivedAddress, command -> connect.connectID, host -> serviceTime / ENET_HOST_CONNECT_COOKIE_INTERVAL, cookie);
+    cookieCommand.connectCookie.cookie [0] = cookie [0];
+    cookieCommand.connectCookie.cookie [1] = cookie [1];
+
+    header -> peerID = ENET_HOST_TO_NET_16 (outgoingPeerID);
+
+    buffers [0].data = headerData;
+    buffers [0].dataLength = (size_t) & ((ENetProtocolHeader *) 0) -> sentTime;
+    buffers [1].data = & cookieCommand;
+    buffers [1].dataLength = sizeof (ENetProtocolConnectCookie);
+
+    if (host -> checksum != NULL)
+    {
+        enet_uint32 * checksum = (enet_uint32 *) & headerData [buffers [0].dataLength];
+        * checksum = command -> connect.connectID;
+        buffers [0].dataLength += sizeof (enet_uint32);
+        * checksum = host -> checksum (buffers, 2);
+    }
+
+    sentLength = enet_socket_send (host -> socket, & host -> receivedAddress, buffers, 2);
+
+    ++ host -> totalSendCalls;
+
+    if (sentLength > 0)
+    {
+        host -> totalSentData += sentLength;
+        host -> totalSentPackets ++;
+    }
+}
+
+static int
+enet_protocol_handle_connect_cookie (ENetPeer * peer, const ENetProtocol * command)
+{
+    ENetOutgoingCommand * outgoingCommand;
+
+    if (peer -> state != ENET_PEER_STATE_CONNECTING ||
+        command -> connectCookie.connectID != peer -> connectID ||
+        enet_list_empty (& peer -> sentReliableCommands))
+      return 0;
 
-    if (enet_list_empty (& peer -> sentReliableCommands))
-      return commandNumber;
-    
     outgoingCommand = (ENetOutgoingCommand *) enet_list_front (& peer -> sentReliableCommands);
-    
-    peer -> nextTimeout = outgoingCommand -> sentTime + outgoingCommand -> roundTripTimeout;
+    if ((outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_CONNECT)
+      return 0;
 
-    return commandNumber;
-} 
+    peer -> connectCookie [0] = command -> connectCookie.cookie [0];
+    peer -> connectCookie [1] = command -> connectCookie.cookie [1];
+    peer -> flags |= ENET_PEER_FLAG_CONNECT_COOKIE;
+
+    /* Send the connect again right away rather than waiting out its retransmit timeout. */
+    enet_list_insert (enet_list_begin (& peer -> outgoingCommands), enet_list_remove (& outgoingCommand -> outgoingCommandList));
+
+    enet_peer_schedule_send (peer);
+
+    return 0;
+}
 
 static ENetPeer *
-enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENetProtocol * command)
+enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENetProtocol * command, const ENetProtocol * connectCookie)
 {
     enet_uint8 incomingSessionID, outgoingSessionID;
     enet_uint32 mtu, windowSize;
     ENetChannel * channel;
-    size_t channelCount, duplicatePeers = 0;
-    ENetPeer * currentPeer, * peer = NULL;
+    size_t channelCount;
+    ENetPeer * peer;
     ENetProtocol verifyCommand;
 
     channelCount = ENET_NET_TO_HOST_32 (command -> connect.channelCount);
@@ -298,39 +659,36 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
         channelCount > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT)
       return NULL;
 
-    for (currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
-         ++ currentPeer)
+    if (enet_host_find_peer (host, & host -> receivedAddress, command -> connect.connectID) != NULL ||
+        enet_host_address_peer_count (host, host -> receivedAddress.host) >= host -> duplicatePeers)
+      return NULL;
+
+    if (host -> connectCookies &&
+        ! enet_protocol_check_connect_cookie (host, command, connectCookie))
     {
-        if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED)
-        {
-            if (peer == NULL)
-              peer = currentPeer;
-        }
-        else 
-        if (currentPeer -> state != ENET_PEER_STATE_CONNECTING &&
-            currentPeer -> address.host == host -> receivedAddress.host)
-        {
-            if (currentPeer -> address.port == host -> receivedAddress.port &&
-                currentPeer -> connectID == command -> connect.connectID)
-              return NULL;
+        enet_protocol_send_connect_cookie (host, command);
 
-            ++ duplicatePeers;
-        }
+        return NULL;
     }
 
-    if (peer == NULL || duplicatePeers >= host -> duplicatePeers)
+    peer = enet_host_pop_free_peer (host);
+    if (peer == NULL)
       return NULL;
 
     if (channelCount > host -> channelLimit)
       channelCount = host -> channelLimit;
     peer -> channels = (ENetChannel *) enet_malloc (channelCount * sizeof (ENetChannel));
     if (peer -> channels == NULL)
-      return NULL;
+    {
+        enet_host_push_free_peer (host, peer);
+
+        return NULL;
+    }
     peer -> channelCount = channelCount;
     peer -> state = ENET_PEER_STATE_ACKNOWLEDGING_CONNECT;
     peer -> connectID = command -> connect.connectID;
     peer -> address = host -> receivedAddress;
+    enet_host_index_peer (host, peer);
     peer -> outgoingPeerID = ENET_NET_TO_HOST_16 (command -> connect.outgoingPeerID);
     peer -> incomingBandwidth = ENET_NET_TO_HOST_32 (command -> connect.incomingBandwidth);
     peer -> outgoingBandwidth = ENET_NET_TO_HOST_32 (command -> connect.outgoingBandwidth);
@@ -360,8 +718,11 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
         channel -> incomingReliableSequenceNumber = 0;
         channel -> incomingUnreliableSequenceNumber = 0;
 
-        enet_list_clear (& channel -> incomingReliableCommands);
+        channel -> incomingReliableCapacity = 0;
+        channel -> incomingReliableCount = 0;
+        channel -> incomingReliableCommands = NULL;
         enet_list_clear (& channel -> incomingUnreliableCommands);
+        channel -> incomingUnreliableFragment = NULL;
 
         channel -> usedReliableWindows = 0;
         memset (channel -> reliableWindows, 0, sizeof (channel -> reliableWindows));
@@ -377,9 +738,14 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
 
     peer -> mtu = mtu;
 
+    /* Hosts that predate window scaling clamp the window to ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE
+       before sending it, so one above that is the offer to scale. */
+    peer -> maximumWindowSize = ENET_MIN (host -> maximumWindowSize,
+                                          ENET_MAX (ENET_NET_TO_HOST_32 (command -> connect.windowSize), ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE));
+
     if (host -> outgoingBandwidth == 0 &&
         peer -> incomingBandwidth == 0)
-      peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+      peer -> windowSize = peer -> maximumWindowSize;
     else
     if (host -> outgoingBandwidth == 0 ||
         peer -> incomingBandwidth == 0)
@@ -394,11 +760,11 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
     if (peer -> windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       peer -> windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
     else
-    if (peer -> windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    if (peer -> windowSize > peer -> maximumWindowSize)
+      peer -> windowSize = peer -> maximumWindowSize;
 
     if (host -> incomingBandwidth == 0)
-      windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+      windowSize = peer -> maximumWindowSize;
     else
       windowSize = (host -> incomingBandwidth / ENET_PEER_WINDOW_SIZE_SCALE) *
                      ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
@@ -409,8 +775,8 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
     if (windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
     else
-    if (windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    if (windowSize > peer -> maximumWindowSize)
+      windowSize = peer -> maximumWindowSize;
 
     verifyCommand.header.command = ENET_PROTOCOL_COMMAND_VERIFY_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
     verifyCommand.header.channelID = 0xFF;
@@ -533,8 +899,7 @@ enet_protocol_handle_send_fragment (ENetHost * host, ENetPeer * peer, const ENet
            totalLength;
     ENetChannel * channel;
     enet_uint16 startWindow, currentWindow;
-    ENetListIterator currentCommand;
-    ENetIncomingCommand * startCommand = NULL;
+    ENetIncomingCommand * startCommand;
 
     if (command -> header.channelID >= peer -> channelCount ||
         (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER))
@@ -555,7 +920,8 @@ enet_protocol_handle_send_fragment (ENetHost * host, ENetPeer * peer, const ENet
     if (startSequenceNumber < channel -> incomingReliableSequenceNumber)
       startWindow += ENET_PEER_RELIABLE_WINDOWS;
 
-    if (startWindow < currentWindow || startWindow >= currentWindow + ENET_PEER_FREE_RELIABLE_WINDOWS - 1)
+    if (startWindow < currentWindow || startWindow >= currentWindow + ENET_PEER_FREE_RELIABLE_WINDOWS - 1 ||
+        enet_peer_beyond_incoming_reliable_commands (channel, startSequenceNumber))
       return 0;
 
     fragmentNumber = ENET_NET_TO_HOST_32 (command -> sendFragment.fragmentNumber);
@@ -570,52 +936,29 @@ enet_protocol_handle_send_fragment (ENetHost * host, ENetPeer * peer, const ENet
         fragmentLength > totalLength - fragmentOffset)
       return -1;
  
-    for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingReliableCommands));
-         currentCommand != enet_list_end (& channel -> incomingReliableCommands);
-         currentCommand = enet_list_previous (currentCommand))
+    startCommand = enet_peer_find_incoming_reliable_command (channel, startSequenceNumber);
+    if (startCommand != NULL &&
+        ((startCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_FRAGMENT ||
+          totalLength != startCommand -> packet -> dataLength ||
+          fragmentCount != startCommand -> fragmentCount))
+      return -1;
+ 
+    if (startCommand == NULL)
     {
-       ENetIncomingCommand * incomingCommand = (ENetIncomingCommand *) currentCommand;
+       ENetProtocol hostCommand = * command;
 
-       if (startSequenceNumber >= channel -> incomingReliableSequenceNumber)
-       {
-          if (incomingCommand -> reliableSequenceNumber < channel -> incomingReliableSequenceNumber)
-            continue;
-       }
-       else
-       if (incomingCommand -> reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-         break;
-
-       if (incomingCommand -> reliableSequenceNumber <= startSequenceNumber)
-       {
-          if (incomingCommand -> reliableSequenceNumber < startSequenceNumber)
-            break;
-        
-          if ((incomingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_FRAGMENT ||
-              totalLength != incomingCommand -> packet -> dataLength ||
-              fragmentCount != incomingCommand -> fragmentCount)
-            return -1;
-
-          startCommand = incomingCommand;
-          break;
-       }
-    }
- 
-    if (startCommand == NULL)
-    {
-       ENetProtocol hostCommand = * command;
-
-       hostCommand.header.reliableSequenceNumber = startSequenceNumber;
+       hostCommand.header.reliableSequenceNumber = startSequenceNumber;
 
        startCommand = enet_peer_queue_incoming_command (peer, & hostCommand, NULL, totalLength, ENET_PACKET_FLAG_RELIABLE, fragmentCount);
        if (startCommand == NULL)
          return -1;
     }
     
-    if ((startCommand -> fragments [fragmentNumber / 32] & (1 << (fragmentNumber % 32))) == 0)
+    if ((startCommand -> fragments [fragmentNumber / 32] & (1u << (fragmentNumber % 32))) == 0)
     {
        -- startCommand -> fragmentsRemaining;
 
-       startCommand -> fragments [fragmentNumber / 32] |= (1 << (fragmentNumber % 32));
+       startCommand -> fragments [fragmentNumber / 32] |= (1u << (fragmentNumber % 32));
 
        if (fragmentOffset + fragmentLength > startCommand -> packet -> dataLength)
          fragmentLength = startCommand -> packet -> dataLength - fragmentOffset;
@@ -644,7 +987,7 @@ enet_protocol_handle_send_unreliable_fragment (ENetHost * host, ENetPeer * peer,
     enet_uint16 reliableWindow, currentWindow;
     ENetChannel * channel;
     ENetListIterator currentCommand;
-    ENetIncomingCommand * startCommand = NULL;
+    ENetIncomingCommand * startCommand;
 
     if (command -> header.channelID >= peer -> channelCount ||
         (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER))
@@ -686,42 +1029,51 @@ enet_protocol_handle_send_unreliable_fragment (ENetHost * host, ENetPeer * peer,
         fragmentLength > totalLength - fragmentOffset)
       return -1;
 
-    for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingUnreliableCommands));
-         currentCommand != enet_list_end (& channel -> incomingUnreliableCommands);
-         currentCommand = enet_list_previous (currentCommand))
+    /* The fragments of a packet are sent back to back, so they almost always belong to the one reassembled last. */
+    startCommand = channel -> incomingUnreliableFragment;
+    if (startCommand == NULL ||
+        startCommand -> reliableSequenceNumber != reliableSequenceNumber ||
+        startCommand -> unreliableSequenceNumber != startSequenceNumber)
     {
-       ENetIncomingCommand * incomingCommand = (ENetIncomingCommand *) currentCommand;
+       startCommand = NULL;
 
-       if (reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
+       for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingUnreliableCommands));
+            currentCommand != enet_list_end (& channel -> incomingUnreliableCommands);
+            currentCommand = enet_list_previous (currentCommand))
        {
-          if (incomingCommand -> reliableSequenceNumber < channel -> incomingReliableSequenceNumber)
-            continue;
-       }
-       else
-       if (incomingCommand -> reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-         break;
-
-       if (incomingCommand -> reliableSequenceNumber < reliableSequenceNumber)
-         break;
+          ENetIncomingCommand * incomingCommand = (ENetIncomingCommand *) currentCommand;
 
-       if (incomingCommand -> reliableSequenceNumber > reliableSequenceNumber)
-         continue;
+          if (reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
+          {
+             if (incomingCommand -> reliableSequenceNumber < channel -> incomingReliableSequenceNumber)
+               continue;
+          }
+          else
+          if (incomingCommand -> reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
+            break;
 
-       if (incomingCommand -> unreliableSequenceNumber <= startSequenceNumber)
-       {
-          if (incomingCommand -> unreliableSequenceNumber < startSequenceNumber)
+          if (incomingCommand -> reliableSequenceNumber < reliableSequenceNumber)
             break;
 
-          if ((incomingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT ||
-              totalLength != incomingCommand -> packet -> dataLength ||
-              fragmentCount != incomingCommand -> fragmentCount)
-            return -1;
+          if (incomingCommand -> reliableSequenceNumber > reliableSequenceNumber)
+            continue;
 
-          startCommand = incomingCommand;
-          break;
+          if (incomingCommand -> unreliableSequenceNumber <= startSequenceNumber)
+          {
+             if (incomingCommand -> unreliableSequenceNumber == startSequenceNumber)
+               startCommand = incomingCommand;
+
+             break;
+          }
        }
     }
 
+    if (startCommand != NULL &&
+        ((startCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT ||
+          totalLength != startCommand -> packet -> dataLength ||
+          fragmentCount != startCommand -> fragmentCount))
+      return -1;
+
     if (startCommand == NULL)
     {
        startCommand = enet_peer_queue_incoming_command (peer, command, NULL, totalLength, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT, fragmentCount);
@@ -729,11 +1081,14 @@ enet_protocol_handle_send_unreliable_fragment (ENetHost * host, ENetPeer * peer,
          return -1;
     }
 
-    if ((startCommand -> fragments [fragmentNumber / 32] & (1 << (fragmentNumber % 32))) == 0)
+    if (startCommand -> fragmentsRemaining > 0)
+      channel -> incomingUnreliableFragment = startCommand;
+
+    if ((startCommand -> fragments [fragmentNumber / 32] & (1u << (fragmentNumber % 32))) == 0)
     {
        -- startCommand -> fragmentsRemaining;
 
-       startCommand -> fragments [fragmentNumber / 32] |= (1 << (fragmentNumber % 32));
+       startCommand -> fragments [fragmentNumber / 32] |= (1u << (fragmentNumber % 32));
 
        if (fragmentOffset + fragmentLength > startCommand -> packet -> dataLength)
          fragmentLength = startCommand -> packet -> dataLength - fragmentOffset;
@@ -743,7 +1098,11 @@ enet_protocol_handle_send_unreliable_fragment (ENetHost * host, ENetPeer * peer,
                fragmentLength);
 
         if (startCommand -> fragmentsRemaining <= 0)
-          enet_peer_dispatch_incoming_unreliable_commands (peer, channel, NULL);
+        {
+           channel -> incomingUnreliableFragment = NULL;
+
+           enet_peer_dispatch_incoming_unreliable_commands (peer, channel, NULL);
+        }
     }
 
     return 0;
@@ -774,7 +1133,7 @@ enet_protocol_handle_bandwidth_limit (ENetHost * host, ENetPeer * peer, const EN
       ++ host -> bandwidthLimitedPeers;
 
     if (peer -> incomingBandwidth == 0 && host -> outgoingBandwidth == 0)
-      peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+      peer -> windowSize = peer -> maximumWindowSize;
     else
     if (peer -> incomingBandwidth == 0 || host -> outgoingBandwidth == 0)
       peer -> windowSize = (ENET_MAX (peer -> incomingBandwidth, host -> outgoingBandwidth) /
@@ -786,8 +1145,8 @@ enet_protocol_handle_bandwidth_limit (ENetHost * host, ENetPeer * peer, const EN
     if (peer -> windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       peer -> windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
     else
-    if (peer -> windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    if (peer -> windowSize > peer -> maximumWindowSize)
+      peer -> windowSize = peer -> maximumWindowSize;
 
     return 0;
 }
@@ -834,53 +1193,57 @@ enet_protocol_handle_disconnect (ENetHost * host, ENetPeer * peer, const ENetPro
     return 0;
 }
 
+/* Widens the 16 bit sent time an acknowledgement echoes to the service clock.
+   @returns 0 if that lies in the future, which a genuine acknowledgement cannot */
 static int
-enet_protocol_handle_acknowledge (ENetHost * host, ENetEvent * event, ENetPeer * peer, const ENetProtocol * command)
+enet_protocol_received_sent_time (ENetHost * host, enet_uint16 sentTime, enet_uint32 * receivedSentTime)
 {
-    enet_uint32 roundTripTime,
-           receivedSentTime,
-           receivedReliableSequenceNumber;
-    ENetProtocolCommand commandNumber;
-
-    if (peer -> state == ENET_PEER_STATE_DISCONNECTED || peer -> state == ENET_PEER_STATE_ZOMBIE)
-      return 0;
-
-    receivedSentTime = ENET_NET_TO_HOST_16 (command -> acknowledge.receivedSentTime);
-    receivedSentTime |= host -> serviceTime & 0xFFFF0000;
-    if ((receivedSentTime & 0x8000) > (host -> serviceTime & 0x8000))
-        receivedSentTime -= 0x10000;
+    * receivedSentTime = sentTime;
+    * receivedSentTime |= host -> serviceTime & 0xFFFF0000;
+    if ((* receivedSentTime & 0x8000) > (host -> serviceTime & 0x8000))
+        * receivedSentTime -= 0x10000;
 
-    if (ENET_TIME_LESS (host -> serviceTime, receivedSentTime))
-      return 0;
+    return ! ENET_TIME_LESS (host -> serviceTime, * receivedSentTime);
+}
 
-    roundTripTime = ENET_TIME_DIFFERENCE (host -> serviceTime, receivedSentTime);
-    roundTripTime = ENET_MAX (roundTripTime, 1);
+/* Folds an acknowledged round trip into the peer's round trip time and throttle. roundTripTime is
+   in microseconds, or 0 for an acknowledgement of an earlier transmission than the command's
+   last one, which only has the millisecond echo to go by; that still times the right one.
+   @returns the round trip time used */
+static enet_uint32
+enet_protocol_update_round_trip_time (ENetHost * host, ENetPeer * peer, enet_uint32 receivedSentTime, enet_uint32 roundTripTime)
+{
+    if (roundTripTime == 0)
+      roundTripTime = ENET_MAX (ENET_TIME_DIFFERENCE (host -> serviceTime, receivedSentTime), 1) * 1000;
 
     if (peer -> lastReceiveTime > 0)
     {
-       enet_peer_throttle (peer, roundTripTime);
+       enet_peer_throttle (peer, (roundTripTime + 999) / 1000);
 
-       peer -> roundTripTimeVariance -= peer -> roundTripTimeVariance / 4;
+       peer -> roundTripTimeVarianceMicroseconds -= peer -> roundTripTimeVarianceMicroseconds / 4;
 
-       if (roundTripTime >= peer -> roundTripTime)
+       if (roundTripTime >= peer -> roundTripTimeMicroseconds)
        {
-          enet_uint32 diff = roundTripTime - peer -> roundTripTime;
-          peer -> roundTripTimeVariance += diff / 4;
-          peer -> roundTripTime += diff / 8;
+          enet_uint32 diff = roundTripTime - peer -> roundTripTimeMicroseconds;
+          peer -> roundTripTimeVarianceMicroseconds += diff / 4;
+          peer -> roundTripTimeMicroseconds += diff / 8;
        }
        else
        {
-          enet_uint32 diff = peer -> roundTripTime - roundTripTime;
-          peer -> roundTripTimeVariance += diff / 4;
-          peer -> roundTripTime -= diff / 8;
+          enet_uint32 diff = peer -> roundTripTimeMicroseconds - roundTripTime;
+          peer -> roundTripTimeVarianceMicroseconds += diff / 4;
+          peer -> roundTripTimeMicroseconds -= diff / 8;
        }
     }
     else
     {
-       peer -> roundTripTime = roundTripTime;
-       peer -> roundTripTimeVariance = (roundTripTime + 1) / 2;
+       peer -> roundTripTimeMicroseconds = roundTripTime;
+       peer -> roundTripTimeVarianceMicroseconds = (roundTripTime + 1) / 2;
     }
 
+    peer -> roundTripTime = (peer -> roundTripTimeMicroseconds + 999) / 1000;
+    peer -> roundTripTimeVariance = (peer -> roundTripTimeVarianceMicroseconds + 999) / 1000;
+
     if (peer -> roundTripTime < peer -> lowestRoundTripTime)
       peer -> lowestRoundTripTime = peer -> roundTripTime;
 
@@ -900,9 +1263,35 @@ enet_protocol_handle_acknowledge (ENetHost * host, ENetEvent * event, ENetPeer *
     peer -> lastReceiveTime = ENET_MAX (host -> serviceTime, 1);
     peer -> earliestTimeout = 0;
 
+    return roundTripTime;
+}
+
+static int
+enet_protocol_handle_acknowledge (ENetHost * host, ENetEvent * event, ENetPeer * peer, const ENetProtocol * command)
+{
+    enet_uint32 roundTripTime,
+           receivedSentTime,
+           receivedReliableSequenceNumber,
+           reliableDataInTransit;
+    ENetProtocolCommand commandNumber;
+
+    if (peer -> state == ENET_PEER_STATE_DISCONNECTED || peer -> state == ENET_PEER_STATE_ZOMBIE)
+      return 0;
+
+    if (! enet_protocol_received_sent_time (host, ENET_NET_TO_HOST_16 (command -> acknowledge.receivedSentTime), & receivedSentTime))
+      return 0;
+
     receivedReliableSequenceNumber = ENET_NET_TO_HOST_16 (command -> acknowledge.receivedReliableSequenceNumber);
 
-    commandNumber = enet_protocol_remove_sent_reliable_command (peer, receivedReliableSequenceNumber, command -> header.channelID);
+    roundTripTime = 0;
+    reliableDataInTransit = peer -> reliableDataInTransit;
+
+    commandNumber = enet_protocol_remove_sent_reliable_command (peer, receivedReliableSequenceNumber, command -> header.channelID, receivedSentTime, & roundTripTime);
+
+    roundTripTime = enet_protocol_update_round_trip_time (host, peer, receivedSentTime, roundTripTime);
+
+    if (host -> congestionControl.acknowledge != NULL)
+      host -> congestionControl.acknowledge (peer, reliableDataInTransit - peer -> reliableDataInTransit, roundTripTime);
 
     switch (peer -> state)
     {
@@ -933,6 +1322,62 @@ enet_protocol_handle_acknowledge (ENetHost * host, ENetEvent * event, ENetPeer *
     return 0;
 }
 
+/* Selective acknowledgements only ever cover channel commands, so unlike plain ones they never
+   complete a connect or disconnect. */
+static int
+enet_protocol_handle_selective_acknowledge (ENetHost * host, ENetPeer * peer, const ENetProtocol * command)
+{
+    enet_uint32 roundTripTime = 0,
+                receivedSentTime,
+                reliableDataInTransit;
+
+    if (! (host -> capabilities & ENET_PROTOCOL_CAPABILITY_SELECTIVE_ACKNOWLEDGE) ||
+        command -> header.channelID >= peer -> channelCount)
+      return -1;
+
+    if (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER)
+      return 0;
+
+    if (! enet_protocol_received_sent_time (host, ENET_NET_TO_HOST_16 (command -> selectiveAcknowledge.receivedSentTime), & receivedSentTime))
+      return 0;
+
+    reliableDataInTransit = peer -> reliableDataInTransit;
+
+    enet_protocol_remove_sent_reliable_commands (peer,
+                                                 command -> header.channelID,
+                                                 command -> header.reliableSequenceNumber,
+                                                 ENET_NET_TO_HOST_32 (command -> selectiveAcknowledge.receivedReliableSequenceMask),
+                                                 receivedSentTime,
+                                                 & roundTripTime);
+
+    roundTripTime = enet_protocol_update_round_trip_time (host, peer, receivedSentTime, roundTripTime);
+
+    if (host -> congestionControl.acknowledge != NULL)
+      host -> congestionControl.acknowledge (peer, reliableDataInTransit - peer -> reliableDataInTransit, roundTripTime);
+
+    if (peer -> state == ENET_PEER_STATE_DISCONNECT_LATER &&
+        enet_list_empty (& peer -> outgoingCommands) &&
+        enet_list_empty (& peer -> sentReliableCommands))
+      enet_peer_disconnect (peer, peer -> eventData);
+
+    return 0;
+}
+
+static int
+enet_protocol_handle_capabilities (ENetHost * host, ENetPeer * peer, const ENetProtocol * command)
+{
+    if (command -> capabilities.connectID != peer -> connectID)
+      return -1;
+
+    if (peer -> state != ENET_PEER_STATE_ACKNOWLEDGING_CONNECT && peer -> state != ENET_PEER_STATE_CONNECTED)
+      return 0;
+
+    peer -> capabilities = ENET_NET_TO_HOST_32 (command -> capabilities.capabilities) & host -> capabilities;
+    peer -> flags |= ENET_PEER_FLAG_CAPABILITIES;
+
+    return 0;
+}
+
 static int
 enet_protocol_handle_verify_connect (ENetHost * host, ENetEvent * event, ENetPeer * peer, const ENetProtocol * command)
 {
@@ -957,7 +1402,7 @@ enet_protocol_handle_verify_connect (ENetHost * host, ENetEvent * event, ENetPee
         return -1;
     }
 
-    enet_protocol_remove_sent_reliable_command (peer, 1, 0xFF);
+    enet_protocol_remove_sent_reliable_command (peer, 1, 0xFF, 0, NULL);
     
     if (channelCount < peer -> channelCount)
       peer -> channelCount = channelCount;
@@ -982,8 +1427,11 @@ enet_protocol_handle_verify_connect (ENetHost * host, ENetEvent * event, ENetPee
     if (windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
 
-    if (windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    /* The foreign host answers an offer to scale with a window above ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE. */
+    peer -> maximumWindowSize = ENET_MIN (peer -> maximumWindowSize, ENET_MAX (windowSize, ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE));
+
+    if (windowSize > peer -> maximumWindowSize)
+      windowSize = peer -> maximumWindowSize;
 
     if (windowSize < peer -> windowSize)
       peer -> windowSize = windowSize;
@@ -999,7 +1447,7 @@ static int
 enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
 {
     ENetProtocolHeader * header;
-    ENetProtocol * command;
+    ENetProtocol * command, * connectCookie = NULL;
     ENetPeer * peer;
     enet_uint8 * currentData;
     size_t headerSize;
@@ -1102,7 +1550,7 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
 
        currentData += commandSize;
 
-       if (peer == NULL && commandNumber != ENET_PROTOCOL_COMMAND_CONNECT)
+       if (peer == NULL && commandNumber != ENET_PROTOCOL_COMMAND_CONNECT && commandNumber != ENET_PROTOCOL_COMMAND_CONNECT_COOKIE)
          break;
          
        command -> header.reliableSequenceNumber = ENET_NET_TO_HOST_16 (command -> header.reliableSequenceNumber);
@@ -1117,8 +1565,16 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
        case ENET_PROTOCOL_COMMAND_CONNECT:
           if (peer != NULL)
             goto commandError;
-          peer = enet_protocol_handle_connect (host, header, command);
+          peer = enet_protocol_handle_connect (host, header, command, connectCookie);
+          if (peer == NULL)
+            goto commandError;
+          break;
+
+       case ENET_PROTOCOL_COMMAND_CONNECT_COOKIE:
           if (peer == NULL)
+            connectCookie = command;
+          else
+          if (enet_protocol_handle_connect_cookie (peer, command))
             goto commandError;
           break;
 
@@ -1127,6 +1583,16 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
             goto commandError;
           break;
 
+       case ENET_PROTOCOL_COMMAND_CAPABILITIES:
+          if (enet_protocol_handle_capabilities (host, peer, command))
+            goto commandError;
+          break;
+
+       case ENET_PROTOCOL_COMMAND_SELECTIVE_ACKNOWLEDGE:
+          if (enet_protocol_handle_selective_acknowledge (host, peer, command))
+            goto commandError;
+          break;
+
        case ENET_PROTOCOL_COMMAND_DISCONNECT:
           if (enet_protocol_handle_disconnect (host, peer, command))
             goto commandError;
@@ -1220,24 +1686,49 @@ enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
 
     for (packets = 0; packets < 256; ++ packets)
     {
-       int receivedLength;
-       ENetBuffer buffer;
+       ENetDatagram * datagram;
+       size_t receivedLength;
 
-       buffer.data = host -> packetData [0];
-       buffer.dataLength = sizeof (host -> packetData [0]);
+       if (host -> receivedDatagramIndex >= host -> receivedDatagramCount)
+       {
+          int receivedCount = enet_socket_receive_multiple (host -> socket,
+                                                            host -> receivedDatagrams,
+                                                            ENET_HOST_RECEIVE_BATCH_SIZE);
 
-       receivedLength = enet_socket_receive (host -> socket,
-                                             & host -> receivedAddress,
-                                             & buffer,
-                                             1);
+          ++ host -> totalReceiveCalls;
 
-       if (receivedLength < 0)
-         return -1;
+          if (receivedCount < 0)
+            return -1;
+
+          if (receivedCount == 0)
+            return 0;
+
+          host -> receivedDatagramIndex = 0;
+          host -> receivedDatagramCount = receivedCount;
+          host -> receivedDatagramOffset = 0;
+       }
+
+       /* Datagrams left over in the batch stay queued on the host if an event is returned,
+          and datagrams coalesced by segmentation offload are split back out one at a time. */
+       datagram = & host -> receivedDatagrams [host -> receivedDatagramIndex];
+       receivedLength = datagram -> dataLength - host -> receivedDatagramOffset;
+       if (datagram -> segmentSize > 0 && receivedLength > datagram -> segmentSize)
+         receivedLength = datagram -> segmentSize;
+
+       host -> receivedData = (enet_uint8 *) datagram -> buffers [0].data + host -> receivedDatagramOffset;
+
+       host -> receivedDatagramOffset += receivedLength;
+       if (host -> receivedDatagramOffset >= datagram -> dataLength)
+       {
+          ++ host -> receivedDatagramIndex;
+
+          host -> receivedDatagramOffset = 0;
+       }
 
        if (receivedLength == 0)
-         return 0;
+         continue;
 
-       host -> receivedData = host -> packetData [0];
+       host -> receivedAddress = datagram -> address;
        host -> receivedDataLength = receivedLength;
       
        host -> totalReceivedData += receivedLength;
@@ -1277,6 +1768,41 @@ enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
     return 0;
 }
 
+/* Folds the acknowledgements queued after acknowledgement for the same channel and sent time into
+   a mask of the sequence numbers that follow its own, freeing them. Acknowledgements are queued in
+   the order their commands arrived, so the scan ends at the first one with another sent time. */
+static enet_uint32
+enet_protocol_gather_acknowledgements (ENetHost * host, ENetPeer * peer, ENetAcknowledgement * acknowledgement)
+{
+    ENetListIterator currentAcknowledgement = enet_list_next (& acknowledgement -> acknowledgementList);
+    enet_uint32 reliableSequenceMask = 0;
+
+    while (currentAcknowledgement != enet_list_end (& peer -> acknowledgements))
+    {
+       ENetAcknowledgement * nextAcknowledgement = (ENetAcknowledgement *) currentAcknowledgement;
+       enet_uint16 offset;
+
+       if (nextAcknowledgement -> sentTime != acknowledgement -> sentTime)
+         break;
+
+       currentAcknowledgement = enet_list_next (currentAcknowledgement);
+
+       if (nextAcknowledgement -> command.header.channelID != acknowledgement -> command.header.channelID)
+         continue;
+
+       offset = (enet_uint16) (nextAcknowledgement -> command.header.reliableSequenceNumber - acknowledgement -> command.header.reliableSequenceNumber - 1);
+       if (offset >= 32)
+         break;
+
+       reliableSequenceMask |= 1u << offset;
+
+       enet_list_remove (& nextAcknowledgement -> acknowledgementList);
+       enet_pool_free (& host -> acknowledgementPool, nextAcknowledgement);
+    }
+
+    return reliableSequenceMask;
+}
+
 static void
 enet_protocol_send_acknowledgements (ENetHost * host, ENetPeer * peer)
 {
@@ -1285,6 +1811,8 @@ enet_protocol_send_acknowledgements (ENetHost * host, ENetPeer * peer)
     ENetAcknowledgement * acknowledgement;
     ENetListIterator currentAcknowledgement;
     enet_uint16 reliableSequenceNumber;
+    enet_uint32 reliableSequenceMask;
+    size_t commandSize = (peer -> capabilities & ENET_PROTOCOL_CAPABILITY_SELECTIVE_ACKNOWLEDGE) ? sizeof (ENetProtocolSelectiveAcknowledge) : sizeof (ENetProtocolAcknowledge);
  
     currentAcknowledgement = enet_list_begin (& peer -> acknowledgements);
          
@@ -1292,7 +1820,7 @@ enet_protocol_send_acknowledgements (ENetHost * host, ENetPeer * peer)
     {
        if (command >= & host -> commands [sizeof (host -> commands) / sizeof (ENetProtocol)] ||
            buffer >= & host -> buffers [sizeof (host -> buffers) / sizeof (ENetBuffer)] ||
-           peer -> mtu - host -> packetSize < sizeof (ENetProtocolAcknowledge))
+           peer -> mtu - host -> packetSize < commandSize)
        {
           host -> continueSending = 1;
 
@@ -1301,26 +1829,44 @@ enet_protocol_send_acknowledgements (ENetHost * host, ENetPeer * peer)
 
        acknowledgement = (ENetAcknowledgement *) currentAcknowledgement;
  
+       reliableSequenceMask = 0;
+       if (commandSize == sizeof (ENetProtocolSelectiveAcknowledge) &&
+           acknowledgement -> command.header.channelID < peer -> channelCount)
+         reliableSequenceMask = enet_protocol_gather_acknowledgements (host, peer, acknowledgement);
+
        currentAcknowledgement = enet_list_next (currentAcknowledgement);
 
        buffer -> data = command;
-       buffer -> dataLength = sizeof (ENetProtocolAcknowledge);
-
-       host -> packetSize += buffer -> dataLength;
 
        reliableSequenceNumber = ENET_HOST_TO_NET_16 (acknowledgement -> command.header.reliableSequenceNumber);
   
-       command -> header.command = ENET_PROTOCOL_COMMAND_ACKNOWLEDGE;
        command -> header.channelID = acknowledgement -> command.header.channelID;
        command -> header.reliableSequenceNumber = reliableSequenceNumber;
-       command -> acknowledge.receivedReliableSequenceNumber = reliableSequenceNumber;
-       command -> acknowledge.receivedSentTime = ENET_HOST_TO_NET_16 (acknowledgement -> sentTime);
+
+       if (reliableSequenceMask)
+       {
+          buffer -> dataLength = sizeof (ENetProtocolSelectiveAcknowledge);
+
+          command -> header.command = ENET_PROTOCOL_COMMAND_SELECTIVE_ACKNOWLEDGE;
+          command -> selectiveAcknowledge.receivedSentTime = ENET_HOST_TO_NET_16 (acknowledgement -> sentTime);
+          command -> selectiveAcknowledge.receivedReliableSequenceMask = ENET_HOST_TO_NET_32 (reliableSequenceMask);
+       }
+       else
+       {
+          buffer -> dataLength = sizeof (ENetProtocolAcknowledge);
+
+          command -> header.command = ENET_PROTOCOL_COMMAND_ACKNOWLEDGE;
+          command -> acknowledge.receivedReliableSequenceNumber = reliableSequenceNumber;
+          command -> acknowledge.receivedSentTime = ENET_HOST_TO_NET_16 (acknowledgement -> sentTime);
+       }
+
+       host -> packetSize += buffer -> dataLength;
   
        if ((acknowledgement -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_DISCONNECT)
          enet_protocol_dispatch_state (host, peer, ENET_PEER_STATE_ZOMBIE);
 
        enet_list_remove (& acknowledgement -> acknowledgementList);
-       enet_free (acknowledgement);
+       enet_pool_free (& host -> acknowledgementPool, acknowledgement);
 
        ++ command;
        ++ buffer;
@@ -1345,9 +1891,24 @@ enet_protocol_check_timeouts (ENetHost * host, ENetPeer * peer, ENetEvent * even
 
        currentCommand = enet_list_next (currentCommand);
 
-       if (ENET_TIME_DIFFERENCE (host -> serviceTime, outgoingCommand -> sentTime) < outgoingCommand -> roundTripTimeout)
+       if (host -> serviceTimeMicroseconds - outgoingCommand -> sentTimeMicroseconds < outgoingCommand -> roundTripTimeout)
          continue;
 
+       /* A lost probe only says the path might not carry its size. It is not sent again, and it
+          neither counts as packet loss nor brings the peer closer to timing out. */
+       if (enet_protocol_is_mtu_probe (peer, outgoingCommand))
+       {
+          enet_list_remove (& outgoingCommand -> outgoingCommandList);
+          enet_pool_free (& host -> outgoingCommandPool, outgoingCommand);
+
+          enet_protocol_lose_mtu_probe (peer);
+
+          if (! enet_list_empty (& peer -> sentReliableCommands))
+            peer -> nextTimeout = enet_protocol_retransmit_time ((ENetOutgoingCommand *) enet_list_front (& peer -> sentReliableCommands));
+
+          continue;
+       }
+
        if (peer -> earliestTimeout == 0 ||
            ENET_TIME_LESS (outgoingCommand -> sentTime, peer -> earliestTimeout))
          peer -> earliestTimeout = outgoingCommand -> sentTime;
@@ -1367,6 +1928,23 @@ enet_protocol_check_timeouts (ENetHost * host, ENetPeer * peer, ENetEvent * even
           
        ++ peer -> packetsLost;
 
+       /* A large datagram lost time after time while nothing at all gets acknowledged, here since
+          before its second transmission, looks more like a path that stopped carrying the MTU
+          than like congestion, so fall back to the minimum MTU and search again. */
+       if (host -> probeMtu != 0 &&
+           outgoingCommand -> sendAttempts == ENET_PEER_MTU_BLACK_HOLE_ATTEMPTS &&
+           peer -> mtu > ENET_PROTOCOL_MINIMUM_MTU &&
+           sizeof (ENetProtocolHeader) + commandSizes [outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK] + outgoingCommand -> fragmentLength > ENET_PROTOCOL_MINIMUM_MTU &&
+           ENET_TIME_DIFFERENCE (host -> serviceTime, peer -> earliestTimeout) * 2000 >= outgoingCommand -> roundTripTimeout * 3)
+       {
+          peer -> mtu = ENET_PROTOCOL_MINIMUM_MTU;
+          peer -> mtuProbeLimit = 0;
+          peer -> mtuProbeAttempts = 0;
+       }
+
+       if (host -> congestionControl.lose != NULL)
+         host -> congestionControl.lose (peer, outgoingCommand -> packet != NULL ? outgoingCommand -> fragmentLength : 0);
+
        outgoingCommand -> roundTripTimeout *= 2;
 
        enet_list_insert (insertPosition, enet_list_remove (& outgoingCommand -> outgoingCommandList));
@@ -1376,7 +1954,7 @@ enet_protocol_check_timeouts (ENetHost * host, ENetPeer * peer, ENetEvent * even
        {
           outgoingCommand = (ENetOutgoingCommand *) currentCommand;
 
-          peer -> nextTimeout = outgoingCommand -> sentTime + outgoingCommand -> roundTripTimeout;
+          peer -> nextTimeout = enet_protocol_retransmit_time (outgoingCommand);
        }
     }
     
@@ -1393,7 +1971,7 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
     ENetChannel *channel = NULL;
     enet_uint16 reliableWindow = 0;
     size_t commandSize;
-    int windowExceeded = 0, windowWrap = 0, canPing = 1;
+    int windowExceeded = 0, windowWrap = 0, canPing = 1, sendCookie, sendCapabilities, sendProbe, sendAlone;
 
     currentCommand = enet_list_begin (& peer -> outgoingCommands);
     
@@ -1401,6 +1979,14 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
     {
        outgoingCommand = (ENetOutgoingCommand *) currentCommand;
 
+       /* Control commands go out on time; only the data waits for the pacer. */
+       if (outgoingCommand -> packet != NULL && (peer -> flags & ENET_PEER_FLAG_PACED))
+       {
+          currentCommand = enet_list_next (currentCommand);
+
+          continue;
+       }
+
        if (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE)
        {
           channel = outgoingCommand -> command.header.channelID < peer -> channelCount ? & peer -> channels [outgoingCommand -> command.header.channelID] : NULL;
@@ -1426,9 +2012,15 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
           {
              if (! windowExceeded)
              {
-                enet_uint32 windowSize = (peer -> packetThrottle * peer -> windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
+                enet_uint32 windowSize;
+
+                if (host -> congestionControl.acknowledge != NULL)
+                  windowSize = ENET_MIN (peer -> congestion.window, peer -> windowSize);
+                else
+                  windowSize = (peer -> packetThrottle * peer -> windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
              
-                if (peer -> reliableDataInTransit + outgoingCommand -> fragmentLength > ENET_MAX (windowSize, peer -> mtu))
+                /* One fragment may always be in transit, even one cut for an MTU that has since fallen. */
+                if (peer -> reliableDataInTransit + outgoingCommand -> fragmentLength > ENET_MAX (windowSize, ENET_MAX (peer -> mtu, outgoingCommand -> fragmentLength)))
                   windowExceeded = 1;
              }
              if (windowExceeded)
@@ -1443,11 +2035,41 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
        }
 
        commandSize = commandSizes [outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK];
-       if (command >= & host -> commands [sizeof (host -> commands) / sizeof (ENetProtocol)] ||
-           buffer + 1 >= & host -> buffers [sizeof (host -> buffers) / sizeof (ENetBuffer)] ||
-           peer -> mtu - host -> packetSize < commandSize ||
-           (outgoingCommand -> packet != NULL && 
-             (enet_uint16) (peer -> mtu - host -> packetSize) < (enet_uint16) (commandSize + outgoingCommand -> fragmentLength)))
+       sendCookie = (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_CONNECT &&
+                      (peer -> flags & ENET_PEER_FLAG_CONNECT_COOKIE);
+       /* The offer goes after the connect so hosts that do not know the command still see the connect. */
+       switch (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK)
+       {
+       case ENET_PROTOCOL_COMMAND_CONNECT:
+          sendCapabilities = host -> capabilities != 0;
+          break;
+
+       case ENET_PROTOCOL_COMMAND_VERIFY_CONNECT:
+          sendCapabilities = (peer -> flags & ENET_PEER_FLAG_CAPABILITIES) != 0;
+          break;
+
+       default:
+          sendCapabilities = 0;
+          break;
+       }
+       /* A path MTU probe, and a fragment cut for an MTU that has since fallen, go out alone in a
+          datagram of their own. */
+       sendProbe = enet_protocol_is_mtu_probe (peer, outgoingCommand);
+       sendAlone = sendProbe ||
+                     (outgoingCommand -> packet != NULL &&
+                       sizeof (ENetProtocolHeader) + commandSize + outgoingCommand -> fragmentLength > peer -> mtu);
+       if (sendAlone && command > host -> commands)
+       {
+          host -> continueSending = 1;
+
+          break;
+       }
+       if (command + sendCookie + sendCapabilities >= & host -> commands [sizeof (host -> commands) / sizeof (ENetProtocol)] ||
+           buffer + 1 + sendCookie + sendCapabilities >= & host -> buffers [sizeof (host -> buffers) / sizeof (ENetBuffer)] ||
+           (! sendAlone &&
+             (peer -> mtu - host -> packetSize < commandSize + (sendCookie ? sizeof (ENetProtocolConnectCookie) : 0) + (sendCapabilities ? sizeof (ENetProtocolCapabilities) : 0) ||
+               (outgoingCommand -> packet != NULL && 
+                 (enet_uint16) (peer -> mtu - host -> packetSize) < (enet_uint16) (commandSize + outgoingCommand -> fragmentLength)))))
        {
           host -> continueSending = 1;
           
@@ -1468,18 +2090,23 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
  
           if (outgoingCommand -> roundTripTimeout == 0)
           {
-             outgoingCommand -> roundTripTimeout = peer -> roundTripTime + 4 * peer -> roundTripTimeVariance;
+             /* The variance is no longer rounded to whole milliseconds, so on a steady path it can shrink
+                below the jitter a growing queue adds; the floor keeps that from firing retransmits. */
+             outgoingCommand -> roundTripTimeout = peer -> roundTripTimeMicroseconds + ENET_MAX (4 * peer -> roundTripTimeVarianceMicroseconds, ENET_PEER_RETRANSMIT_MARGIN_MINIMUM);
              outgoingCommand -> roundTripTimeoutLimit = peer -> timeoutLimit * outgoingCommand -> roundTripTimeout;
           }
 
-          if (enet_list_empty (& peer -> sentReliableCommands))
-            peer -> nextTimeout = host -> serviceTime + outgoingCommand -> roundTripTimeout;
+          outgoingCommand -> sentTime = host -> serviceTime;
+          outgoingCommand -> sentTimeMicroseconds = host -> serviceTimeMicroseconds;
+
+          /* A probe times out sooner than the retransmits queued ahead of it may have backed off to. */
+          if (enet_list_empty (& peer -> sentReliableCommands) ||
+              (sendProbe && ENET_TIME_LESS (enet_protocol_retransmit_time (outgoingCommand), peer -> nextTimeout)))
+            peer -> nextTimeout = enet_protocol_retransmit_time (outgoingCommand);
 
           enet_list_insert (enet_list_end (& peer -> sentReliableCommands),
                             enet_list_remove (& outgoingCommand -> outgoingCommandList));
 
-          outgoingCommand -> sentTime = host -> serviceTime;
-
           host -> headerFlags |= ENET_PROTOCOL_HEADER_FLAG_SENT_TIME;
 
           peer -> reliableDataInTransit += outgoingCommand -> fragmentLength;
@@ -1503,7 +2130,7 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
                      enet_packet_destroy (outgoingCommand -> packet);
 
                    enet_list_remove (& outgoingCommand -> outgoingCommandList);
-                   enet_free (outgoingCommand);
+                   enet_pool_free (& host -> outgoingCommandPool, outgoingCommand);
 
                    if (currentCommand == enet_list_end (& peer -> outgoingCommands))
                      break;
@@ -1526,6 +2153,24 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
             enet_list_insert (enet_list_end (& peer -> sentUnreliableCommands), outgoingCommand);
        }
 
+       if (sendCookie)
+       {
+          command -> header.command = ENET_PROTOCOL_COMMAND_CONNECT_COOKIE;
+          command -> header.channelID = 0xFF;
+          command -> header.reliableSequenceNumber = 0;
+          command -> connectCookie.connectID = peer -> connectID;
+          command -> connectCookie.cookie [0] = peer -> connectCookie [0];
+          command -> connectCookie.cookie [1] = peer -> connectCookie [1];
+
+          buffer -> data = command;
+          buffer -> dataLength = sizeof (ENetProtocolConnectCookie);
+
+          host -> packetSize += buffer -> dataLength;
+
+          ++ command;
+          ++ buffer;
+       }
+
        buffer -> data = command;
        buffer -> dataLength = commandSize;
 
@@ -1544,12 +2189,48 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
        }
        else
        if (! (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE))
-         enet_free (outgoingCommand);
+         enet_pool_free (& host -> outgoingCommandPool, outgoingCommand);
 
        ++ peer -> packetsSent;
         
        ++ command;
        ++ buffer;
+
+       if (sendCapabilities)
+       {
+          command -> header.command = ENET_PROTOCOL_COMMAND_CAPABILITIES;
+          command -> header.channelID = 0xFF;
+          command -> header.reliableSequenceNumber = 0;
+          command -> capabilities.connectID = peer -> connectID;
+          command -> capabilities.capabilities = ENET_HOST_TO_NET_32 (host -> capabilities);
+
+          buffer -> data = command;
+          buffer -> dataLength = sizeof (ENetProtocolCapabilities);
+
+          host -> packetSize += buffer -> dataLength;
+
+          ++ command;
+          ++ buffer;
+       }
+
+       if (sendAlone)
+       {
+          if (sendProbe && host -> packetSize < peer -> mtuProbeSize)
+          {
+             buffer -> data = (void *) probePadding;
+             buffer -> dataLength = peer -> mtuProbeSize - host -> packetSize;
+
+             host -> packetSize = peer -> mtuProbeSize;
+
+             ++ buffer;
+
+             peer -> flags |= ENET_PEER_FLAG_MTU_PROBE;
+          }
+
+          host -> continueSending = 1;
+
+          break;
+       }
     }
 
     host -> commandCount = command - host -> commands;
@@ -1564,6 +2245,383 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
     return canPing;
 }
 
+/** Compresses the commands of the datagram being built for peer into host -> packetData [1].
+    Tiny datagrams are left alone, and when compression stops paying off for a peer it is skipped
+    for a stretch of datagrams that doubles each time a retry still does not pay off.
+    @returns the compressed size, or 0 to send the datagram uncompressed
+*/
+static size_t
+enet_protocol_compress_datagram (ENetHost * host, ENetPeer * peer)
+{
+    size_t originalSize = host -> packetSize - sizeof (ENetProtocolHeader),
+           compressedSize;
+    enet_uint32 startTime, ratio;
+    int probing;
+
+    if (originalSize < host -> compressionThreshold)
+      return 0;
+
+    if (peer -> compressionBypass > 0)
+    {
+        -- peer -> compressionBypass;
+        ++ host -> totalCompressionBypasses;
+
+        return 0;
+    }
+
+    probing = peer -> compressionFailures >= ENET_PEER_COMPRESSION_FAILURE_LIMIT ||
+              peer -> compressionRatio >= ENET_PEER_COMPRESSION_RATIO_BYPASS;
+
+    startTime = enet_time_get_microseconds ();
+
+    compressedSize = host -> compressor.compress (host -> compressor.context,
+                         & host -> buffers [1], host -> bufferCount - 1,
+                         originalSize,
+                         host -> packetData [1],
+                         originalSize);
+
+    host -> totalCompressionTime += enet_time_get_microseconds () - startTime;
+    ++ host -> totalCompressedDatagrams;
+
+    if (compressedSize > 0 && compressedSize < originalSize)
+    {
+        ratio = (enet_uint32) (compressedSize * ENET_PEER_COMPRESSION_RATIO_SCALE / originalSize);
+
+        peer -> compressionFailures = 0;
+
+        host -> totalCompressionSavedData += (enet_uint32) (originalSize - compressedSize);
+
+#ifdef ENET_DEBUG_COMPRESS
+        printf ("peer %u: compressed %u -> %u (%u%%)\n", peer -> incomingPeerID, originalSize, compressedSize, (compressedSize * 100) / originalSize);
+#endif
+    }
+    else
+    {
+        ratio = ENET_PEER_COMPRESSION_RATIO_SCALE;
+        compressedSize = 0;
+
+        if (peer -> compressionFailures < ENET_PEER_COMPRESSION_FAILURE_LIMIT)
+          ++ peer -> compressionFailures;
+    }
+
+    /* a retry after a bypass starts the average over, the traffic may have changed since */
+    if (probing)
+      peer -> compressionRatio = ratio;
+    else
+      peer -> compressionRatio = (peer -> compressionRatio * 7 + ratio) / 8;
+
+    if (peer -> compressionFailures >= ENET_PEER_COMPRESSION_FAILURE_LIMIT ||
+        peer -> compressionRatio >= ENET_PEER_COMPRESSION_RATIO_BYPASS)
+    {
+        peer -> compressionBypass = peer -> compressionBackoff;
+
+        if (peer -> compressionBackoff < ENET_PEER_COMPRESSION_BACKOFF_MAXIMUM)
+          peer -> compressionBackoff *= 2;
+    }
+    else
+      peer -> compressionBackoff = ENET_PEER_COMPRESSION_BACKOFF_MINIMUM;
+
+    return compressedSize;
+}
+
+static void
+enet_protocol_stage_datagram (ENetHost * host, ENetPeer * peer)
+{
+    ENetStagedDatagram * staged = & host -> stagedDatagrams [host -> stagedDatagramCount];
+    ENetDatagram * datagram = & host -> sendDatagrams [host -> stagedDatagramCount];
+    ENetBuffer * buffers = & host -> stagedBuffers [host -> stagedBufferCount],
+               * buffer;
+
+    memcpy (staged -> headerData, host -> buffers -> data, host -> buffers -> dataLength);
+    memcpy (staged -> commands, host -> commands, host -> commandCount * sizeof (ENetProtocol));
+    memcpy (buffers, host -> buffers, host -> bufferCount * sizeof (ENetBuffer));
+
+    buffers -> data = staged -> headerData;
+
+    datagram -> address = peer -> address;
+    datagram -> buffers = buffers;
+    datagram -> bufferCount = host -> bufferCount;
+    datagram -> dataLength = buffers -> dataLength;
+    datagram -> segmentSize = 0;
+
+    /* Commands and compressed data live in host scratch space that the next datagram reuses,
+       so point the staged buffers at private copies. Packet data is referenced in place, which
+       is why sent unreliable commands are only released once the batch has been flushed. */
+    for (buffer = & buffers [1];
+         buffer < & buffers [host -> bufferCount];
+         ++ buffer)
+    {
+       enet_uint8 * data = (enet_uint8 *) buffer -> data;
+
+       if (data == host -> packetData [1])
+       {
+          memcpy (staged -> compressedData, data, buffer -> dataLength);
+
+          buffer -> data = staged -> compressedData;
+       }
+       else
+       if (data >= (enet_uint8 *) host -> commands && data < (enet_uint8 *) & host -> commands [host -> commandCount])
+         buffer -> data = (enet_uint8 *) staged -> commands + (data - (enet_uint8 *) host -> commands);
+
+       datagram -> dataLength += buffer -> dataLength;
+    }
+
+    staged -> peer = peer;
+
+    peer -> flags |= ENET_PEER_FLAG_SEND_STAGED;
+
+    ++ host -> stagedDatagramCount;
+    host -> stagedBufferCount += host -> bufferCount;
+}
+
+static size_t
+enet_protocol_coalesce_staged_datagrams (ENetHost * host)
+{
+    ENetDatagram * datagram,
+                 * group = NULL,
+                 * nextGroup = host -> sendDatagrams;
+    size_t segmentCount = 0;
+
+    /* Staged buffers are packed back to back, so a run of datagrams to the same address can
+       be merged by widening the first datagram's buffer range. Every datagram but the last
+       in a run must have the same size, which the fragments of a large packet do. */
+    for (datagram = host -> sendDatagrams;
+         datagram < & host -> sendDatagrams [host -> stagedDatagramCount];
+         ++ datagram)
+    {
+       if (group != NULL &&
+           group -> address.host == datagram -> address.host &&
+           group -> address.port == datagram -> address.port &&
+           datagram -> dataLength <= group -> segmentSize &&
+           group -> dataLength + datagram -> dataLength <= ENET_HOST_SEGMENT_DATA_MAXIMUM &&
+           group -> bufferCount + datagram -> bufferCount <= ENET_HOST_SEGMENT_BUFFER_MAXIMUM &&
+           segmentCount < ENET_HOST_SEGMENT_COUNT_MAXIMUM)
+       {
+          group -> bufferCount += datagram -> bufferCount;
+          group -> dataLength += datagram -> dataLength;
+
+          ++ segmentCount;
+
+          if (datagram -> dataLength < group -> segmentSize)
+            group = NULL;
+
+          continue;
+       }
+
+       group = nextGroup ++;
+       * group = * datagram;
+       group -> segmentSize = group -> dataLength;
+       segmentCount = 1;
+    }
+
+    for (datagram = host -> sendDatagrams; datagram < nextGroup; ++ datagram)
+    {
+       if (datagram -> segmentSize >= datagram -> dataLength)
+         datagram -> segmentSize = 0;
+    }
+
+    return nextGroup - host -> sendDatagrams;
+}
+
+static int
+enet_protocol_send_segments (ENetHost * host, const ENetDatagram * datagram)
+{
+    const ENetBuffer * buffer = datagram -> buffers,
+                     * bufferEnd = & datagram -> buffers [datagram -> bufferCount];
+
+    while (buffer < bufferEnd)
+    {
+       const ENetBuffer * segment = buffer;
+       size_t segmentLength = 0;
+       int sentLength;
+
+       do
+       {
+          segmentLength += buffer -> dataLength;
+
+          ++ buffer;
+       } while (buffer < bufferEnd && segmentLength < datagram -> segmentSize);
+
+       sentLength = enet_socket_send (host -> socket, & datagram -> address, segment, buffer - segment);
+
+       ++ host -> totalSendCalls;
+
+       if (sentLength < 0)
+         return -1;
+
+       host -> totalSentData += sentLength;
+       host -> totalSentPackets ++;
+    }
+
+    return 0;
+}
+
+static int
+enet_protocol_flush_staged_datagrams (ENetHost * host)
+{
+    size_t datagramCount = host -> stagedDatagramCount,
+           datagramIndex = 0;
+    int result = 0;
+
+    if (host -> segmentationOffload & ENET_SEGMENTATION_OFFLOAD_SEND)
+      datagramCount = enet_protocol_coalesce_staged_datagrams (host);
+
+    while (datagramIndex < datagramCount)
+    {
+       ENetDatagram * datagram = & host -> sendDatagrams [datagramIndex];
+       int sentCount = enet_socket_send_multiple (host -> socket, datagram, datagramCount - datagramIndex);
+
+       ++ host -> totalSendCalls;
+
+       if (sentCount < 0)
+       {
+          if (datagram -> segmentSize == 0)
+          {
+             result = -1;
+
+             break;
+          }
+
+          /* The system refused the segmented send, so stop using segmentation offload. */
+          host -> segmentationOffload &= ~ ENET_SEGMENTATION_OFFLOAD_SEND;
+
+          if (enet_protocol_send_segments (host, datagram) < 0)
+          {
+             result = -1;
+
+             break;
+          }
+
+          ++ datagramIndex;
+
+          continue;
+       }
+
+       /* A datagram that would block is dropped, just as an unbatched send drops it. */
+       if (sentCount == 0)
+       {
+          host -> totalSentPackets += datagram -> segmentSize > 0 ? (datagram -> dataLength + datagram -> segmentSize - 1) / datagram -> segmentSize : 1;
+
+          ++ datagramIndex;
+
+          continue;
+       }
+
+       for (; sentCount > 0; -- sentCount, ++ datagramIndex, ++ datagram)
+       {
+          host -> totalSentData += datagram -> dataLength;
+          host -> totalSentPackets += datagram -> segmentSize > 0 ? (datagram -> dataLength + datagram -> segmentSize - 1) / datagram -> segmentSize : 1;
+       }
+    }
+
+    for (datagramIndex = 0; datagramIndex < host -> stagedDatagramCount; ++ datagramIndex)
+    {
+       ENetPeer * peer = host -> stagedDatagrams [datagramIndex].peer;
+
+       if (! (peer -> flags & ENET_PEER_FLAG_SEND_STAGED))
+         continue;
+
+       peer -> flags &= ~ ENET_PEER_FLAG_SEND_STAGED;
+
+       enet_protocol_remove_sent_unreliable_commands (peer);
+    }
+
+    host -> stagedDatagramCount = 0;
+    host -> stagedBufferCount = 0;
+
+    return result;
+}
+
+/** Puts the peers visited by a send pass back on the send queue at position. */
+static void
+enet_protocol_requeue_visited_peers (ENetHost * host, ENetListIterator position)
+{
+    if (! enet_list_empty (& host -> sendVisited))
+      enet_list_move (position, enet_list_front (& host -> sendVisited), enet_list_back (& host -> sendVisited));
+}
+
+/** Takes a peer off the send queue once a send pass leaves it with nothing to send, and arms
+    its timer for the next retransmit timeout or ping.
+*/
+static void
+enet_protocol_retire_sent_peer (ENetPeer * peer)
+{
+    if (! (peer -> flags & ENET_PEER_FLAG_NEEDS_SEND))
+      return;
+
+    enet_peer_schedule_timer (peer);
+
+    if (peer -> state != ENET_PEER_STATE_DISCONNECTED &&
+        peer -> state != ENET_PEER_STATE_ZOMBIE &&
+        (! enet_list_empty (& peer -> acknowledgements) ||
+          ! enet_list_empty (& peer -> outgoingCommands)))
+      return;
+
+    enet_list_remove (& peer -> sendList);
+
+    peer -> flags &= ~ ENET_PEER_FLAG_NEEDS_SEND;
+}
+
+/** Queues the peers whose retransmit timeout, ping or pacing deadline came due. */
+static void
+enet_protocol_expire_timers (ENetHost * host)
+{
+    ENetTimer * timer;
+
+    enet_timer_wheel_advance (& host -> timers, host -> serviceTime);
+
+    while ((timer = enet_timer_wheel_pop_expired (& host -> timers)) != NULL)
+      enet_peer_schedule_send (ENET_CONTAINER_OF (timer, ENetPeer, timer));
+}
+
+/** Tops up the peer's pacing credit at its congestion controller's pacing rate and, while the
+    credit is spent, holds back its data with ENET_PEER_FLAG_PACED until pacingDeadline. At most
+    ENET_PEER_PACING_QUANTUM worth is banked, since the service loop cannot wake any finer.
+*/
+static void
+enet_protocol_update_pacing (ENetHost * host, ENetPeer * peer)
+{
+    ENetCongestion * congestion = & peer -> congestion;
+    enet_uint32 elapsed, wait;
+    long long credit, added, burst;
+
+    if (congestion -> pacingRate == 0)
+    {
+        peer -> flags &= ~ ENET_PEER_FLAG_PACED;
+
+        return;
+    }
+
+    burst = ENET_MAX ((long long) congestion -> pacingRate * ENET_PEER_PACING_QUANTUM / 1000000, 2 * (long long) peer -> mtu);
+    elapsed = ENET_MIN (host -> serviceTimeMicroseconds - congestion -> pacingTime, 1000000);
+    added = (long long) congestion -> pacingRate * elapsed / 1000000;
+    credit = congestion -> pacingCredit + added;
+
+    if (credit >= burst)
+    {
+        credit = burst;
+        congestion -> pacingTime = host -> serviceTimeMicroseconds;
+    }
+    else
+      /* Only the time turned into whole bytes is used up, so slow rates still accrue credit. */
+      congestion -> pacingTime += (enet_uint32) (added * 1000000 / congestion -> pacingRate);
+
+    congestion -> pacingCredit = (int) credit;
+
+    if (credit > 0)
+    {
+        peer -> flags &= ~ ENET_PEER_FLAG_PACED;
+
+        return;
+    }
+
+    wait = (enet_uint32) ((1 - credit) * 1000000 / congestion -> pacingRate);
+
+    congestion -> pacingDeadline = host -> serviceTime + (wait + 999) / 1000;
+
+    peer -> flags |= ENET_PEER_FLAG_PACED;
+}
+
 static int
 enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
 {
@@ -1573,42 +2631,65 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
     int sentLength;
     size_t shouldCompress = 0;
  
+    /* A pass that returned early for an event leaves its visited peers behind; they go first. */
+    enet_protocol_requeue_visited_peers (host, enet_list_begin (& host -> sendQueue));
+
+    if (checkForTimeouts != 0)
+      enet_protocol_expire_timers (host);
+
     host -> continueSending = 1;
 
     while (host -> continueSending)
     for (host -> continueSending = 0,
-           currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
-         ++ currentPeer)
+           enet_protocol_requeue_visited_peers (host, enet_list_end (& host -> sendQueue));
+         ! enet_list_empty (& host -> sendQueue);
+         enet_protocol_retire_sent_peer (currentPeer))
     {
+        currentPeer = ENET_CONTAINER_OF (enet_list_front (& host -> sendQueue), ENetPeer, sendList);
+
+        enet_list_move (enet_list_end (& host -> sendVisited), & currentPeer -> sendList, & currentPeer -> sendList);
+
         if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED ||
             currentPeer -> state == ENET_PEER_STATE_ZOMBIE)
           continue;
 
+sendPeer:
         host -> headerFlags = 0;
         host -> commandCount = 0;
         host -> bufferCount = 1;
         host -> packetSize = sizeof (ENetProtocolHeader);
 
+        enet_protocol_update_pacing (host, currentPeer);
+
         if (! enet_list_empty (& currentPeer -> acknowledgements))
           enet_protocol_send_acknowledgements (host, currentPeer);
 
         if (checkForTimeouts != 0 &&
             ! enet_list_empty (& currentPeer -> sentReliableCommands) &&
-            ENET_TIME_GREATER_EQUAL (host -> serviceTime, currentPeer -> nextTimeout) &&
-            enet_protocol_check_timeouts (host, currentPeer, event) == 1)
+            ENET_TIME_GREATER_EQUAL (host -> serviceTime, currentPeer -> nextTimeout))
         {
-            if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
-              return 1;
-            else
-              continue;
+            /* A timed out peer is reset, so its staged datagrams must go out first. */
+            if (currentPeer -> flags & ENET_PEER_FLAG_SEND_STAGED &&
+                enet_protocol_flush_staged_datagrams (host) < 0)
+              return -1;
+
+            if (enet_protocol_check_timeouts (host, currentPeer, event) == 1)
+            {
+                if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
+                  return enet_protocol_flush_staged_datagrams (host) < 0 ? -1 : 1;
+                else
+                  continue;
+            }
         }
 
+        if (host -> probeMtu != 0 && currentPeer -> state == ENET_PEER_STATE_CONNECTED)
+          enet_protocol_probe_mtu (host, currentPeer);
+
         if ((enet_list_empty (& currentPeer -> outgoingCommands) ||
               enet_protocol_check_outgoing_commands (host, currentPeer)) &&
             enet_list_empty (& currentPeer -> sentReliableCommands) &&
             ENET_TIME_DIFFERENCE (host -> serviceTime, currentPeer -> lastReceiveTime) >= currentPeer -> pingInterval &&
-            currentPeer -> mtu - host -> packetSize >= sizeof (ENetProtocolPing))
+            host -> packetSize + sizeof (ENetProtocolPing) <= currentPeer -> mtu)
         { 
             enet_peer_ping (currentPeer);
             enet_protocol_check_outgoing_commands (host, currentPeer);
@@ -1626,7 +2707,7 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
            enet_uint32 packetLoss = currentPeer -> packetsLost * ENET_PEER_PACKET_LOSS_SCALE / currentPeer -> packetsSent;
 
 #ifdef ENET_DEBUG
-           printf ("peer %u: %f%%+-%f%% packet loss, %u+-%u ms round trip time, %f%% throttle, %u outgoing, %u/%u incoming\n", currentPeer -> incomingPeerID, currentPeer -> packetLoss / (float) ENET_PEER_PACKET_LOSS_SCALE, currentPeer -> packetLossVariance / (float) ENET_PEER_PACKET_LOSS_SCALE, currentPeer -> roundTripTime, currentPeer -> roundTripTimeVariance, currentPeer -> packetThrottle / (float) ENET_PEER_PACKET_THROTTLE_SCALE, enet_list_size (& currentPeer -> outgoingCommands), currentPeer -> channels != NULL ? enet_list_size (& currentPeer -> channels -> incomingReliableCommands) : 0, currentPeer -> channels != NULL ? enet_list_size (& currentPeer -> channels -> incomingUnreliableCommands) : 0);
+           printf ("peer %u: %f%%+-%f%% packet loss, %u+-%u ms round trip time, %f%% throttle, %u outgoing, %u/%u incoming\n", currentPeer -> incomingPeerID, currentPeer -> packetLoss / (float) ENET_PEER_PACKET_LOSS_SCALE, currentPeer -> packetLossVariance / (float) ENET_PEER_PACKET_LOSS_SCALE, currentPeer -> roundTripTime, currentPeer -> roundTripTimeVariance, currentPeer -> packetThrottle / (float) ENET_PEER_PACKET_THROTTLE_SCALE, enet_list_size (& currentPeer -> outgoingCommands), currentPeer -> channels != NULL ? currentPeer -> channels -> incomingReliableCount : 0, currentPeer -> channels != NULL ? enet_list_size (& currentPeer -> channels -> incomingUnreliableCommands) : 0);
 #endif
 
            currentPeer -> packetLossVariance = (currentPeer -> packetLossVariance * 3 + ENET_DIFFERENCE (packetLoss, currentPeer -> packetLoss)) / 4;
@@ -1648,22 +2729,12 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
           host -> buffers -> dataLength = (size_t) & ((ENetProtocolHeader *) 0) -> sentTime;
 
         shouldCompress = 0;
-        if (host -> compressor.context != NULL && host -> compressor.compress != NULL)
+        if (host -> compressor.context != NULL && host -> compressor.compress != NULL &&
+            ! (currentPeer -> flags & ENET_PEER_FLAG_MTU_PROBE))
         {
-            size_t originalSize = host -> packetSize - sizeof(ENetProtocolHeader),
-                   compressedSize = host -> compressor.compress (host -> compressor.context,
-                                        & host -> buffers [1], host -> bufferCount - 1,
-                                        originalSize,
-                                        host -> packetData [1],
-                                        originalSize);
-            if (compressedSize > 0 && compressedSize < originalSize)
-            {
-                host -> headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
-                shouldCompress = compressedSize;
-#ifdef ENET_DEBUG_COMPRESS
-                printf ("peer %u: compressed %u -> %u (%u%%)\n", currentPeer -> incomingPeerID, originalSize, compressedSize, (compressedSize * 100) / originalSize);
-#endif
-            }
+            shouldCompress = enet_protocol_compress_datagram (host, currentPeer);
+            if (shouldCompress > 0)
+              host -> headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
         }
 
         if (currentPeer -> outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID)
@@ -1686,8 +2757,73 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
 
         currentPeer -> lastSendTime = host -> serviceTime;
 
+        if (currentPeer -> congestion.pacingRate != 0)
+          currentPeer -> congestion.pacingCredit -= (int) host -> packetSize;
+
+        if (currentPeer -> flags & ENET_PEER_FLAG_MTU_PROBE)
+        {
+            /* A probe is sent right away with fragmentation forbidden, so that an acknowledgement
+               shows the path carries its size whole. No unreliable commands go with it. */
+            int dontFragment;
+
+            currentPeer -> flags &= ~ ENET_PEER_FLAG_MTU_PROBE;
+
+            /* Without the bit the probe could get through in pieces, so it is dropped like a lost
+               datagram instead, and probing stops. */
+            if (enet_socket_get_option (host -> socket, ENET_SOCKOPT_DONTFRAGMENT, & dontFragment) < 0 ||
+                enet_socket_set_option (host -> socket, ENET_SOCKOPT_DONTFRAGMENT, 1) < 0)
+            {
+                host -> probeMtu = 0;
+
+                continue;
+            }
+
+            sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
+
+            ++ host -> totalSendCalls;
+
+            if (enet_socket_set_option (host -> socket, ENET_SOCKOPT_DONTFRAGMENT, dontFragment) < 0)
+            {
+                host -> probeMtu = 0;
+                sentLength = -1;
+            }
+
+            if (sentLength < 0)
+            {
+                if (host -> stagedDatagramCount > 0)
+                  enet_protocol_flush_staged_datagrams (host);
+
+                return -1;
+            }
+
+            host -> totalSentData += sentLength;
+            host -> totalSentPackets ++;
+
+            continue;
+        }
+
+        if (host -> sendBatchLimit > 0)
+        {
+            enet_protocol_stage_datagram (host, currentPeer);
+
+            if (host -> stagedDatagramCount >= host -> sendBatchLimit &&
+                enet_protocol_flush_staged_datagrams (host) < 0)
+              return -1;
+
+            /* Keep building this peer's datagrams back to back so that a fragment train can be
+               coalesced into one segmented send. */
+            if (host -> segmentationOffload & ENET_SEGMENTATION_OFFLOAD_SEND &&
+                (! enet_list_empty (& currentPeer -> outgoingCommands) ||
+                  ! enet_list_empty (& currentPeer -> acknowledgements)))
+              goto sendPeer;
+
+            continue;
+        }
+
         sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
 
+        ++ host -> totalSendCalls;
+
         enet_protocol_remove_sent_unreliable_commands (currentPeer);
 
         if (sentLength < 0)
@@ -1696,10 +2832,39 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
         host -> totalSentData += sentLength;
         host -> totalSentPackets ++;
     }
+
+    enet_protocol_requeue_visited_peers (host, enet_list_end (& host -> sendQueue));
+
+    if (host -> stagedDatagramCount > 0)
+      return enet_protocol_flush_staged_datagrams (host);
    
     return 0;
 }
 
+/** Returns how long enet_host_service() may sleep on the socket without missing a
+    retransmit, ping, pacing or bandwidth throttle deadline, at most timeout milliseconds.
+*/
+static enet_uint32
+enet_protocol_wait_timeout (ENetHost * host, enet_uint32 timeout)
+{
+    enet_uint32 deadline = host -> serviceTime + timeout, throttleDeadline;
+
+    if (host -> connectedPeers > 0)
+    {
+        throttleDeadline = host -> bandwidthThrottleEpoch + ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL;
+        if (ENET_TIME_LESS (throttleDeadline, deadline))
+          deadline = throttleDeadline;
+    }
+
+    deadline = enet_timer_wheel_deadline (& host -> timers, deadline);
+
+    /* A deadline the send pass just declined to act on must not turn the wait into a spin. */
+    if (ENET_TIME_LESS_EQUAL (deadline, host -> serviceTime))
+      return timeout < 1 ? timeout : 1;
+
+    return ENET_TIME_DIFFERENCE (deadline, host -> serviceTime);
+}
+
 /** Sends any queued packets on the host specified to its designated peers.
 
     @param host   host to flush
@@ -1709,7 +2874,7 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
 void
 enet_host_flush (ENetHost * host)
 {
-    host -> serviceTime = enet_time_get ();
+    host -> serviceTime = enet_time_get_precise (& host -> serviceTimeMicroseconds);
 
     enet_protocol_send_outgoing_commands (host, NULL, 0);
 }
@@ -1743,15 +2908,16 @@ enet_host_check_events (ENetHost * host, ENetEvent * event)
                    if event == NULL then no events will be delivered
     @param timeout number of milliseconds that ENet should wait for events
     @retval > 0 if an event occurred within the specified time limit
-    @retval 0 if no event occurred
+    @retval 0 if no event occurred, or the host was woken by enet_host_wakeup()
     @retval < 0 on failure
-    @remarks enet_host_service should be called fairly regularly for adequate performance
+    @remarks enet_host_service should be called fairly regularly for adequate performance.
+    Long timeouts are safe: the wait never extends past the next retransmit, ping or pacing deadline.
     @ingroup host
 */
 int
 enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
 {
-    enet_uint32 waitCondition;
+    enet_uint32 waitCondition, waitTimeout;
 
     if (event != NULL)
     {
@@ -1776,7 +2942,7 @@ enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
         }
     }
 
-    host -> serviceTime = enet_time_get ();
+    host -> serviceTime = enet_time_get_precise (& host -> serviceTimeMicroseconds);
     
     timeout += host -> serviceTime;
 
@@ -1857,19 +3023,48 @@ enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
 
        do
        {
-          host -> serviceTime = enet_time_get ();
+          host -> serviceTime = enet_time_get_precise (& host -> serviceTimeMicroseconds);
 
           if (ENET_TIME_GREATER_EQUAL (host -> serviceTime, timeout))
             return 0;
 
           waitCondition = ENET_SOCKET_WAIT_RECEIVE | ENET_SOCKET_WAIT_INTERRUPT;
 
-          if (enet_socket_wait (host -> socket, & waitCondition, ENET_TIME_DIFFERENCE (timeout, host -> serviceTime)) != 0)
+          /* Datagrams still queued from the last batched receive must not wait on the socket. */
+          if (host -> receivedDatagramIndex < host -> receivedDatagramCount)
+          {
+             waitCondition = ENET_SOCKET_WAIT_RECEIVE;
+             break;
+          }
+
+          waitTimeout = enet_protocol_wait_timeout (host, ENET_TIME_DIFFERENCE (timeout, host -> serviceTime));
+
+          if (host -> wakeupSocket != ENET_SOCKET_NULL)
+          {
+             if (enet_socket_wait_interruptible (host -> socket, host -> wakeupSocket, & waitCondition, waitTimeout) != 0)
+               return -1;
+
+             if (waitCondition & ENET_SOCKET_WAIT_INTERRUPT)
+             {
+                enet_socket_drain_wakeup (host -> wakeupSocket);
+
+                return 0;
+             }
+          }
+          else
+          if (enet_socket_wait (host -> socket, & waitCondition, waitTimeout) != 0)
             return -1;
+
+          /* A retransmit, ping, pacing or throttle deadline came due before the caller's timeout,
+           * so go around again to let the send pass handle it.
+           */
+          if (waitCondition == ENET_SOCKET_WAIT_NONE &&
+              waitTimeout < ENET_TIME_DIFFERENCE (timeout, host -> serviceTime))
+            waitCondition = ENET_SOCKET_WAIT_RECEIVE;
        }
        while (waitCondition & ENET_SOCKET_WAIT_INTERRUPT);
 
-       host -> serviceTime = enet_time_get ();
+       host -> serviceTime = enet_time_get_precise (& host -> serviceTimeMicroseconds);
     } while (waitCondition & ENET_SOCKET_WAIT_RECEIVE);
 
     return 0; 
@@ -10,10 +10,20 @@
 enum
 {
    ENET_PROTOCOL_MINIMUM_MTU             = 576,
+#ifdef ENET_JUMBO_FRAMES
+   /* a 9000 byte jumbo frame less the IPv4 and UDP headers; only used with peers that offer
+      ENET_PROTOCOL_CAPABILITY_JUMBO_FRAMES */
+   ENET_PROTOCOL_MAXIMUM_MTU             = 8972,
+#else
    ENET_PROTOCOL_MAXIMUM_MTU             = 4096,
+#endif
+   /* the largest datagram every host can receive, whatever it was built with */
+   ENET_PROTOCOL_STANDARD_MAXIMUM_MTU    = 4096,
    ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS = 32,
    ENET_PROTOCOL_MINIMUM_WINDOW_SIZE     = 4096,
    ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE     = 65536,
+   /* only used with peers that advertise a window above ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE when connecting */
+   ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE = 32 * 1024 * 1024,
    ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT   = 1,
    ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT   = 255,
    ENET_PROTOCOL_MAXIMUM_PEER_ID         = 0xFFF,
@@ -35,7 +45,10 @@ typedef enum _ENetProtocolCommand
    ENET_PROTOCOL_COMMAND_BANDWIDTH_LIMIT    = 10,
    ENET_PROTOCOL_COMMAND_THROTTLE_CONFIGURE = 11,
    ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT = 12,
-   ENET_PROTOCOL_COMMAND_COUNT              = 13,
+   ENET_PROTOCOL_COMMAND_CONNECT_COOKIE     = 13,
+   ENET_PROTOCOL_COMMAND_CAPABILITIES       = 14,
+   ENET_PROTOCOL_COMMAND_SELECTIVE_ACKNOWLEDGE = 15,
+   ENET_PROTOCOL_COMMAND_COUNT              = 16,
 
    ENET_PROTOCOL_COMMAND_MASK               = 0x0F
 } ENetProtocolCommand;
@@ -53,6 +66,20 @@ typedef enum _ENetProtocolFlag
    ENET_PROTOCOL_HEADER_SESSION_SHIFT   = 12
 } ENetProtocolFlag;
 
+/** Protocol extensions a host may offer in an ENetProtocolCapabilities command. */
+typedef enum _ENetProtocolCapability
+{
+   ENET_PROTOCOL_CAPABILITY_SELECTIVE_ACKNOWLEDGE = (1 << 0),
+   /* receives datagrams of up to a jumbo frame, set by hosts built with ENET_JUMBO_FRAMES */
+   ENET_PROTOCOL_CAPABILITY_JUMBO_FRAMES          = (1 << 1),
+
+#ifdef ENET_JUMBO_FRAMES
+   ENET_PROTOCOL_CAPABILITY_ALL = ENET_PROTOCOL_CAPABILITY_SELECTIVE_ACKNOWLEDGE | ENET_PROTOCOL_CAPABILITY_JUMBO_FRAMES
+#else
+   ENET_PROTOCOL_CAPABILITY_ALL = ENET_PROTOCOL_CAPABILITY_SELECTIVE_ACKNOWLEDGE
+#endif
+} ENetProtocolCapability;
+
 #ifdef _MSC_VER
 #pragma pack(push, 1)
 #define ENET_PACKED
@@ -82,6 +109,18 @@ typedef struct _ENetProtocolAcknowledge
    enet_uint16 receivedSentTime;
 } ENET_PACKED ENetProtocolAcknowledge;
 
+/** Acknowledges reliableSequenceNumber on channelID along with every later sequence number whose
+    bit is set in receivedReliableSequenceMask, bit n standing for reliableSequenceNumber + n + 1.
+    All of them arrived in datagrams stamped with receivedSentTime. Only sent to a foreign host
+    that offered ENET_PROTOCOL_CAPABILITY_SELECTIVE_ACKNOWLEDGE.
+*/
+typedef struct _ENetProtocolSelectiveAcknowledge
+{
+   ENetProtocolCommandHeader header;
+   enet_uint16 receivedSentTime;
+   enet_uint32 receivedReliableSequenceMask;
+} ENET_PACKED ENetProtocolSelectiveAcknowledge;
+
 typedef struct _ENetProtocolConnect
 {
    ENetProtocolCommandHeader header;
@@ -100,6 +139,27 @@ typedef struct _ENetProtocolConnect
    enet_uint32 data;
 } ENET_PACKED ENetProtocolConnect;
 
+/** Sent by a host that requires connect cookies in answer to a connect without a valid one,
+    and echoed back by the connecting peer just ahead of its next connect.
+*/
+typedef struct _ENetProtocolConnectCookie
+{
+   ENetProtocolCommandHeader header;
+   enet_uint32 connectID;
+   enet_uint32 cookie [2];
+} ENET_PACKED ENetProtocolConnectCookie;
+
+/** Sent right after a connect, and after the verify connect answering one that carried it, with
+    the ENetProtocolCapability extensions the sender offers. Hosts that predate it stop reading
+    the datagram there, having already handled the connect, so the extensions stay off.
+*/
+typedef struct _ENetProtocolCapabilities
+{
+   ENetProtocolCommandHeader header;
+   enet_uint32 connectID;
+   enet_uint32 capabilities;
+} ENET_PACKED ENetProtocolCapabilities;
+
 typedef struct _ENetProtocolVerifyConnect
 {
    ENetProtocolCommandHeader header;
@@ -178,7 +238,10 @@ typedef union _ENetProtocol
 {
    ENetProtocolCommandHeader header;
    ENetProtocolAcknowledge acknowledge;
+   ENetProtocolSelectiveAcknowledge selectiveAcknowledge;
    ENetProtocolConnect connect;
+   ENetProtocolConnectCookie connectCookie;
+   ENetProtocolCapabilities capabilities;
    ENetProtocolVerifyConnect verifyConnect;
    ENetProtocolDisconnect disconnect;
    ENetProtocolPing ping;
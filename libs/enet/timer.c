@@ -0,0 +1,250 @@
+/**
+ @file timer.c
+ @brief ENet hierarchical timer wheel
+*/
+#define ENET_BUILDING_LIB 1
+#include "enet/utility.h"
+#include "enet/time.h"
+#include "enet/enet.h"
+
+/**
+    @defgroup timer ENet timer wheel functions
+    @ingroup private
+    @{
+*/
+
+/* Slot occupancy is tracked with one bit per slot, so a level has exactly 32 slots. */
+static enet_uint32
+enet_timer_rotate_left (enet_uint32 bits, enet_uint32 count)
+{
+    count &= ENET_TIMER_WHEEL_MASK;
+
+    return count ? (bits << count) | (bits >> (ENET_TIMER_WHEEL_SLOTS - count)) : bits;
+}
+
+static enet_uint32
+enet_timer_rotate_right (enet_uint32 bits, enet_uint32 count)
+{
+    count &= ENET_TIMER_WHEEL_MASK;
+
+    return count ? (bits >> count) | (bits << (ENET_TIMER_WHEEL_SLOTS - count)) : bits;
+}
+
+/* bits must not be 0 */
+static enet_uint32
+enet_timer_first_slot (enet_uint32 bits)
+{
+#ifdef __GNUC__
+    return __builtin_ctz (bits);
+#else
+    enet_uint32 slot = 0;
+
+    while (! (bits & 1))
+    {
+        bits >>= 1;
+        ++ slot;
+    }
+
+    return slot;
+#endif
+}
+
+void
+enet_timer_wheel_initialize (ENetTimerWheel * wheel, enet_uint32 currentTime)
+{
+    int level, slot;
+
+    wheel -> currentTime = currentTime;
+    wheel -> timerCount = 0;
+
+    for (level = 0; level < ENET_TIMER_WHEEL_LEVELS; ++ level)
+    {
+        wheel -> occupiedSlots [level] = 0;
+
+        for (slot = 0; slot < ENET_TIMER_WHEEL_SLOTS; ++ slot)
+          enet_list_clear (& wheel -> slots [level] [slot]);
+    }
+
+    enet_list_clear (& wheel -> expiredTimers);
+}
+
+/* Files the timer under the level whose slot width fits the time left. Slots above level 0 are
+   filed one slot early so the timer is cascaded down before its deadline rather than after. */
+static void
+enet_timer_wheel_insert (ENetTimerWheel * wheel, ENetTimer * timer)
+{
+    enet_uint32 remaining, level, slot;
+
+    if (ENET_TIME_LESS_EQUAL (timer -> deadline, wheel -> currentTime))
+    {
+        timer -> level = ENET_TIMER_LEVEL_EXPIRED;
+
+        enet_list_insert (enet_list_end (& wheel -> expiredTimers), & timer -> timerList);
+
+        return;
+    }
+
+    remaining = ENET_MIN (timer -> deadline - wheel -> currentTime, ENET_TIMER_WHEEL_RANGE_MAXIMUM);
+
+    for (level = 0; remaining >> ((level + 1) * ENET_TIMER_WHEEL_BITS); ++ level)
+      ;
+
+    slot = (((wheel -> currentTime + remaining) >> (level * ENET_TIMER_WHEEL_BITS)) - (level > 0)) & ENET_TIMER_WHEEL_MASK;
+
+    timer -> level = level;
+    timer -> slot = slot;
+
+    enet_list_insert (enet_list_end (& wheel -> slots [level] [slot]), & timer -> timerList);
+
+    wheel -> occupiedSlots [level] |= 1u << slot;
+}
+
+/** Schedules timer to expire at deadline, moving it if it was already scheduled. */
+void
+enet_timer_wheel_schedule (ENetTimerWheel * wheel, ENetTimer * timer, enet_uint32 deadline)
+{
+    if (enet_timer_scheduled (timer))
+    {
+        if (timer -> deadline == deadline)
+          return;
+
+        enet_timer_wheel_cancel (wheel, timer);
+    }
+
+    timer -> deadline = deadline;
+
+    enet_timer_wheel_insert (wheel, timer);
+
+    ++ wheel -> timerCount;
+}
+
+void
+enet_timer_wheel_cancel (ENetTimerWheel * wheel, ENetTimer * timer)
+{
+    if (! enet_timer_scheduled (timer))
+      return;
+
+    enet_list_remove (& timer -> timerList);
+
+    if (timer -> level < ENET_TIMER_WHEEL_LEVELS &&
+        enet_list_empty (& wheel -> slots [timer -> level] [timer -> slot]))
+      wheel -> occupiedSlots [timer -> level] &= ~ (1u << timer -> slot);
+
+    timer -> level = ENET_TIMER_LEVEL_UNSCHEDULED;
+
+    -- wheel -> timerCount;
+}
+
+/** Moves the wheel's clock forward to currentTime. Timers whose deadline has passed become
+    available from enet_timer_wheel_pop_expired(); timers in the slots passed over at higher
+    levels are filed again closer to their deadline.
+*/
+void
+enet_timer_wheel_advance (ENetTimerWheel * wheel, enet_uint32 currentTime)
+{
+    enet_uint32 elapsed, levelElapsed, oldSlot, newSlot, passedSlots, slot;
+    ENetList cascade;
+    int level;
+
+    if (ENET_TIME_LESS_EQUAL (currentTime, wheel -> currentTime))
+      return;
+
+    elapsed = currentTime - wheel -> currentTime;
+
+    enet_list_clear (& cascade);
+
+    for (level = 0; level < ENET_TIMER_WHEEL_LEVELS; ++ level)
+    {
+        if ((elapsed >> (level * ENET_TIMER_WHEEL_BITS)) > ENET_TIMER_WHEEL_MASK)
+          passedSlots = ~ 0u;
+        else
+        {
+            levelElapsed = (elapsed >> (level * ENET_TIMER_WHEEL_BITS)) & ENET_TIMER_WHEEL_MASK;
+            oldSlot = (wheel -> currentTime >> (level * ENET_TIMER_WHEEL_BITS)) & ENET_TIMER_WHEEL_MASK;
+            newSlot = (currentTime >> (level * ENET_TIMER_WHEEL_BITS)) & ENET_TIMER_WHEEL_MASK;
+
+            passedSlots = enet_timer_rotate_left ((1u << levelElapsed) - 1, oldSlot);
+            passedSlots |= enet_timer_rotate_right (enet_timer_rotate_left ((1u << levelElapsed) - 1, newSlot), levelElapsed);
+            passedSlots |= 1u << newSlot;
+        }
+
+        while (passedSlots & wheel -> occupiedSlots [level])
+        {
+            ENetList * timers;
+
+            slot = enet_timer_first_slot (passedSlots & wheel -> occupiedSlots [level]);
+            timers = & wheel -> slots [level] [slot];
+
+            enet_list_move (enet_list_end (& cascade), enet_list_front (timers), enet_list_back (timers));
+
+            wheel -> occupiedSlots [level] &= ~ (1u << slot);
+        }
+
+        /* The next level only moves if this one wrapped around. */
+        if (! (passedSlots & 1))
+          break;
+
+        elapsed = ENET_MAX (elapsed, (enet_uint32) ENET_TIMER_WHEEL_SLOTS << (level * ENET_TIMER_WHEEL_BITS));
+    }
+
+    wheel -> currentTime = currentTime;
+
+    while (! enet_list_empty (& cascade))
+    {
+        ENetTimer * timer = ENET_CONTAINER_OF (enet_list_remove (enet_list_begin (& cascade)), ENetTimer, timerList);
+
+        enet_timer_wheel_insert (wheel, timer);
+    }
+}
+
+/** Returns the next expired timer, unscheduled, or NULL if none are left. */
+ENetTimer *
+enet_timer_wheel_pop_expired (ENetTimerWheel * wheel)
+{
+    ENetTimer * timer;
+
+    if (enet_list_empty (& wheel -> expiredTimers))
+      return NULL;
+
+    timer = ENET_CONTAINER_OF (enet_list_remove (enet_list_begin (& wheel -> expiredTimers)), ENetTimer, timerList);
+    timer -> level = ENET_TIMER_LEVEL_UNSCHEDULED;
+
+    -- wheel -> timerCount;
+
+    return timer;
+}
+
+/** Returns the earliest time the wheel needs advancing, or deadline if that comes first.
+    For timers above level 0 this is when they cascade, which is never after they expire.
+*/
+enet_uint32
+enet_timer_wheel_deadline (ENetTimerWheel * wheel, enet_uint32 deadline)
+{
+    enet_uint32 lowerBits = 0, slot, timeout, wheelDeadline;
+    int level;
+
+    if (! enet_list_empty (& wheel -> expiredTimers))
+      return ENET_TIME_LESS (deadline, wheel -> currentTime) ? deadline : wheel -> currentTime;
+
+    for (level = 0; level < ENET_TIMER_WHEEL_LEVELS; ++ level)
+    {
+        if (wheel -> occupiedSlots [level])
+        {
+            slot = (wheel -> currentTime >> (level * ENET_TIMER_WHEEL_BITS)) & ENET_TIMER_WHEEL_MASK;
+
+            /* A higher level slot is reached once every lower level has wrapped around. */
+            timeout = (enet_timer_first_slot (enet_timer_rotate_right (wheel -> occupiedSlots [level], slot)) + (level > 0)) << (level * ENET_TIMER_WHEEL_BITS);
+            timeout -= wheel -> currentTime & lowerBits;
+
+            wheelDeadline = wheel -> currentTime + timeout;
+            if (ENET_TIME_LESS (wheelDeadline, deadline))
+              deadline = wheelDeadline;
+        }
+
+        lowerBits = (lowerBits << ENET_TIMER_WHEEL_BITS) | ENET_TIMER_WHEEL_MASK;
+    }
+
+    return deadline;
+}
+
+/** @} */
@@ -0,0 +1,58 @@
+/**
+ @file  timer.h
+ @brief ENet hierarchical timer wheel
+*/
+#ifndef __ENET_TIMER_H__
+#define __ENET_TIMER_H__
+
+#include "enet/types.h"
+#include "enet/list.h"
+
+enum
+{
+   ENET_TIMER_WHEEL_BITS   = 5,
+   ENET_TIMER_WHEEL_SLOTS  = (1 << ENET_TIMER_WHEEL_BITS),
+   ENET_TIMER_WHEEL_MASK   = ENET_TIMER_WHEEL_SLOTS - 1,
+   ENET_TIMER_WHEEL_LEVELS = 5,
+   /* deadlines further out than this are parked at the top level and re-sorted when it comes around */
+   ENET_TIMER_WHEEL_RANGE_MAXIMUM = (1 << (ENET_TIMER_WHEEL_BITS * ENET_TIMER_WHEEL_LEVELS)) - 1,
+
+   ENET_TIMER_LEVEL_EXPIRED     = ENET_TIMER_WHEEL_LEVELS,
+   ENET_TIMER_LEVEL_UNSCHEDULED = 0xFF
+};
+
+/** A deadline embedded in the structure it belongs to, like an ENetListNode. */
+typedef struct _ENetTimer
+{
+   ENetListNode timerList;
+   enet_uint32  deadline;
+   enet_uint8   level;
+   enet_uint8   slot;
+} ENetTimer;
+
+/** Timers are kept in ENET_TIMER_WHEEL_LEVELS wheels of ENET_TIMER_WHEEL_SLOTS slots, level n
+    slots being ENET_TIMER_WHEEL_SLOTS^n milliseconds wide. Scheduling and cancelling are O(1);
+    advancing only touches the slots the clock passed over, cascading far timers down a level
+    at a time as their deadline gets closer.
+*/
+typedef struct _ENetTimerWheel
+{
+   enet_uint32 currentTime;
+   size_t      timerCount;
+   enet_uint32 occupiedSlots [ENET_TIMER_WHEEL_LEVELS];
+   ENetList    slots [ENET_TIMER_WHEEL_LEVELS] [ENET_TIMER_WHEEL_SLOTS];
+   ENetList    expiredTimers;
+} ENetTimerWheel;
+
+extern void enet_timer_wheel_initialize (ENetTimerWheel *, enet_uint32);
+extern void enet_timer_wheel_schedule (ENetTimerWheel *, ENetTimer *, enet_uint32);
+extern void enet_timer_wheel_cancel (ENetTimerWheel *, ENetTimer *);
+extern void enet_timer_wheel_advance (ENetTimerWheel *, enet_uint32);
+extern ENetTimer * enet_timer_wheel_pop_expired (ENetTimerWheel *);
+extern enet_uint32 enet_timer_wheel_deadline (ENetTimerWheel *, enet_uint32);
+
+#define enet_timer_initialize(timer) ((timer) -> level = ENET_TIMER_LEVEL_UNSCHEDULED)
+#define enet_timer_scheduled(timer) ((timer) -> level != ENET_TIMER_LEVEL_UNSCHEDULED)
+
+#endif /* __ENET_TIMER_H__ */
+
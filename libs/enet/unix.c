@@ -4,6 +4,10 @@
 */
 #ifndef _WIN32
 
+#if defined(__linux__) && ! defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
@@ -16,6 +20,7 @@
 #include <time.h>
 
 #define ENET_BUILDING_LIB 1
+#include "enet/time.h"
 #include "enet/enet.h"
 
 #ifdef __APPLE__
@@ -45,6 +50,26 @@
 #endif
 #endif
 
+#ifdef __linux__
+#ifndef HAS_RECVMMSG
+#define HAS_RECVMMSG 1
+#endif
+#ifndef HAS_SENDMMSG
+#define HAS_SENDMMSG 1
+#endif
+#ifndef HAS_EVENTFD
+#define HAS_EVENTFD 1
+#endif
+#endif
+
+#ifdef __linux__
+#include <netinet/udp.h>
+#endif
+
+#ifdef HAS_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
 #ifdef HAS_FCNTL
 #include <fcntl.h>
 #endif
@@ -61,11 +86,15 @@ typedef int socklen_t;
 #define MSG_NOSIGNAL 0
 #endif
 
+#define ENET_SOCKET_BATCH_MAXIMUM 64
+
 static enet_uint32 timeBase = 0;
 
 int
 enet_initialize (void)
 {
+    enet_checksum_initialize ();
+
     return 0;
 }
 
@@ -80,24 +109,67 @@ enet_host_random_seed (void)
     return (enet_uint32) time (NULL);
 }
 
-enet_uint32
-enet_time_get (void)
+/* Reads the millisecond and microsecond clocks at the same instant. The monotonic clock keeps
+   timeouts from jumping when the wall clock is set; both values wrap and only differences count. */
+static void
+enet_time_read (enet_uint32 * milliseconds, enet_uint32 * microseconds)
 {
+#ifdef CLOCK_MONOTONIC
+    struct timespec timeSpec;
+
+    clock_gettime (CLOCK_MONOTONIC, & timeSpec);
+
+    * milliseconds = (enet_uint32) timeSpec.tv_sec * 1000 + timeSpec.tv_nsec / 1000000;
+    * microseconds = (enet_uint32) timeSpec.tv_sec * 1000000 + timeSpec.tv_nsec / 1000;
+#else
     struct timeval timeVal;
 
     gettimeofday (& timeVal, NULL);
 
-    return timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000 - timeBase;
+    * milliseconds = (enet_uint32) timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000;
+    * microseconds = (enet_uint32) timeVal.tv_sec * 1000000 + timeVal.tv_usec;
+#endif
+}
+
+enet_uint32
+enet_time_get (void)
+{
+    enet_uint32 milliseconds, microseconds;
+
+    enet_time_read (& milliseconds, & microseconds);
+
+    return milliseconds - timeBase;
+}
+
+enet_uint32
+enet_time_get_microseconds (void)
+{
+    enet_uint32 milliseconds, microseconds;
+
+    enet_time_read (& milliseconds, & microseconds);
+
+    return microseconds;
+}
+
+/* enet_time_get() and enet_time_get_microseconds() from a single clock read */
+enet_uint32
+enet_time_get_precise (enet_uint32 * microseconds)
+{
+    enet_uint32 milliseconds;
+
+    enet_time_read (& milliseconds, microseconds);
+
+    return milliseconds - timeBase;
 }
 
 void
 enet_time_set (enet_uint32 newTimeBase)
 {
-    struct timeval timeVal;
+    enet_uint32 milliseconds, microseconds;
 
-    gettimeofday (& timeVal, NULL);
-    
-    timeBase = timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000 - newTimeBase;
+    enet_time_read (& milliseconds, & microseconds);
+
+    timeBase = milliseconds - newTimeBase;
 }
 
 int
@@ -318,6 +390,12 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, SOL_SOCKET, SO_REUSEADDR, (char *) & value, sizeof (int));
             break;
 
+#ifdef SO_REUSEPORT
+        case ENET_SOCKOPT_REUSEPORT:
+            result = setsockopt (socket, SOL_SOCKET, SO_REUSEPORT, (char *) & value, sizeof (int));
+            break;
+#endif
+
         case ENET_SOCKOPT_RCVBUF:
             result = setsockopt (socket, SOL_SOCKET, SO_RCVBUF, (char *) & value, sizeof (int));
             break;
@@ -348,6 +426,32 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, IPPROTO_TCP, TCP_NODELAY, (char *) & value, sizeof (int));
             break;
 
+#ifdef UDP_SEGMENT
+        case ENET_SOCKOPT_GSO:
+            result = setsockopt (socket, SOL_UDP, UDP_SEGMENT, (char *) & value, sizeof (int));
+            break;
+#endif
+
+#ifdef UDP_GRO
+        case ENET_SOCKOPT_GRO:
+            result = setsockopt (socket, SOL_UDP, UDP_GRO, (char *) & value, sizeof (int));
+            break;
+#endif
+
+#if defined (IP_MTU_DISCOVER) && defined (IP_PMTUDISC_PROBE)
+        case ENET_SOCKOPT_DONTFRAGMENT:
+            /* A positive value sets the don't fragment bit without holding datagrams to the path MTU
+               the system has learned. Anything else is what enet_socket_get_option () read back,
+               the negated IP_MTU_DISCOVER mode, so the socket goes back to exactly that mode. */
+            value = value > 0 ? IP_PMTUDISC_PROBE : - value;
+            result = setsockopt (socket, IPPROTO_IP, IP_MTU_DISCOVER, (char *) & value, sizeof (int));
+            break;
+#elif defined (IP_DONTFRAG)
+        case ENET_SOCKOPT_DONTFRAGMENT:
+            result = setsockopt (socket, IPPROTO_IP, IP_DONTFRAG, (char *) & value, sizeof (int));
+            break;
+#endif
+
         default:
             break;
     }
@@ -366,6 +470,20 @@ enet_socket_get_option (ENetSocket socket, ENetSocketOption option, int * value)
             result = getsockopt (socket, SOL_SOCKET, SO_ERROR, value, & len);
             break;
 
+#if defined (IP_MTU_DISCOVER) && defined (IP_PMTUDISC_PROBE)
+        case ENET_SOCKOPT_DONTFRAGMENT:
+            len = sizeof (int);
+            result = getsockopt (socket, IPPROTO_IP, IP_MTU_DISCOVER, value, & len);
+            if (result != -1)
+              * value = * value == IP_PMTUDISC_PROBE ? 1 : - * value;
+            break;
+#elif defined (IP_DONTFRAG)
+        case ENET_SOCKOPT_DONTFRAGMENT:
+            len = sizeof (int);
+            result = getsockopt (socket, IPPROTO_IP, IP_DONTFRAG, value, & len);
+            break;
+#endif
+
         default:
             break;
     }
@@ -458,7 +576,8 @@ enet_socket_send (ENetSocket socket,
     
     if (sentLength == -1)
     {
-       if (errno == EWOULDBLOCK)
+       /* A datagram too big to leave without fragmenting is dropped like one that would block. */
+       if (errno == EWOULDBLOCK || errno == EMSGSIZE)
          return 0;
 
        return -1;
@@ -467,6 +586,110 @@ enet_socket_send (ENetSocket socket,
     return sentLength;
 }
 
+int
+enet_socket_send_multiple (ENetSocket socket,
+                           ENetDatagram * datagrams,
+                           size_t datagramCount)
+{
+#ifdef HAS_SENDMMSG
+    struct mmsghdr msgHdrs [ENET_SOCKET_BATCH_MAXIMUM];
+    struct sockaddr_in sins [ENET_SOCKET_BATCH_MAXIMUM];
+#ifdef UDP_SEGMENT
+    union
+    {
+        char buffer [CMSG_SPACE (sizeof (enet_uint16))];
+        struct cmsghdr align;
+    } controls [ENET_SOCKET_BATCH_MAXIMUM];
+#endif
+    int sentCount, i;
+
+    if (datagramCount > ENET_SOCKET_BATCH_MAXIMUM)
+      datagramCount = ENET_SOCKET_BATCH_MAXIMUM;
+
+    memset (msgHdrs, 0, datagramCount * sizeof (struct mmsghdr));
+    memset (sins, 0, datagramCount * sizeof (struct sockaddr_in));
+
+    for (i = 0; i < (int) datagramCount; ++ i)
+    {
+        sins [i].sin_family = AF_INET;
+        sins [i].sin_port = ENET_HOST_TO_NET_16 (datagrams [i].address.port);
+        sins [i].sin_addr.s_addr = datagrams [i].address.host;
+
+        msgHdrs [i].msg_hdr.msg_name = & sins [i];
+        msgHdrs [i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+        msgHdrs [i].msg_hdr.msg_iov = (struct iovec *) datagrams [i].buffers;
+        msgHdrs [i].msg_hdr.msg_iovlen = datagrams [i].bufferCount;
+
+#ifdef UDP_SEGMENT
+        if (datagrams [i].segmentSize > 0)
+        {
+            struct cmsghdr * cmsg;
+
+            msgHdrs [i].msg_hdr.msg_control = controls [i].buffer;
+            msgHdrs [i].msg_hdr.msg_controllen = sizeof (controls [i].buffer);
+
+            cmsg = CMSG_FIRSTHDR (& msgHdrs [i].msg_hdr);
+            cmsg -> cmsg_level = SOL_UDP;
+            cmsg -> cmsg_type = UDP_SEGMENT;
+            cmsg -> cmsg_len = CMSG_LEN (sizeof (enet_uint16));
+            * (enet_uint16 *) CMSG_DATA (cmsg) = (enet_uint16) datagrams [i].segmentSize;
+        }
+#endif
+    }
+
+    sentCount = sendmmsg (socket, msgHdrs, datagramCount, MSG_NOSIGNAL);
+
+    if (sentCount == -1)
+    {
+       /* sendmmsg only fails outright on the first message, so returning 0 drops just that datagram
+          and the caller goes on with the rest of the batch. A segmented datagram that is too big still
+          fails, so the caller can fall back to sending its segments one by one. */
+       if (errno == EWOULDBLOCK ||
+           (errno == EMSGSIZE && datagrams [0].segmentSize == 0))
+         return 0;
+
+       if (errno != ENOSYS)
+         return -1;
+
+       sentCount = enet_socket_send (socket, & datagrams [0].address, datagrams [0].buffers, datagrams [0].bufferCount);
+       if (sentCount <= 0)
+         return sentCount;
+
+       datagrams [0].dataLength = sentCount;
+
+       return 1;
+    }
+
+    for (i = 0; i < sentCount; ++ i)
+      datagrams [i].dataLength = msgHdrs [i].msg_len;
+
+    return sentCount;
+#else
+    size_t datagramIndex;
+
+    for (datagramIndex = 0; datagramIndex < datagramCount; ++ datagramIndex)
+    {
+        ENetDatagram * datagram = & datagrams [datagramIndex];
+        int sentLength = enet_socket_send (socket, & datagram -> address, datagram -> buffers, datagram -> bufferCount);
+
+        if (sentLength < 0)
+        {
+           if (datagramIndex > 0)
+             break;
+
+           return -1;
+        }
+
+        if (sentLength == 0)
+          break;
+
+        datagram -> dataLength = sentLength;
+    }
+
+    return (int) datagramIndex;
+#endif
+}
+
 int
 enet_socket_receive (ENetSocket socket,
                      ENetAddress * address,
@@ -512,6 +735,116 @@ enet_socket_receive (ENetSocket socket,
     return recvLength;
 }
 
+int
+enet_socket_receive_multiple (ENetSocket socket,
+                              ENetDatagram * datagrams,
+                              size_t datagramCount)
+{
+#ifdef HAS_RECVMMSG
+    struct mmsghdr msgHdrs [ENET_SOCKET_BATCH_MAXIMUM];
+    struct sockaddr_in sins [ENET_SOCKET_BATCH_MAXIMUM];
+#ifdef UDP_GRO
+    union
+    {
+        char buffer [CMSG_SPACE (sizeof (int))];
+        struct cmsghdr align;
+    } controls [ENET_SOCKET_BATCH_MAXIMUM];
+#endif
+    int recvCount, i;
+
+    if (datagramCount > ENET_SOCKET_BATCH_MAXIMUM)
+      datagramCount = ENET_SOCKET_BATCH_MAXIMUM;
+
+    memset (msgHdrs, 0, datagramCount * sizeof (struct mmsghdr));
+
+    for (i = 0; i < (int) datagramCount; ++ i)
+    {
+        msgHdrs [i].msg_hdr.msg_name = & sins [i];
+        msgHdrs [i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+        msgHdrs [i].msg_hdr.msg_iov = (struct iovec *) datagrams [i].buffers;
+        msgHdrs [i].msg_hdr.msg_iovlen = datagrams [i].bufferCount;
+#ifdef UDP_GRO
+        msgHdrs [i].msg_hdr.msg_control = controls [i].buffer;
+        msgHdrs [i].msg_hdr.msg_controllen = sizeof (controls [i].buffer);
+#endif
+    }
+
+    recvCount = recvmmsg (socket, msgHdrs, datagramCount, MSG_DONTWAIT, NULL);
+
+    if (recvCount == -1)
+    {
+       if (errno == EWOULDBLOCK)
+         return 0;
+
+       if (errno != ENOSYS)
+         return -1;
+
+       recvCount = enet_socket_receive (socket, & datagrams [0].address, datagrams [0].buffers, datagrams [0].bufferCount);
+       if (recvCount <= 0)
+         return recvCount;
+
+       datagrams [0].dataLength = recvCount;
+       datagrams [0].segmentSize = 0;
+
+       return 1;
+    }
+
+    for (i = 0; i < recvCount; ++ i)
+    {
+        ENetDatagram * datagram = & datagrams [i];
+#ifdef UDP_GRO
+        struct cmsghdr * cmsg;
+#endif
+
+        datagram -> address.host = (enet_uint32) sins [i].sin_addr.s_addr;
+        datagram -> address.port = ENET_NET_TO_HOST_16 (sins [i].sin_port);
+        datagram -> segmentSize = 0;
+
+#ifdef UDP_GRO
+        for (cmsg = CMSG_FIRSTHDR (& msgHdrs [i].msg_hdr);
+             cmsg != NULL;
+             cmsg = CMSG_NXTHDR (& msgHdrs [i].msg_hdr, cmsg))
+        {
+            if (cmsg -> cmsg_level == SOL_UDP && cmsg -> cmsg_type == UDP_GRO)
+              datagram -> segmentSize = * (int *) CMSG_DATA (cmsg);
+        }
+#endif
+
+        /* Truncated datagrams are handed back empty rather than failing the whole batch. */
+        if (msgHdrs [i].msg_hdr.msg_flags & MSG_TRUNC)
+          datagram -> dataLength = 0;
+        else
+          datagram -> dataLength = msgHdrs [i].msg_len;
+    }
+
+    return recvCount;
+#else
+    size_t datagramIndex;
+
+    for (datagramIndex = 0; datagramIndex < datagramCount; ++ datagramIndex)
+    {
+        ENetDatagram * datagram = & datagrams [datagramIndex];
+        int recvLength = enet_socket_receive (socket, & datagram -> address, datagram -> buffers, datagram -> bufferCount);
+
+        if (recvLength < 0)
+        {
+           if (datagramIndex > 0)
+             break;
+
+           return -1;
+        }
+
+        if (recvLength == 0)
+          break;
+
+        datagram -> dataLength = recvLength;
+        datagram -> segmentSize = 0;
+    }
+
+    return (int) datagramIndex;
+#endif
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -611,5 +944,168 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
 #endif
 }
 
+int
+enet_socket_wait_interruptible (ENetSocket socket, ENetSocket wakeupSocket, enet_uint32 * condition, enet_uint32 timeout)
+{
+    /* Only the wakeup socket reports ENET_SOCKET_WAIT_INTERRUPT here. A signal is not a wakeup,
+     * so the wait goes on for whatever is left of the timeout.
+     */
+    enet_uint32 deadline = enet_time_get () + timeout;
+#ifdef HAS_POLL
+    struct pollfd pollSockets [2];
+    int pollCount;
+
+    pollSockets [0].fd = socket;
+    pollSockets [0].events = 0;
+
+    if (* condition & ENET_SOCKET_WAIT_SEND)
+      pollSockets [0].events |= POLLOUT;
+
+    if (* condition & ENET_SOCKET_WAIT_RECEIVE)
+      pollSockets [0].events |= POLLIN;
+
+    pollSockets [1].fd = wakeupSocket;
+    pollSockets [1].events = POLLIN;
+
+    while ((pollCount = poll (pollSockets, 2, timeout)) < 0 && errno == EINTR)
+    {
+        enet_uint32 now = enet_time_get ();
+
+        timeout = ENET_TIME_LESS (now, deadline) ? ENET_TIME_DIFFERENCE (deadline, now) : 0;
+    }
+
+    if (pollCount < 0)
+      return -1;
+
+    * condition = ENET_SOCKET_WAIT_NONE;
+
+    if (pollCount == 0)
+      return 0;
+
+    if (pollSockets [0].revents & POLLOUT)
+      * condition |= ENET_SOCKET_WAIT_SEND;
+    
+    if (pollSockets [0].revents & POLLIN)
+      * condition |= ENET_SOCKET_WAIT_RECEIVE;
+
+    if (pollSockets [1].revents & POLLIN)
+      * condition |= ENET_SOCKET_WAIT_INTERRUPT;
+
+    return 0;
+#else
+    fd_set readSet, writeSet;
+    struct timeval timeVal;
+    int selectCount;
+
+    for (;;)
+    {
+        enet_uint32 now;
+
+        timeVal.tv_sec = timeout / 1000;
+        timeVal.tv_usec = (timeout % 1000) * 1000;
+
+        FD_ZERO (& readSet);
+        FD_ZERO (& writeSet);
+
+        if (* condition & ENET_SOCKET_WAIT_SEND)
+          FD_SET (socket, & writeSet);
+
+        if (* condition & ENET_SOCKET_WAIT_RECEIVE)
+          FD_SET (socket, & readSet);
+
+        FD_SET (wakeupSocket, & readSet);
+
+        selectCount = select ((socket > wakeupSocket ? socket : wakeupSocket) + 1, & readSet, & writeSet, NULL, & timeVal);
+        if (selectCount >= 0 || errno != EINTR)
+          break;
+
+        now = enet_time_get ();
+        timeout = ENET_TIME_LESS (now, deadline) ? ENET_TIME_DIFFERENCE (deadline, now) : 0;
+    }
+
+    if (selectCount < 0)
+      return -1;
+
+    * condition = ENET_SOCKET_WAIT_NONE;
+
+    if (selectCount == 0)
+      return 0;
+
+    if (FD_ISSET (socket, & writeSet))
+      * condition |= ENET_SOCKET_WAIT_SEND;
+
+    if (FD_ISSET (socket, & readSet))
+      * condition |= ENET_SOCKET_WAIT_RECEIVE;
+
+    if (FD_ISSET (wakeupSocket, & readSet))
+      * condition |= ENET_SOCKET_WAIT_INTERRUPT;
+
+    return 0;
+#endif
+}
+
+int
+enet_socket_create_wakeup (ENetSocket * wakeupSocket, ENetSocket * wakeupSignal)
+{
+#ifdef HAS_EVENTFD
+    int eventSocket = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (eventSocket >= 0)
+    {
+        * wakeupSocket = eventSocket;
+        * wakeupSignal = eventSocket;
+
+        return 0;
+    }
+#endif
+    int pipeSockets [2], i;
+
+    if (pipe (pipeSockets) < 0)
+      return -1;
+
+    for (i = 0; i < 2; ++ i)
+    {
+#ifdef HAS_FCNTL
+        int result = fcntl (pipeSockets [i], F_SETFL, O_NONBLOCK | fcntl (pipeSockets [i], F_GETFL));
+#else
+        int value = 1, result = ioctl (pipeSockets [i], FIONBIO, & value);
+#endif
+        if (result == -1)
+        {
+            close (pipeSockets [0]);
+            close (pipeSockets [1]);
+
+            return -1;
+        }
+    }
+
+    * wakeupSocket = pipeSockets [0];
+    * wakeupSignal = pipeSockets [1];
+
+    return 0;
+}
+
+int
+enet_socket_signal_wakeup (ENetSocket wakeupSignal)
+{
+    /* eventfd only accepts 8 byte writes, a pipe takes them as well */
+    unsigned long long value = 1;
+
+    if (write (wakeupSignal, & value, sizeof (value)) < 0 && errno != EWOULDBLOCK && errno != EAGAIN)
+      return -1;
+
+    /* A full pipe or eventfd counter is already readable, so the wakeup is not lost. */
+    return 0;
+}
+
+void
+enet_socket_drain_wakeup (ENetSocket wakeupSocket)
+{
+    enet_uint8 drainData [64];
+
+    while (read (wakeupSocket, drainData, sizeof (drainData)) > 0)
+    ;
+}
+
 #endif
 
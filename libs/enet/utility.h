@@ -5,9 +5,12 @@
 #ifndef __ENET_UTILITY_H__
 #define __ENET_UTILITY_H__
 
+#include <stddef.h>
+
 #define ENET_MAX(x, y) ((x) > (y) ? (x) : (y))
 #define ENET_MIN(x, y) ((x) < (y) ? (x) : (y))
 #define ENET_DIFFERENCE(x, y) ((x) < (y) ? (y) - (x) : (x) - (y))
+#define ENET_CONTAINER_OF(pointer, type, member) ((type *) ((char *) (pointer) - offsetof (type, member)))
 
 #endif /* __ENET_UTILITY_H__ */
 
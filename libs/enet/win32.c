@@ -7,6 +7,7 @@
 #define ENET_BUILDING_LIB 1
 #include "enet/enet.h"
 #include <windows.h>
+#include <ws2tcpip.h>
 #include <mmsystem.h>
 
 static enet_uint32 timeBase = 0;
@@ -30,6 +31,8 @@ enet_initialize (void)
 
     timeBeginPeriod (1);
 
+    enet_checksum_initialize ();
+
     return 0;
 }
 
@@ -53,6 +56,26 @@ enet_time_get (void)
     return (enet_uint32) timeGetTime () - timeBase;
 }
 
+/* wraps every 71 minutes, only differences are meaningful */
+enet_uint32
+enet_time_get_microseconds (void)
+{
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter (& counter);
+    QueryPerformanceFrequency (& frequency);
+
+    return (enet_uint32) (counter.QuadPart / frequency.QuadPart * 1000000 + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+}
+
+enet_uint32
+enet_time_get_precise (enet_uint32 * microseconds)
+{
+    * microseconds = enet_time_get_microseconds ();
+
+    return enet_time_get ();
+}
+
 void
 enet_time_set (enet_uint32 newTimeBase)
 {
@@ -231,6 +254,12 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, IPPROTO_TCP, TCP_NODELAY, (char *) & value, sizeof (int));
             break;
 
+#ifdef IP_DONTFRAGMENT
+        case ENET_SOCKOPT_DONTFRAGMENT:
+            result = setsockopt (socket, IPPROTO_IP, IP_DONTFRAGMENT, (char *) & value, sizeof (int));
+            break;
+#endif
+
         default:
             break;
     }
@@ -248,6 +277,13 @@ enet_socket_get_option (ENetSocket socket, ENetSocketOption option, int * value)
             result = getsockopt (socket, SOL_SOCKET, SO_ERROR, (char *) value, & len);
             break;
 
+#ifdef IP_DONTFRAGMENT
+        case ENET_SOCKOPT_DONTFRAGMENT:
+            len = sizeof(int);
+            result = getsockopt (socket, IPPROTO_IP, IP_DONTFRAGMENT, (char *) value, & len);
+            break;
+#endif
+
         default:
             break;
     }
@@ -337,8 +373,13 @@ enet_socket_send (ENetSocket socket,
                    NULL,
                    NULL) == SOCKET_ERROR)
     {
-       if (WSAGetLastError () == WSAEWOULDBLOCK)
-         return 0;
+       /* A datagram too big to leave without fragmenting is dropped like one that would block. */
+       switch (WSAGetLastError ())
+       {
+       case WSAEWOULDBLOCK:
+       case WSAEMSGSIZE:
+          return 0;
+       }
 
        return -1;
     }
@@ -346,6 +387,35 @@ enet_socket_send (ENetSocket socket,
     return (int) sentLength;
 }
 
+int
+enet_socket_send_multiple (ENetSocket socket,
+                           ENetDatagram * datagrams,
+                           size_t datagramCount)
+{
+    size_t datagramIndex;
+
+    for (datagramIndex = 0; datagramIndex < datagramCount; ++ datagramIndex)
+    {
+        ENetDatagram * datagram = & datagrams [datagramIndex];
+        int sentLength = enet_socket_send (socket, & datagram -> address, datagram -> buffers, datagram -> bufferCount);
+
+        if (sentLength < 0)
+        {
+           if (datagramIndex > 0)
+             break;
+
+           return -1;
+        }
+
+        if (sentLength == 0)
+          break;
+
+        datagram -> dataLength = sentLength;
+    }
+
+    return (int) datagramIndex;
+}
+
 int
 enet_socket_receive (ENetSocket socket,
                      ENetAddress * address,
@@ -389,6 +459,36 @@ enet_socket_receive (ENetSocket socket,
     return (int) recvLength;
 }
 
+int
+enet_socket_receive_multiple (ENetSocket socket,
+                              ENetDatagram * datagrams,
+                              size_t datagramCount)
+{
+    size_t datagramIndex;
+
+    for (datagramIndex = 0; datagramIndex < datagramCount; ++ datagramIndex)
+    {
+        ENetDatagram * datagram = & datagrams [datagramIndex];
+        int recvLength = enet_socket_receive (socket, & datagram -> address, datagram -> buffers, datagram -> bufferCount);
+
+        if (recvLength < 0)
+        {
+           if (datagramIndex > 0)
+             break;
+
+           return -1;
+        }
+
+        if (recvLength == 0)
+          break;
+
+        datagram -> dataLength = recvLength;
+        datagram -> segmentSize = 0;
+    }
+
+    return (int) datagramIndex;
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -438,5 +538,97 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
     return 0;
 } 
 
+int
+enet_socket_wait_interruptible (ENetSocket socket, ENetSocket wakeupSocket, enet_uint32 * condition, enet_uint32 timeout)
+{
+    fd_set readSet, writeSet;
+    struct timeval timeVal;
+    int selectCount;
+    
+    timeVal.tv_sec = timeout / 1000;
+    timeVal.tv_usec = (timeout % 1000) * 1000;
+    
+    FD_ZERO (& readSet);
+    FD_ZERO (& writeSet);
+
+    if (* condition & ENET_SOCKET_WAIT_SEND)
+      FD_SET (socket, & writeSet);
+
+    if (* condition & ENET_SOCKET_WAIT_RECEIVE)
+      FD_SET (socket, & readSet);
+
+    FD_SET (wakeupSocket, & readSet);
+
+    selectCount = select (0, & readSet, & writeSet, NULL, & timeVal);
+
+    if (selectCount < 0)
+      return -1;
+
+    * condition = ENET_SOCKET_WAIT_NONE;
+
+    if (selectCount == 0)
+      return 0;
+
+    if (FD_ISSET (socket, & writeSet))
+      * condition |= ENET_SOCKET_WAIT_SEND;
+    
+    if (FD_ISSET (socket, & readSet))
+      * condition |= ENET_SOCKET_WAIT_RECEIVE;
+
+    if (FD_ISSET (wakeupSocket, & readSet))
+      * condition |= ENET_SOCKET_WAIT_INTERRUPT;
+
+    return 0;
+}
+
+int
+enet_socket_create_wakeup (ENetSocket * wakeupSocket, ENetSocket * wakeupSignal)
+{
+    /* Windows has no pipes that select() accepts, so use a loopback UDP socket connected to itself. */
+    ENetSocket loopbackSocket = enet_socket_create (ENET_SOCKET_TYPE_DATAGRAM);
+    ENetAddress address;
+
+    if (loopbackSocket == ENET_SOCKET_NULL)
+      return -1;
+
+    address.host = ENET_HOST_TO_NET_32 (0x7F000001);
+    address.port = 0;
+
+    if (enet_socket_bind (loopbackSocket, & address) < 0 ||
+        enet_socket_get_address (loopbackSocket, & address) < 0 ||
+        enet_socket_connect (loopbackSocket, & address) < 0 ||
+        enet_socket_set_option (loopbackSocket, ENET_SOCKOPT_NONBLOCK, 1) < 0)
+    {
+        enet_socket_destroy (loopbackSocket);
+
+        return -1;
+    }
+
+    * wakeupSocket = loopbackSocket;
+    * wakeupSignal = loopbackSocket;
+
+    return 0;
+}
+
+int
+enet_socket_signal_wakeup (ENetSocket wakeupSignal)
+{
+    char value = 1;
+
+    if (send (wakeupSignal, & value, 1, 0) == SOCKET_ERROR && WSAGetLastError () != WSAEWOULDBLOCK)
+      return -1;
+
+    return 0;
+}
+
+void
+enet_socket_drain_wakeup (ENetSocket wakeupSocket)
+{
+    char drainData [64];
+
+    while (recv (wakeupSocket, drainData, sizeof (drainData), 0) > 0)
+    ;
+}
+
 #endif
 
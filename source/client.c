@@ -33,6 +33,7 @@ int client_initialize (Client* client, const char* name)
 	pthread_rwlock_init (&client->quit_lock, NULL);
 
 	frame_limiter_initialize (&client->limiter);
+	command_queue_initialize (&client->commands);
 
 	client->quit = false;
 	client->test = false;
@@ -44,27 +45,61 @@ int client_initialize (Client* client, const char* name)
 	return 0;
 }
 
+/*
+ * hand a command to the thread running the client
+ *
+ * safe to call from any thread
+ */
+static int client_push_command (Client* client, const Command* command)
+{
+	if (!command_queue_push (&client->commands, command))
+	{
+		printf ("client %s: command queue full, dropping command\n", client->name);
+
+		return 1;
+	}
+
+	return 0;
+}
+
 /*
  * connect a client to a server
+ *
+ * safe to call from any thread, the connect happens on the client's next frame
  */
 int client_connect (Client* client, const char* host_name)
+{
+	Command command =
+	{
+		.type = COMMAND_TYPE_CONNECT
+	};
+
+	if (enet_address_set_host (&command.address, host_name) < 0)
+	{
+		printf ("client %s: could not resolve %s\n", client->name, host_name);
+
+		return 1;
+	}
+	command.address.port = 2345;
+
+	return client_push_command (client, &command);
+}
+
+static void client_connect_now (Client* client, const ENetAddress* address)
 {
 	if (client->state == CLIENT_STATE_CONNECTED)
 	{
 		printf ("client: already connected\n");
 
-		return 1;
+		return;
 	}
 
-	enet_address_set_host (&client->address, host_name);
-	client->address.port = 2345;
+	client->address = *address;
 
 	client->remote_server = enet_host_connect (client->host, &client->address, 2, 0);
 	client->state = CLIENT_STATE_CONNECTING;
 	client->response_timeout = 3.0;
 	client->waiting_for_response = true;
-
-	return 0;
 }
 
 /*
@@ -72,8 +107,21 @@ int client_connect (Client* client, const char* host_name)
  *
  * wait_for_response will set the client to wait for a response from the server
  * 	or just immediately disconnect
+ *
+ * safe to call from any thread, the disconnect happens on the client's next frame
  */
 void client_disconnect (Client* client, bool wait_for_response)
+{
+	Command command =
+	{
+		.type = COMMAND_TYPE_DISCONNECT,
+		.wait_for_response = wait_for_response
+	};
+
+	client_push_command (client, &command);
+}
+
+static void client_disconnect_now (Client* client, bool wait_for_response)
 {
 	if (client->state == CLIENT_STATE_DISCONNECTED)
 	{
@@ -108,25 +156,43 @@ void client_disconnect (Client* client, bool wait_for_response)
 
 /*
  * send a packet of the given type to the server
+ *
+ * safe to call from any thread, the packet is created and sent on the client's next frame
  */
 void client_send_packet (Client* client, uint8_t type)
+{
+	Command command =
+	{
+		.type = COMMAND_TYPE_SEND,
+		.packet_type = type
+	};
+
+	client_push_command (client, &command);
+}
+
+static void client_send_packet_now (Client* client, uint8_t type)
 {
 	ENetPacket* packet = NULL;
 
+	if (client->state != CLIENT_STATE_CONNECTED)
+	{
+		return;
+	}
+
 	switch (type)
 	{
 		case 1:
 		{
 			Packet_a pack = {7};
 			packet = create_packet (type, &pack, sizeof (Packet_a));
-			enet_peer_send (client->remote_server, 0, packet);
+			send_packet (client->remote_server, packet);
 			break;
 		}
 		case 2:
 		{
 			Packet_b pack = {7};
 			packet = create_packet (type, &pack, sizeof (Packet_b));
-			enet_peer_send (client->remote_server, 0, packet);
+			send_packet (client->remote_server, packet);
 			break;
 		}
 		default:
@@ -151,15 +217,18 @@ void* client_thread (void* data)
 		// lets not eat up 100% cpu
 		frame_limiter_frame_start (&client->limiter);
 
-		client->frame_time = stm_laptime (&client->last_frame_time);
-		client_frame (client, client->frame_time);
-
+		// check quit before running the frame
+		// 	client_shutdown queues its disconnect before setting quit
+		// 	so the frame is guaranteed to see the disconnect and keep the thread alive for it
 		if (pthread_rwlock_tryrdlock (&client->quit_lock) == 0)
 		{
 			quit = client->quit;
 			pthread_rwlock_unlock (&client->quit_lock);
 		}
 
+		client->frame_time = stm_laptime (&client->last_frame_time);
+		client_frame (client, client->frame_time);
+
 		frame_limiter_frame_end (&client->limiter, 100);
 	}
 
@@ -176,6 +245,31 @@ void* client_thread (void* data)
  */
 void client_frame (Client* client, uint64_t frame_time)
 {
+	Command commands[CLIENT_COMMAND_BATCH_SIZE];
+	int command_count;
+
+	// run whatever other threads queued since the last frame
+	while ((command_count = command_queue_pop (&client->commands, commands, CLIENT_COMMAND_BATCH_SIZE)) > 0)
+	{
+		for (int iter = 0; iter < command_count; iter++)
+		{
+			switch (commands[iter].type)
+			{
+				case COMMAND_TYPE_CONNECT:
+					client_connect_now (client, &commands[iter].address);
+					break;
+				case COMMAND_TYPE_DISCONNECT:
+					client_disconnect_now (client, commands[iter].wait_for_response);
+					break;
+				case COMMAND_TYPE_SEND:
+					client_send_packet_now (client, commands[iter].packet_type);
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
 	// if the client is waiting for a server response, reduce response timeout by frame time
 	if (client->response_timeout > 0.0)
 	{
@@ -203,7 +297,7 @@ void client_frame (Client* client, uint64_t frame_time)
 					// create and send greeting packet
 					// 	which contains the client's name
 					ENetPacket* packet_test = create_packet (0, client->name, strlen (client->name) + 1);
-					enet_peer_send (client->remote_server, 0, packet_test);
+					send_packet (client->remote_server, packet_test);
 
 					enet_host_flush (client->host);
 				}
@@ -227,7 +321,7 @@ void client_frame (Client* client, uint64_t frame_time)
 				else
 				{
 					printf ("client %s: server told client to disconnect\n", client->name);
-					client_disconnect (client, false);
+					client_disconnect_now (client, false);
 				}
 
 				enet_packet_destroy (event.packet);
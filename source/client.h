@@ -9,9 +9,12 @@
 
 #include "packet.h"
 #include "frame_limiter.h"
+#include "command_queue.h"
 
 #define CLIENT_NAME_BUFFER_SIZE 8
 #define CLIENT_MAX_NAME_LENGTH (CLIENT_NAME_BUFFER_SIZE - 1)
+// how many queued commands a client pops at a time
+#define CLIENT_COMMAND_BATCH_SIZE 16
 
 typedef enum
 {
@@ -43,6 +46,8 @@ typedef struct client_client_s
 
 	Frame_limiter limiter;  // limit the frame rate of threaded clients
 
+	Command_queue commands;  // connects, disconnects and sends from other threads, run by client_frame
+
 	bool quit;  // setting this to true will shut down a client thread
 	bool test;  // true if this client is a threaded test client (not the main client)
 	bool thread_launched;  // keep track of whether this client thread has been launched or not
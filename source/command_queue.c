@@ -0,0 +1,88 @@
+#include "command_queue.h"
+
+void command_queue_initialize (Command_queue* queue)
+{
+	// a cell is free for the producer whose position matches its sequence
+	for (size_t iter = 0; iter < COMMAND_QUEUE_CAPACITY; iter++)
+	{
+		atomic_init (&queue->cells[iter].sequence, iter);
+	}
+
+	atomic_init (&queue->enqueue_position, 0);
+	queue->dequeue_position = 0;
+}
+
+/*
+ * safe to call from any number of threads at once
+ *
+ * returns false if the queue is full, the command is dropped
+ */
+bool command_queue_push (Command_queue* queue, const Command* command)
+{
+	Command_queue_cell* cell;
+	size_t position = atomic_load_explicit (&queue->enqueue_position, memory_order_relaxed);
+
+	for (;;)
+	{
+		cell = &queue->cells[position & (COMMAND_QUEUE_CAPACITY - 1)];
+
+		size_t sequence = atomic_load_explicit (&cell->sequence, memory_order_acquire);
+		intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+
+		if (difference == 0)
+		{
+			// the cell is free, try to claim this position
+			// 	on failure position is reloaded with whatever another producer moved it to
+			if (atomic_compare_exchange_weak_explicit (&queue->enqueue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// the consumer has not emptied this cell from the previous lap yet
+			return false;
+		}
+		else
+		{
+			// another producer claimed this position first
+			position = atomic_load_explicit (&queue->enqueue_position, memory_order_relaxed);
+		}
+	}
+
+	cell->command = *command;
+	// publish the command to the consumer
+	atomic_store_explicit (&cell->sequence, position + 1, memory_order_release);
+
+	return true;
+}
+
+/*
+ * only the thread that owns the queue may call this
+ *
+ * pops up to max_commands commands in one go, returns how many were popped
+ */
+int command_queue_pop (Command_queue* queue, Command* commands, int max_commands)
+{
+	int count = 0;
+
+	while (count < max_commands)
+	{
+		Command_queue_cell* cell = &queue->cells[queue->dequeue_position & (COMMAND_QUEUE_CAPACITY - 1)];
+		size_t sequence = atomic_load_explicit (&cell->sequence, memory_order_acquire);
+
+		// empty, or a producer has claimed the cell but not finished writing it
+		if (sequence != queue->dequeue_position + 1)
+		{
+			break;
+		}
+
+		commands[count++] = cell->command;
+
+		// hand the cell back to producers for the next lap
+		atomic_store_explicit (&cell->sequence, queue->dequeue_position + COMMAND_QUEUE_CAPACITY, memory_order_release);
+		queue->dequeue_position++;
+	}
+
+	return count;
+}
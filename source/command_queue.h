@@ -0,0 +1,70 @@
+#ifndef command_queue_h
+#define command_queue_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+
+#include "enet/enet.h"
+
+/*
+ * a bounded lock free multiple producer, single consumer queue
+ *
+ * enet hosts are not thread safe, so other threads never touch a host directly
+ * 	instead they push commands here and the thread servicing the host pops and runs them
+ *
+ * this is dmitry vyukov's bounded queue with the consumer side simplified for a single consumer
+ * 	every cell carries a sequence number that tells producers and the consumer whose turn it is
+ */
+
+// must be a power of two
+#define COMMAND_QUEUE_CAPACITY 64
+// cache line size, keeps the producer and consumer positions from sharing a line
+#define COMMAND_QUEUE_ALIGNMENT 64
+
+typedef enum
+{
+	COMMAND_TYPE_CONNECT,
+	COMMAND_TYPE_DISCONNECT,
+	COMMAND_TYPE_SEND
+} Command_type;
+
+typedef struct command_s
+{
+	Command_type type;
+	// which demo packet to send, for COMMAND_TYPE_SEND
+	uint8_t packet_type;
+	// the peer a send or disconnect is for, NULL to broadcast a send
+	ENetPeer* peer;
+	// the peer's connectID when the command was pushed
+	// 	enet reuses a peer for the next connection, so the peer alone could be someone else by now
+	enet_uint32 connect_id;
+	// where to connect to, for COMMAND_TYPE_CONNECT
+	ENetAddress address;
+	// for COMMAND_TYPE_DISCONNECT, wait for the other side to answer before calling it done
+	bool wait_for_response;
+} Command;
+
+typedef struct command_queue_cell_s
+{
+	atomic_size_t sequence;
+	Command command;
+} Command_queue_cell;
+
+typedef struct command_queue_s
+{
+	Command_queue_cell cells[COMMAND_QUEUE_CAPACITY];
+
+	// claimed by producers with compare and swap
+	alignas (COMMAND_QUEUE_ALIGNMENT) atomic_size_t enqueue_position;
+	// only ever touched by the consumer
+	alignas (COMMAND_QUEUE_ALIGNMENT) size_t dequeue_position;
+} Command_queue;
+
+void command_queue_initialize (Command_queue* queue);
+bool command_queue_push (Command_queue* queue, const Command* command);
+int command_queue_pop (Command_queue* queue, Command* commands, int max_commands);
+
+#endif
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
 #include "implementations.h"
 #include "nuklear.h"
@@ -51,9 +52,7 @@ void draw_client_window (struct nk_context* context, Client* client, int id)
 		{
 			if (nk_button_label (context, "connect"))
 			{
-				// XXX
-				// 	for the main thread client, this is fine
-				// 	threaded clients probably shouldnt be directly accessed like this
+				// queued, so this is fine for threaded clients too
 				client_connect (client, "localhost");
 			}
 			if (nk_button_label (context, "disconnect"))
@@ -143,27 +142,50 @@ void draw_ui (struct nk_context* context, Client* clients, Server* server)
 		}
 
 		nk_layout_row_dynamic (context, 30, 1);
+		if (server->state == SERVER_STATE_SHUTDOWN)
+		{
+			// one host per core on the same port, only takes effect on the next launch
+			nk_bool sharded = server->sharded;
+			nk_checkbox_label (context, "sharded", &sharded);
+			server->sharded = sharded;
+		}
+
 		if (server->state == SERVER_STATE_RUNNING)
 		{
-			nk_labelf (context, NK_TEXT_LEFT, "connected clients: %i", server->client_count);
+			// the shards change the client table under clients_lock, so draw from a copy
+			// 	the buttons below take the lock themselves
+			Server_client clients_snapshot[SERVER_MAX_CLIENT_SLOTS];
+			int client_count;
+
+			pthread_mutex_lock (&server->clients_lock);
+			memcpy (clients_snapshot, server->clients, sizeof (clients_snapshot));
+			client_count = server->client_count;
+			pthread_mutex_unlock (&server->clients_lock);
+
+			nk_labelf (context, NK_TEXT_LEFT, "connected clients: %i (%i shards)", client_count, server->shard_count);
 
 			if (nk_button_label (context, "send packet to all clients"))
 			{
 				server_send_packet_to_all (server);
 			}
 
-			if (server->client_count > 0)
+			if (client_count > 0)
 			{
-				for (int iter = 0; iter < SERVER_MAX_CLIENTS; iter++)
+				for (int iter = 0; iter < SERVER_MAX_CLIENT_SLOTS; iter++)
 				{
-					if (server->clients[iter].active)
+					if (clients_snapshot[iter].active)
 					{
 						nk_layout_row_dynamic (context, 30, 1);
-						nk_labelf (context, NK_TEXT_LEFT, "client: %s", server->clients[iter].name);
+						nk_labelf (context, NK_TEXT_LEFT, "client: %s", clients_snapshot[iter].name);
+						nk_layout_row_dynamic (context, 30, 2);
 						if (nk_button_label (context, "send packet"))
 						{
 							server_send_packet_to_one (server, &server->clients[iter]);
 						}
+						if (nk_button_label (context, "disconnect"))
+						{
+							server_disconnect_client (server, &server->clients[iter]);
+						}
 						nk_layout_row_dynamic (context, 15, 1);
 						nk_label (context, "", NK_TEXT_LEFT);
 					}
@@ -149,7 +149,7 @@ void cleanup (void)
 	// join up all the threads and shut everything down
 	pthread_join (clients[1].thread, NULL);
 	pthread_join (clients[2].thread, NULL);
-	pthread_join (server.thread, NULL);
+	server_join (&server);
 	enet_deinitialize ();
 	snk_shutdown ();
 	sg_shutdown ();
@@ -157,9 +157,7 @@ void cleanup (void)
 
 void start_shutdown ()
 {
-	pthread_rwlock_wrlock (&server.shutdown_lock);
-	server.shutdown_server = true;
-	pthread_rwlock_unlock (&server.shutdown_lock);
+	server_shutdown (&server);
 
 	shutdown_everything = true;
 }
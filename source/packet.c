@@ -8,17 +8,54 @@
  * constructs packets specific to this program
  *
  * type is what the server will use to know what kind of packet this is
+ *
+ * the type byte and the data are reserved up front
+ * 	so a small packet is a single allocation, enet keeps the data inline behind the packet
  */
 ENetPacket* create_packet (uint8_t type, void* data, size_t data_size)
 {
-	ENetPacket* new_packet = enet_packet_create (&type, sizeof (uint8_t), ENET_PACKET_FLAG_RELIABLE);
+	if (!data)
+	{
+		data_size = 0;
+	}
+
+	ENetPacket* new_packet = enet_packet_create (NULL, sizeof (uint8_t) + data_size, ENET_PACKET_FLAG_RELIABLE);
+
+	if (!new_packet)
+	{
+		return NULL;
+	}
+
+	new_packet->data[0] = type;
 
 	if (data)
 	{
-		enet_packet_resize (new_packet, sizeof (uint8_t) + data_size);
 		memcpy (&new_packet->data[sizeof (uint8_t)], data, data_size);
 	}
 
 	return new_packet;
 }
 
+
+/*
+ * queue a packet made by create_packet on channel 0
+ *
+ * packet may be NULL, so callers can pass create_packet's result straight through
+ * 	if enet refuses the packet nothing else holds a reference to it, so it is destroyed here
+ */
+int send_packet (ENetPeer* peer, ENetPacket* packet)
+{
+	if (!packet)
+	{
+		return -1;
+	}
+
+	if (enet_peer_send (peer, 0, packet) < 0)
+	{
+		enet_packet_destroy (packet);
+
+		return -1;
+	}
+
+	return 0;
+}
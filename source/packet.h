@@ -32,5 +32,6 @@ typedef struct packet_d_s
 } Packet_d;
 
 ENetPacket* create_packet (uint8_t type, void* data, size_t data_size);
+int send_packet (ENetPeer* peer, ENetPacket* packet);
 
 #endif
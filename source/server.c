@@ -1,5 +1,10 @@
+// for pthread_attr_setaffinity_np, sched_getaffinity and CPU_SET
+#define _GNU_SOURCE
+
+#include <errno.h>
 #include <stdio.h>
 #include <pthread.h>
+#include <sched.h>
 #include <string.h>
 
 #include "enet/enet.h"
@@ -12,12 +17,12 @@
 int server_initialize (Server* server)
 {
 	server->shutdown_server = false;
-	server->shutdown_timeout = 0.0;
-	server->frame_time = 0;
-	server->last_frame_time = 0;
 	server->state = SERVER_STATE_SHUTDOWN;
+	server->shard_count = 0;
+	server->running_shards = 0;
+	server->sharded = false;
 
-	for (int iter = 0; iter < SERVER_MAX_CLIENTS; iter++)
+	for (int iter = 0; iter < SERVER_MAX_CLIENT_SLOTS; iter++)
 	{
 		server->clients[iter].active = false;
 		server->clients[iter].peer = NULL;
@@ -25,41 +30,165 @@ int server_initialize (Server* server)
 	}
 
 	pthread_rwlock_init (&server->shutdown_lock, NULL);
+	pthread_mutex_init (&server->clients_lock, NULL);
+
+	for (int iter = 0; iter < SERVER_MAX_SHARDS; iter++)
+	{
+		Server_shard* shard = &server->shards[iter];
 
-	frame_limiter_initialize (&server->limiter);
+		shard->host = NULL;
+		shard->server = server;
+		shard->index = iter;
+		shard->launched = false;
+		command_queue_initialize (&shard->commands);
+	}
 
 	printf ("initialized server\n");
 
 	return 0;
 }
 
+/*
+ * hand a command to a shard's thread and wake it up
+ *
+ * safe to call from any thread
+ */
+static void server_shard_push_command (Server_shard* shard, const Command* command)
+{
+	if (!shard->host)
+	{
+		return;
+	}
+
+	if (!command_queue_push (&shard->commands, command))
+	{
+		printf ("server %i: command queue full, dropping command\n", shard->index);
+
+		return;
+	}
+
+	enet_host_wakeup (shard->host);
+}
+
+/*
+ * run everything other threads have queued for this shard
+ *
+ * only called from the shard's own thread
+ */
+static void server_shard_run_commands (Server_shard* shard)
+{
+	Command commands[SERVER_COMMAND_BATCH_SIZE];
+	int command_count;
+
+	while ((command_count = command_queue_pop (&shard->commands, commands, SERVER_COMMAND_BATCH_SIZE)) > 0)
+	{
+		for (int iter = 0; iter < command_count; iter++)
+		{
+			Command* command = &commands[iter];
+
+			// the peer may have gone away while the command sat in the queue, or even been taken by a new client
+			if (command->peer
+				&& (command->peer->state != ENET_PEER_STATE_CONNECTED
+					|| command->peer->connectID != command->connect_id))
+			{
+				continue;
+			}
+
+			switch (command->type)
+			{
+				case COMMAND_TYPE_SEND:
+					if (command->packet_type == 4)
+					{
+						Packet_d data = {5};
+						ENetPacket* packet = create_packet (4, &data, sizeof (Packet_d));
+
+						if (packet)
+						{
+							enet_host_broadcast (shard->host, 0, packet);
+						}
+					}
+					else if (command->packet_type == 3)
+					{
+						Packet_c data = {8};
+						ENetPacket* packet = create_packet (3, &data, sizeof (Packet_c));
+
+						send_packet (command->peer, packet);
+					}
+					break;
+				case COMMAND_TYPE_DISCONNECT:
+					// the client gets removed when the disconnect event comes back
+					enet_peer_disconnect (command->peer, 0);
+					break;
+				default:
+					break;
+			}
+		}
+	}
+}
+
+/*
+ * count the clients connected through this shard
+ *
+ * clients_lock must be held
+ */
+static int server_shard_client_count (Server_shard* shard)
+{
+	Server* server = shard->server;
+	int count = 0;
+
+	for (int iter = 0; iter < SERVER_MAX_CLIENT_SLOTS; iter++)
+	{
+		if (server->clients[iter].active
+			&& server->clients[iter].peer->host == shard->host)
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
 void* server_thread (void* data)
 {
 	ENetEvent event;
-	Server* server = data;
+	Server_shard* shard = data;
+	Server* server = shard->server;
 	bool quit = false;
 
-	printf ("server: launched\n");
+	printf ("server %i: launched\n", shard->index);
 
 	while (!quit)
 	{
-		frame_limiter_frame_start (&server->limiter);
+		server_shard_run_commands (shard);
+
+		// block until a packet arrives, enet has a retransmit or ping due, or another thread wakes us
+		uint32_t timeout = SERVER_SERVICE_TIMEOUT;
 
-		while (enet_host_service (server->host, &event, 0) > 0)
+		while (enet_host_service (shard->host, &event, timeout) > 0)
 		{
+			timeout = 0;
+
+			pthread_mutex_lock (&server->clients_lock);
+
 			switch (event.type)
 			{
 				case ENET_EVENT_TYPE_CONNECT:
 					{
-						printf ("server: connection from %x: %u\n", event.peer->address.host, event.peer->address.port);
+						printf ("server %i: connection from %x: %u\n", shard->index, event.peer->address.host, event.peer->address.port);
 					}
 					break;
 				case ENET_EVENT_TYPE_DISCONNECT:
-					printf ("server: %x: %u disconnected\n", event.peer->address.host, event.peer->address.port);
-					server_remove_client (server, server_find_client_by_peer (server, event.peer));
+				{
+					printf ("server %i: %x: %u disconnected\n", shard->index, event.peer->address.host, event.peer->address.port);
+					// peers that never greeted, or were refused, have no client
+					Server_client* client = server_find_client_by_peer (server, event.peer);
+					if (client)
+					{
+						server_remove_client (server, client);
+					}
 					enet_packet_destroy (event.packet);
-
 					break;
+				}
 				case ENET_EVENT_TYPE_RECEIVE:
 				{
 					// the first thing in a packet is its type
@@ -70,23 +199,35 @@ void* server_thread (void* data)
 						{
 							char name_buffer[SERVER_NAME_BUFFER_SIZE];
 							strcpy (name_buffer, (char*) (&event.packet->data[1]));
-							printf ("server: received greeting packet from client %s\n", name_buffer);
-							server_add_client (server, event.peer, name_buffer);
+							printf ("server %i: received greeting packet from client %s\n", shard->index, name_buffer);
+							if (!server_add_client (server, event.peer, name_buffer))
+							{
+								printf ("server %i: no room for client %s, disconnecting\n", shard->index, name_buffer);
+								enet_peer_disconnect (event.peer, 0);
+							}
 							break;
 						}
 						case 1:
 						{
 							Packet_a* pack = (Packet_a*) &event.packet->data[sizeof (uint8_t)];
 							Server_client* client = server_find_client_by_peer (server, event.peer);
-							printf ("server: received packet from client %s, containing %i\n", client->name, pack->x);
+							if (!client)
+							{
+								break;
+							}
+							printf ("server %i: received packet from client %s, containing %i\n", shard->index, client->name, pack->x);
 							break;
 						}
 						case 2:
 						{
 							Packet_b* pack = (Packet_b*) &event.packet->data[sizeof (uint8_t)];
 							Server_client* client = server_find_client_by_peer (server, event.peer);
-							printf ("server: received global packet from client %s, contianing %i\n", client->name, pack->x);
-							printf ("server: sending packet to all clients\n");
+							if (!client)
+							{
+								break;
+							}
+							printf ("server %i: received global packet from client %s, contianing %i\n", shard->index, client->name, pack->x);
+							printf ("server %i: sending packet to all clients\n", shard->index);
 							server_send_packet_to_all (server);
 							break;
 						}
@@ -102,6 +243,8 @@ void* server_thread (void* data)
 				default:
 					break;
 			}
+
+			pthread_mutex_unlock (&server->clients_lock);
 		}
 
 		// pthread_rwlock_tryrdlock returns 0 on success
@@ -112,48 +255,48 @@ void* server_thread (void* data)
 			quit = server->shutdown_server;
 			pthread_rwlock_unlock (&server->shutdown_lock);
 		}
-
-		// lets not eat up 100% cpu
-		frame_limiter_frame_end (&server->limiter, 100);
 	}
 
-	printf ("server: shutting down\n");
+	printf ("server %i: shutting down\n", shard->index);
 
-	// send gentle disconnect to peers, wait for their response
-	if (server->client_count > 0)
+	// send gentle disconnect to this shards peers, wait for their response
+	pthread_mutex_lock (&server->clients_lock);
+	int client_count = server_shard_client_count (shard);
+	if (client_count > 0)
 	{
-		for (int iter = 0; iter < SERVER_MAX_CLIENTS; iter++)
+		for (int iter = 0; iter < SERVER_MAX_CLIENT_SLOTS; iter++)
 		{
-			if (server->clients[iter].active)
+			if (server->clients[iter].active
+				&& server->clients[iter].peer->host == shard->host)
 			{
-				printf ("server: sending disconnect to client %s\n", server->clients[iter].name);
+				printf ("server %i: sending disconnect to client %s\n", shard->index, server->clients[iter].name);
 				enet_peer_disconnect (server->clients[iter].peer, 0);
 			}
 		}
+	}
+	pthread_mutex_unlock (&server->clients_lock);
 
-		server->shutdown_timeout = 3.0;
-		while (server->client_count > 0 && server->shutdown_timeout > 0.0)
-		{
-			frame_limiter_frame_start (&server->limiter);
-			server->frame_time = stm_laptime (&server->last_frame_time);
-
-			if (server->shutdown_timeout > 0.0)
-			{
-				server->shutdown_timeout -= stm_sec (server->frame_time);
-			}
+	if (client_count > 0)
+	{
+		uint64_t shutdown_start = stm_now ();
 
-			while (enet_host_service (server->host, &event, 0) > 0)
+		while (client_count > 0 && stm_sec (stm_since (shutdown_start)) < 3.0)
+		{
+			// wakes as soon as a disconnect acknowledgement comes in
+			while (enet_host_service (shard->host, &event, 100) > 0)
 			{
 				switch (event.type)
 				{
 					case ENET_EVENT_TYPE_DISCONNECT:
 					{
+						pthread_mutex_lock (&server->clients_lock);
 						Server_client* client = server_find_client_by_peer (server, event.peer);
 						if (client) // if we didnt find the client, dont do anything
 						{
-							printf ("server: received disconnect from client %s\n", client->name);
+							printf ("server %i: received disconnect from client %s\n", shard->index, client->name);
 							server_remove_client (server, client);
 						}
+						pthread_mutex_unlock (&server->clients_lock);
 						// fallthrough on purpose
 					}
 					default:
@@ -162,28 +305,100 @@ void* server_thread (void* data)
 				}
 			}
 
-			frame_limiter_frame_end (&server->limiter, 10);
+			pthread_mutex_lock (&server->clients_lock);
+			client_count = server_shard_client_count (shard);
+			pthread_mutex_unlock (&server->clients_lock);
 		}
+	}
 
-		if (server->client_count > 0)
+	pthread_mutex_lock (&server->clients_lock);
+
+	// whoever is left did not answer in time
+	for (int iter = 0; iter < SERVER_MAX_CLIENT_SLOTS; iter++)
+	{
+		if (server->clients[iter].active
+			&& server->clients[iter].peer->host == shard->host)
 		{
-			for (int iter = 0; iter < SERVER_MAX_CLIENTS; iter++)
-			{
-				if (server->clients[iter].active)
-				{
-					enet_peer_reset (server->clients[iter].peer);
-				}
-			}
+			enet_peer_reset (server->clients[iter].peer);
+			server_remove_client (server, &server->clients[iter]);
 		}
 	}
 
-	enet_host_destroy (server->host);
+	// the host itself is destroyed by server_join
+	// 	other threads may still be pushing commands and waking it
 
-	server->state = SERVER_STATE_SHUTDOWN;
+	// the last shard out marks the whole server as shut down
+	server->running_shards--;
+	if (server->running_shards == 0)
+	{
+		server->state = SERVER_STATE_SHUTDOWN;
+	}
+
+	pthread_mutex_unlock (&server->clients_lock);
 
 	return NULL;
 }
 
+/*
+ * in sharded mode every host has to set SO_REUSEPORT before its socket is bound
+ * 	enet_host_create binds straight away when given an address
+ * 	so create the host unbound and bind it here instead
+ */
+static ENetHost* server_create_host (Server* server, const ENetAddress* address)
+{
+	// each shard can end up with every client, the kernel picks the shard
+	ENetHost* host = enet_host_create (server->sharded ? NULL : address, SERVER_MAX_CLIENTS, 2, 0, 0);
+
+	if (!host)
+	{
+		return NULL;
+	}
+
+	// lets other threads interrupt the shard's blocking enet_host_service
+	if (enet_host_enable_wakeup (host) < 0)
+	{
+		enet_host_destroy (host);
+
+		return NULL;
+	}
+
+	if (!server->sharded)
+	{
+		return host;
+	}
+
+	if (enet_socket_set_option (host->socket, ENET_SOCKOPT_REUSEPORT, 1) < 0
+		|| enet_socket_bind (host->socket, address) < 0)
+	{
+		enet_host_destroy (host);
+
+		return NULL;
+	}
+
+	if (enet_socket_get_address (host->socket, &host->address) < 0)
+	{
+		host->address = *address;
+	}
+
+	return host;
+}
+
+// the index-th cpu of the set, counting round it again past the last one
+static int server_nth_cpu (const cpu_set_t* cpus, int index)
+{
+	index %= CPU_COUNT (cpus);
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if (CPU_ISSET (cpu, cpus) && index-- == 0)
+		{
+			return cpu;
+		}
+	}
+
+	return 0;
+}
+
 int server_launch (Server* server)
 {
 	if (server->state == SERVER_STATE_RUNNING)
@@ -193,33 +408,124 @@ int server_launch (Server* server)
 		return 0;
 	}
 
+	// clean up after the last run, its threads have all finished by now
+	server_join (server);
+
 	ENetAddress address =
 	{
 		.host = ENET_HOST_ANY,
 		.port = 2345
 	};
 
-	server->host = enet_host_create (&address, SERVER_MAX_CLIENTS, 2, 0, 0);
+	// one shard per core the process may run on, which a cpuset or taskset can make fewer than are online
+	cpu_set_t allowed_cpus;
 
-	if (!server->host)
+	CPU_ZERO (&allowed_cpus);
+	if (sched_getaffinity (0, sizeof (cpu_set_t), &allowed_cpus) < 0)
 	{
-		printf ("failed to launch server\n");
-
-		return 1;
+		CPU_ZERO (&allowed_cpus);
 	}
 
-	server->shutdown_server = false;
-	server->state = SERVER_STATE_SHUTDOWN;
+	int core_count = CPU_COUNT (&allowed_cpus);
 
-	if (pthread_create (&server->thread, NULL, server_thread, server))
+	server->shard_count = 1;
+	if (server->sharded && core_count > 1)
 	{
-		printf ("server: thread error\n");
+		server->shard_count = core_count < SERVER_MAX_SHARDS ? core_count : SERVER_MAX_SHARDS;
+	}
+
+	for (int iter = 0; iter < server->shard_count; iter++)
+	{
+		server->shards[iter].host = server_create_host (server, &address);
+
+		if (!server->shards[iter].host)
+		{
+			printf ("failed to launch server\n");
+
+			while (iter-- > 0)
+			{
+				enet_host_destroy (server->shards[iter].host);
+				server->shards[iter].host = NULL;
+			}
 
-		return 1;
+			return 1;
+		}
 	}
 
+	server->shutdown_server = false;
+	server->running_shards = 0;
 	server->state = SERVER_STATE_RUNNING;
 
+	for (int iter = 0; iter < server->shard_count; iter++)
+	{
+		command_queue_initialize (&server->shards[iter].commands);
+	}
+
+	for (int iter = 0; iter < server->shard_count; iter++)
+	{
+		Server_shard* shard = &server->shards[iter];
+		pthread_attr_t attributes;
+
+		bool pinned = false;
+
+		pthread_attr_init (&attributes);
+
+		// pin each shard to its own core so its socket and peers stay in that cores cache
+		if (server->sharded && core_count > 0)
+		{
+			cpu_set_t cpus;
+
+			CPU_ZERO (&cpus);
+			CPU_SET (server_nth_cpu (&allowed_cpus, iter), &cpus);
+			pinned = pthread_attr_setaffinity_np (&attributes, sizeof (cpu_set_t), &cpus) == 0;
+
+			if (!pinned)
+			{
+				printf ("server: could not pin shard %i, it runs unpinned\n", iter);
+			}
+		}
+
+		pthread_mutex_lock (&server->clients_lock);
+		server->running_shards++;
+		pthread_mutex_unlock (&server->clients_lock);
+
+		int error = pthread_create (&shard->thread, &attributes, server_thread, shard);
+
+		// the affinity is only applied as the thread starts, so a core taken away by now refuses it
+		if (error == EINVAL && pinned)
+		{
+			printf ("server: shard %i was refused its core, it runs unpinned\n", iter);
+
+			pthread_attr_destroy (&attributes);
+			pthread_attr_init (&attributes);
+			error = pthread_create (&shard->thread, &attributes, server_thread, shard);
+		}
+
+		if (error)
+		{
+			printf ("server: thread error\n");
+
+			pthread_attr_destroy (&attributes);
+
+			// the shards already running will see this and shut down on their own
+			server_shutdown (server);
+
+			// hosts without a thread are cleaned up by server_join like the rest
+			pthread_mutex_lock (&server->clients_lock);
+			server->running_shards--;
+			if (server->running_shards == 0)
+			{
+				server->state = SERVER_STATE_SHUTDOWN;
+			}
+			pthread_mutex_unlock (&server->clients_lock);
+
+			return 1;
+		}
+
+		pthread_attr_destroy (&attributes);
+		shard->launched = true;
+	}
+
 	return 0;
 }
 
@@ -228,12 +534,52 @@ void server_shutdown (Server* server)
 	pthread_rwlock_wrlock (&server->shutdown_lock);
 	server->shutdown_server = true;
 	pthread_rwlock_unlock (&server->shutdown_lock);
+
+	// shards block in enet_host_service, so make sure they notice straight away
+	for (int iter = 0; iter < server->shard_count; iter++)
+	{
+		if (server->shards[iter].host)
+		{
+			enet_host_wakeup (server->shards[iter].host);
+		}
+	}
+}
+
+/*
+ * wait for every shard thread that has been launched to finish, then destroy the shard hosts
+ *
+ * the hosts outlive their threads so other threads can push commands and wake them at any time
+ */
+void server_join (Server* server)
+{
+	for (int iter = 0; iter < SERVER_MAX_SHARDS; iter++)
+	{
+		if (server->shards[iter].launched)
+		{
+			pthread_join (server->shards[iter].thread, NULL);
+			server->shards[iter].launched = false;
+		}
+	}
+
+	for (int iter = 0; iter < SERVER_MAX_SHARDS; iter++)
+	{
+		if (server->shards[iter].host)
+		{
+			enet_host_destroy (server->shards[iter].host);
+			server->shards[iter].host = NULL;
+		}
+	}
 }
 
-void server_add_client (Server* server, ENetPeer* peer, const char* name)
+/*
+ * returns false when every slot is taken
+ *
+ * clients_lock must be held by the caller
+ */
+bool server_add_client (Server* server, ENetPeer* peer, const char* name)
 {
 	// find the first inactive client slot and put the client in there
-	for (int iter = 0; iter < SERVER_MAX_CLIENTS; iter++)
+	for (int iter = 0; iter < SERVER_MAX_CLIENT_SLOTS; iter++)
 	{
 		Server_client* new_client = &server->clients[iter];
 
@@ -242,12 +588,13 @@ void server_add_client (Server* server, ENetPeer* peer, const char* name)
 			new_client->active = true;
 			new_client->peer = peer;
 			strcpy (new_client->name, name);
+			server->client_count++;
 
-			break;
+			return true;
 		}
 	}
 
-	server->client_count++;
+	return false;
 }
 
 /*
@@ -257,7 +604,7 @@ void server_add_client (Server* server, ENetPeer* peer, const char* name)
  */
 Server_client* server_find_client_by_peer (Server* server, ENetPeer* peer)
 {
-	for (int iter = 0; iter < SERVER_MAX_CLIENTS; iter++)
+	for (int iter = 0; iter < SERVER_MAX_CLIENT_SLOTS; iter++)
 	{
 		if (server->clients[iter].active
 			&& server->clients[iter].peer == peer)
@@ -269,6 +616,9 @@ Server_client* server_find_client_by_peer (Server* server, ENetPeer* peer)
 	return NULL;
 }
 
+/*
+ * clients_lock must be held by the caller
+ */
 void server_remove_client (Server* server, Server_client* client)
 {
 	client->active = false;
@@ -278,19 +628,72 @@ void server_remove_client (Server* server, Server_client* client)
 	server->client_count--;
 }
 
+/*
+ * safe to call from any thread, the shards create and send the packets themselves
+ */
 void server_send_packet_to_all (Server* server)
 {
-	Packet_d packet_to_all = {5};
-	ENetPacket* packet = create_packet (4, &packet_to_all, sizeof (Packet_d));
+	Command command =
+	{
+		.type = COMMAND_TYPE_SEND,
+		.packet_type = 4,
+		.peer = NULL
+	};
 
-	enet_host_broadcast (server->host, 0, packet);
-	// the packet will be sent by enet_host_service at the beginning of server frame
+	// every shard broadcasts its own copy
+	// 	packet reference counts are not atomic, so a packet cant be shared by hosts on different threads
+	for (int iter = 0; iter < server->shard_count; iter++)
+	{
+		server_shard_push_command (&server->shards[iter], &command);
+	}
+	// the packets will be sent as soon as each shard wakes up
 }
 
+/*
+ * push a command for a client to the shard the client is connected through
+ */
+static void server_push_client_command (Server* server, Server_client* client, Command* command)
+{
+	pthread_mutex_lock (&server->clients_lock);
+	if (client->active)
+	{
+		command->peer = client->peer;
+		command->connect_id = client->peer->connectID;
+
+		for (int iter = 0; iter < server->shard_count; iter++)
+		{
+			if (client->peer->host == server->shards[iter].host)
+			{
+				server_shard_push_command (&server->shards[iter], command);
+			}
+		}
+	}
+	pthread_mutex_unlock (&server->clients_lock);
+}
+
+/*
+ * safe to call from any thread, the client's shard creates and sends the packet itself
+ */
 void server_send_packet_to_one (Server* server, Server_client* client)
 {
-	Packet_c data = {8};
-	ENetPacket* packet = create_packet (3, &data, sizeof (Packet_c));
+	Command command =
+	{
+		.type = COMMAND_TYPE_SEND,
+		.packet_type = 3
+	};
+
+	server_push_client_command (server, client, &command);
+}
+
+/*
+ * safe to call from any thread, the client's shard sends the disconnect itself
+ */
+void server_disconnect_client (Server* server, Server_client* client)
+{
+	Command command =
+	{
+		.type = COMMAND_TYPE_DISCONNECT
+	};
 
-	enet_peer_send (client->peer, 0, packet);
+	server_push_client_command (server, client, &command);
 }
@@ -7,10 +7,19 @@
 #include "enet/enet.h"
 
 #include "packet.h"
-#include "frame_limiter.h"
+#include "command_queue.h"
 
 #define SERVER_MAX_CLIENTS 3
+// upper bound on the number of hosts the sharded server opens on the same port
+#define SERVER_MAX_SHARDS 8
+// every shard's host accepts SERVER_MAX_CLIENTS peers, so the shared table needs room for all of them
+#define SERVER_MAX_CLIENT_SLOTS (SERVER_MAX_CLIENTS * SERVER_MAX_SHARDS)
 #define SERVER_NAME_BUFFER_SIZE 8
+// how many queued commands a shard pops at a time
+#define SERVER_COMMAND_BATCH_SIZE 16
+// how long a shard blocks in enet_host_service when nothing is happening
+// 	enet wakes up earlier for its own retransmits and pings, and other threads wake it with enet_host_wakeup
+#define SERVER_SERVICE_TIMEOUT 1000
 #define SERVER_MAX_NAME_LENGTH (SERVER_NAME_BUFFER_SIZE - 1)
 
 typedef enum
@@ -31,39 +40,59 @@ typedef struct server_client_s
 	// since we are keeping connected clients in a static array
 	// 	need to know if the slot in the array is in use or not (active)
 	bool active;
-	char name[SERVER_MAX_NAME_LENGTH];
+	char name[SERVER_NAME_BUFFER_SIZE];
 	ENetPeer* peer;
 } Server_client;
 
-typedef struct server_s
+struct server_s;
+
+// one host and the thread servicing it
+// 	in sharded mode every shard is bound to the same port with SO_REUSEPORT
+// 	and the kernel spreads incoming clients across them
+typedef struct server_shard_s
 {
 	pthread_t thread;
+	// only ever serviced by the shard's own thread, enet hosts are not thread safe
+	// 	it stays allocated until server_join, so other threads can always wake it
 	ENetHost* host;
+	struct server_s* server;
+	int index;
+	bool launched;
+
+	// other threads (the gui, other shards) push sends and disconnects here and wake the host
+	// 	the shard's thread pops them at the top of every iteration
+	Command_queue commands;
+} Server_shard;
+
+typedef struct server_s
+{
+	Server_shard shards[SERVER_MAX_SHARDS];
+	int shard_count;
+	int running_shards;
+	bool sharded;
 
-	Server_client clients[SERVER_MAX_CLIENTS];
+	// clients, client_count, last_event and running_shards are shared by all shards
+	pthread_mutex_t clients_lock;
+	Server_client clients[SERVER_MAX_CLIENT_SLOTS];
 	int client_count;
 
 	bool shutdown_server;
 	pthread_rwlock_t shutdown_lock;
-	double shutdown_timeout;
 
 	Server_event last_event;
 	Server_state state;
-
-	uint64_t frame_time;
-	uint64_t last_frame_time;
-
-	Frame_limiter limiter;
 } Server;
 
 int server_initialize (Server* server);
 void* server_thread (void* data);
 int server_launch (Server* server);
 void server_shutdown (Server* server);
+void server_join (Server* server);
 Server_client* server_find_client_by_peer (Server* server, ENetPeer* peer);
-void server_add_client (Server* server, ENetPeer* peer, const char* name);
+bool server_add_client (Server* server, ENetPeer* peer, const char* name);
 void server_remove_client (Server* server, Server_client* client);
 void server_send_packet_to_all (Server* server);
 void server_send_packet_to_one (Server* server, Server_client* client);
+void server_disconnect_client (Server* server, Server_client* client);
 
 #endif